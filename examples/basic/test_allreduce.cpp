@@ -0,0 +1,105 @@
+/**
+ * \example test_allreduce.cpp
+ *
+ * Test allreduce on scalars, bulk buffers and local arrays, in place
+ * and non-blocking, with small data (recursive doubling) and large data
+ * (reduce-scatter + allgather), on team sizes that are not powers of two
+ */
+
+#include <upcxx.h>
+#include <upcxx/interfaces.h>
+#include <iostream>
+#include <vector>
+
+using namespace upcxx;
+
+// A minimal type with the local array interface (see interfaces.h)
+struct local_vec {
+  typedef upcxx::enable_if<true, double> local_elem_type;
+  double *ptr;
+  size_t n;
+  local_vec(double *p, size_t count) : ptr(p), n(count) {}
+  double *storage_ptr() const { return ptr; }
+  size_t size() const { return n; }
+};
+
+int test_bulk(const team &t, size_t count)
+{
+  int num_errors = 0;
+  long n = t.size();
+  long me = t.myrank();
+  std::vector<long> src(count), dst(count), inplace(count);
+  for (size_t i = 0; i < count; i++) {
+    src[i] = me * (long)i;
+    inplace[i] = me + (long)i;
+  }
+
+  t.allreduce(&src[0], &dst[0], count, UPCXX_SUM);
+  t.allreduce(&inplace[0], &inplace[0], count, UPCXX_MAX);
+  for (size_t i = 0; i < count; i++) {
+    if (dst[i] != n * (n - 1) / 2 * (long)i) num_errors++;
+    if (inplace[i] != n - 1 + (long)i) num_errors++;
+  }
+  return num_errors;
+}
+
+int main(int argc, char **argv)
+{
+  upcxx::init(&argc, &argv);
+
+  int num_errors = 0;
+  rank_t n = ranks();
+  rank_t me = myrank();
+
+  // scalars
+  if (allreduce((int)me, UPCXX_SUM) != (int)(n * (n - 1) / 2)) num_errors++;
+  if (allreduce((double)me, UPCXX_MAX) != (double)(n - 1)) num_errors++;
+  if (reduce::min((long)me + 5) != 5) num_errors++;
+
+  // small and large bulk data on all ranks and on the teams of the even
+  // and the odd ranks
+  team *t;
+  team_all.split(me % 2, me / 2, t);
+  size_t counts[] = { 1, 3, 100, 100000, 100003 };
+  for (int i = 0; i < 5; i++) {
+    num_errors += test_bulk(team_all, counts[i]);
+    num_errors += test_bulk(*t, counts[i]);
+  }
+
+  // local arrays, in place
+  std::vector<double> a(50000), b(50000);
+  for (size_t i = 0; i < a.size(); i++) a[i] = (double)(me + i);
+  allreduce(local_vec(&a[0], a.size()), local_vec(&b[0], b.size()),
+            UPCXX_MIN);
+  allreduce(local_vec(&a[0], a.size()), UPCXX_SUM);
+  for (size_t i = 0; i < a.size(); i++) {
+    if (b[i] != (double)i) num_errors++;
+    if (a[i] != (double)n * (n - 1) / 2 + (double)n * i) num_errors++;
+  }
+
+  // non-blocking, several at once
+  std::vector<int> x(200000, 1), y(200000), z(10, 2);
+  event e;
+  async_allreduce(&x[0], &y[0], x.size(), UPCXX_SUM, &e);
+  async_allreduce(&z[0], &z[0], z.size(), UPCXX_PROD, &e);
+  e.wait();
+  for (size_t i = 0; i < y.size(); i++) {
+    if (y[i] != (int)n) num_errors++;
+  }
+  for (size_t i = 0; i < z.size(); i++) {
+    if (z[i] != (1 << n)) num_errors++;
+  }
+
+  if (num_errors > 0) {
+    printf("Rank %u: test_allreduce failed with %d errors!\n",
+           me, num_errors);
+    gasnet_exit(1);
+  }
+
+  barrier();
+  if (me == 0)
+    std::cout << "test_allreduce passed!\n";
+
+  upcxx::finalize();
+  return 0;
+}
@@ -0,0 +1,104 @@
+/**
+ * \example test_alltoallv.cpp
+ *
+ * Test alltoallv with uneven counts, in the blocking, auto-sizing and
+ * event-based forms
+ */
+
+#include <upcxx.h>
+#include <iostream>
+#include <vector>
+
+using namespace upcxx;
+
+// the number of elements that rank i sends to rank j, zero for some pairs
+static size_t pair_count(rank_t i, rank_t j)
+{
+  return (i + 2 * j) % 5 * 100;
+}
+
+static long pair_value(rank_t i, rank_t j, size_t k)
+{
+  return (long)i * 1000000 + (long)j * 10000 + (long)k;
+}
+
+int main(int argc, char **argv)
+{
+  upcxx::init(&argc, &argv);
+
+  int num_errors = 0;
+  rank_t n = ranks();
+  rank_t me = myrank();
+
+  std::vector<size_t> send_counts(n), send_displs(n);
+  std::vector<size_t> recv_counts(n), recv_displs(n);
+  size_t send_total = 0, recv_total = 0;
+  for (rank_t r = 0; r < n; r++) {
+    send_counts[r] = pair_count(me, r);
+    send_displs[r] = send_total;
+    send_total += send_counts[r];
+    // receive in reverse rank order to test the displacements
+    recv_counts[n - 1 - r] = pair_count(n - 1 - r, me);
+    recv_displs[n - 1 - r] = recv_total;
+    recv_total += recv_counts[n - 1 - r];
+  }
+
+  std::vector<long> src(send_total + 1);
+  for (rank_t r = 0; r < n; r++) {
+    for (size_t k = 0; k < send_counts[r]; k++) {
+      src[send_displs[r] + k] = pair_value(me, r, k);
+    }
+  }
+
+  // blocking
+  std::vector<long> dst(recv_total + 1, -1);
+  alltoallv(&src[0], &send_counts[0], &send_displs[0],
+            &dst[0], &recv_counts[0], &recv_displs[0]);
+  for (rank_t r = 0; r < n; r++) {
+    for (size_t k = 0; k < recv_counts[r]; k++) {
+      if (dst[recv_displs[r] + k] != pair_value(r, me, k)) num_errors++;
+    }
+  }
+
+  // auto-sizing: the data is stored in rank order
+  std::vector<long> dst2;
+  std::vector<size_t> counts2;
+  alltoallv(&src[0], &send_counts[0], &send_displs[0], dst2, &counts2);
+  if (dst2.size() != recv_total || counts2.size() != n) {
+    num_errors++;
+  } else {
+    size_t offset = 0;
+    for (rank_t r = 0; r < n; r++) {
+      if (counts2[r] != recv_counts[r]) num_errors++;
+      for (size_t k = 0; k < counts2[r]; k++) {
+        if (dst2[offset + k] != pair_value(r, me, k)) num_errors++;
+      }
+      offset += counts2[r];
+    }
+  }
+
+  // event-based, two at once on the same event
+  std::vector<long> dst3(recv_total + 1, -1), dst4(recv_total + 1, -1);
+  event e;
+  async_alltoallv(&src[0], &send_counts[0], &send_displs[0],
+                  &dst3[0], &recv_counts[0], &recv_displs[0], &e);
+  async_alltoallv(&src[0], &send_counts[0], &send_displs[0],
+                  &dst4[0], &recv_counts[0], &recv_displs[0], &e);
+  e.wait();
+  for (size_t i = 0; i < recv_total; i++) {
+    if (dst3[i] != dst[i] || dst4[i] != dst[i]) num_errors++;
+  }
+
+  if (num_errors > 0) {
+    printf("Rank %u: test_alltoallv failed with %d errors!\n",
+           me, num_errors);
+    gasnet_exit(1);
+  }
+
+  barrier();
+  if (me == 0)
+    std::cout << "test_alltoallv passed!\n";
+
+  upcxx::finalize();
+  return 0;
+}
@@ -0,0 +1,70 @@
+/**
+ * \example test_async_allocate.cpp
+ *
+ * Test non-blocking remote allocation, bulk allocation and batched
+ * remote frees
+ */
+
+#include <upcxx.h>
+#include <iostream>
+#include <vector>
+
+using namespace upcxx;
+
+#define NUM_BLOCKS 100
+
+int main(int argc, char **argv)
+{
+  upcxx::init(&argc, &argv);
+
+  uint32_t target = (myrank() + 1) % ranks();
+  int num_errors = 0;
+
+  // Many allocations in flight at the same time
+  std::vector< value_future< global_ptr<int> > > futures;
+  for (int i = 0; i < NUM_BLOCKS; i++) {
+    futures.push_back(async_allocate<int>(target, i + 1));
+  }
+  std::vector< global_ptr<int> > ptrs;
+  for (int i = 0; i < NUM_BLOCKS; i++) {
+    global_ptr<int> p = futures[i].get();
+    if (p.isnull() || p.where() != target) num_errors++;
+    ptrs.push_back(p);
+  }
+  for (int i = 0; i < NUM_BLOCKS; i++) {
+    ptrs[i][i] = i; // write the last element of each block
+  }
+  for (int i = 0; i < NUM_BLOCKS; i++) {
+    if (ptrs[i][i].get() != i) num_errors++;
+    deallocate(ptrs[i]);
+  }
+
+  // Bulk allocation in one message
+  std::vector<size_t> sizes;
+  for (int i = 0; i < NUM_BLOCKS; i++) sizes.push_back(sizeof(double) * (i + 1));
+  std::vector< global_ptr<void> > blocks = allocate(target, sizes);
+  if (blocks.size() != NUM_BLOCKS) num_errors++;
+  for (size_t i = 0; i < blocks.size(); i++) {
+    if (blocks[i].isnull() || blocks[i].where() != target) num_errors++;
+    global_ptr<double> d(blocks[i]);
+    d[i] = 1.0 * i;
+    if (d[i].get() != 1.0 * i) num_errors++;
+  }
+  for (size_t i = 0; i < blocks.size(); i++) {
+    deallocate(blocks[i]);
+  }
+  async_wait(); // send the queued frees
+
+  if (num_errors > 0) {
+    printf("Rank %u: test_async_allocate failed with %d errors!\n",
+           myrank(), num_errors);
+    gasnet_exit(1);
+  }
+
+  barrier();
+  if (myrank() == 0)
+    std::cout << "test_async_allocate passed!\n";
+
+  upcxx::finalize();
+  return 0;
+}
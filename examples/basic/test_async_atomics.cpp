@@ -0,0 +1,86 @@
+/**
+ * \example test_async_atomics.cpp
+ *
+ * Test non-blocking remote atomics with many operations in flight,
+ * completing into both value futures and user events
+ */
+
+#include <upcxx.h>
+#include <iostream>
+#include <vector>
+#include <inttypes.h>
+
+using namespace upcxx;
+
+#define NUM_OPS 256
+
+shared_array<uint64_t> counters;
+shared_array<int64_t> maxvals;
+
+int main(int argc, char **argv)
+{
+  upcxx::init(&argc, &argv);
+
+  counters.init(ranks());
+  maxvals.init(ranks());
+  counters[myrank()] = 0;
+  maxvals[myrank()] = -1;
+
+  barrier();
+
+  uint32_t target = (myrank() + 1) % ranks();
+  global_ptr<uint64_t> counter = &counters[target];
+  global_ptr<int64_t> maxval = &maxvals[target];
+
+  // Old values written to user locations, completing into one event
+  std::vector<uint64_t> old_vals(NUM_OPS);
+  event e;
+  for (int i = 0; i < NUM_OPS; i++) {
+    async_fetch_add(counter, 1, &old_vals[i], &e);
+    async_fetch_max(maxval, (int64_t)i, (int64_t *)NULL, &e);
+  }
+  e.wait();
+
+  // Every old value is distinct because only this rank updates the target
+  int num_errors = 0;
+  std::vector<int> seen(NUM_OPS, 0);
+  for (int i = 0; i < NUM_OPS; i++) {
+    if (old_vals[i] >= NUM_OPS || seen[old_vals[i]]++) num_errors++;
+  }
+
+  // Old values returned in futures
+  std::vector< value_future<uint64_t> > futures;
+  for (int i = 0; i < NUM_OPS; i++) {
+    futures.push_back(async_fetch_add(counter, 2));
+  }
+  uint64_t sum = 0;
+  for (int i = 0; i < NUM_OPS; i++) {
+    sum += futures[i].get();
+  }
+  uint64_t expected_sum = 0;
+  for (int i = 0; i < NUM_OPS; i++) expected_sum += NUM_OPS + 2 * i;
+  if (sum != expected_sum) num_errors++;
+
+  value_future<uint64_t> last = async_atomic_load(counter);
+  if (last.get() != 3 * NUM_OPS) num_errors++;
+  value_future<uint64_t> cas = async_compare_exchange(counter, 3 * NUM_OPS, 0);
+  if (cas.get() != 3 * NUM_OPS) num_errors++;
+
+  barrier();
+
+  if (counters[myrank()].get() != 0) num_errors++;
+  if (maxvals[myrank()].get() != NUM_OPS - 1) num_errors++;
+
+  if (num_errors > 0) {
+    printf("Rank %u: test_async_atomics failed with %d errors!\n",
+           myrank(), num_errors);
+    gasnet_exit(1);
+  }
+
+  barrier();
+  if (myrank() == 0)
+    std::cout << "test_async_atomics passed!\n";
+
+  upcxx::finalize();
+  return 0;
+}
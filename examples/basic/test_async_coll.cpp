@@ -0,0 +1,131 @@
+/**
+ * \example test_async_coll.cpp
+ *
+ * Test non-blocking collectives, several of them in flight at once
+ */
+
+#include <upcxx.h>
+#include <upcxx/finish.h>
+#include <iostream>
+#include <vector>
+
+using namespace upcxx;
+
+int main(int argc, char **argv)
+{
+  upcxx::init(&argc, &argv);
+
+  int num_errors = 0;
+  rank_t n = ranks();
+  rank_t me = myrank();
+  size_t count = 1000;
+
+  // GASNet collectives take buffers in the shared segment
+  global_ptr<int> src = allocate<int>(me, count);
+  global_ptr<int> bdst = allocate<int>(me, count);
+  global_ptr<int> gdst = allocate<int>(me, count * n);
+  global_ptr<int> adst = allocate<int>(me, count * n);
+  global_ptr<int> asrc = allocate<int>(me, count * n);
+  global_ptr<long> rdst = allocate<long>(me, count);
+  int *lsrc = (int *)src;
+  int *lbdst = (int *)bdst;
+  int *lgdst = (int *)gdst;
+  int *ladst = (int *)adst;
+  int *lasrc = (int *)asrc;
+  long *lrdst = (long *)rdst;
+
+  std::vector<long> rsrc(count), ar_dst(count), ar_inplace(count);
+  for (size_t i = 0; i < count; i++) {
+    lsrc[i] = (int)(me * count + i);
+    rsrc[i] = (long)(me + i);
+    ar_inplace[i] = (long)(me + 1);
+  }
+  for (size_t i = 0; i < count * n; i++) lasrc[i] = (int)(me * 100000 + i);
+  barrier();
+
+  // overlap the collectives in one finish scope
+  upcxx_finish {
+    async_bcast(lsrc, lbdst, count * sizeof(int), n - 1);
+    async_gather(lsrc, lgdst, count * sizeof(int), 0);
+    async_alltoall(lasrc, ladst, count * sizeof(int));
+    async_reduce(&rsrc[0], lrdst, count, 0, UPCXX_SUM, UPCXX_LONG);
+    async_allreduce(&rsrc[0], &ar_dst[0], count, UPCXX_MAX, UPCXX_LONG);
+    async_allreduce(&ar_inplace[0], &ar_inplace[0], count, UPCXX_SUM,
+                    UPCXX_LONG);
+    async_barrier();
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    if (lbdst[i] != (int)((n - 1) * count + i)) num_errors++;
+    if (ar_dst[i] != (long)(n - 1 + i)) num_errors++;
+    if (ar_inplace[i] != (long)n * (n + 1) / 2) num_errors++;
+    if (me == 0) {
+      long sum = (long)n * (n - 1) / 2 + (long)n * i;
+      if (lrdst[i] != sum) num_errors++;
+    }
+  }
+  if (me == 0) {
+    for (size_t i = 0; i < count * n; i++) {
+      if (lgdst[i] != (int)i) num_errors++;
+    }
+  }
+  for (rank_t r = 0; r < n; r++) {
+    for (size_t i = 0; i < count; i++) {
+      if (ladst[r * count + i] != (int)(r * 100000 + me * count + i))
+        num_errors++;
+    }
+  }
+
+  // the same on a team of the odd ranks and one of the even ranks, with
+  // an explicit event; the team sizes are not powers of two in general
+  team *t;
+  team_all.split(me % 2, me / 2, t);
+  event e;
+  long x = (long)t->myrank() + 1, y = 0;
+  t->async_allreduce(&x, &y, 1, UPCXX_SUM, &e);
+  t->async_barrier(&e);
+  for (int i = 0; i < 10; i++) t->async_barrier(&e);
+  e.wait();
+  if (y != (long)t->size() * (t->size() + 1) / 2) num_errors++;
+
+  // Two teams with the same members as team_all.  Collectives only
+  // need the same order within a team, so the even and the odd ranks
+  // start them on the two teams in opposite orders.
+  team *t1, *t2;
+  team_all.split(0, me, t1);
+  team_all.split(0, me, t2);
+  long x1 = 1, y1 = 0, x2 = (long)me, y2 = 0, y0 = 0;
+  event e1;
+  for (int k = 0; k < 2; k++) {
+    if ((me % 2) == (rank_t)k) {
+      t1->async_allreduce(&x1, &y1, 1, UPCXX_SUM, &e1);
+      async_allreduce(&x1, &y0, 1, UPCXX_MAX, UPCXX_LONG, &e1);
+    } else {
+      t2->async_allreduce(&x2, &y2, 1, UPCXX_SUM, &e1);
+    }
+  }
+  e1.wait();
+  if (y1 != (long)n) num_errors++;
+  if (y2 != (long)n * (n - 1) / 2) num_errors++;
+  if (y0 != 1) num_errors++;
+
+  deallocate(src);
+  deallocate(bdst);
+  deallocate(gdst);
+  deallocate(adst);
+  deallocate(asrc);
+  deallocate(rdst);
+
+  if (num_errors > 0) {
+    printf("Rank %u: test_async_coll failed with %d errors!\n",
+           me, num_errors);
+    gasnet_exit(1);
+  }
+
+  barrier();
+  if (me == 0)
+    std::cout << "test_async_coll passed!\n";
+
+  upcxx::finalize();
+  return 0;
+}
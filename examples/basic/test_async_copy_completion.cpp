@@ -0,0 +1,83 @@
+/**
+ * \example test_async_copy_completion.cpp
+ *
+ * Test async_copy with separate local and remote completion events.
+ * The send buffer is refilled as soon as the local completion event
+ * is done, without waiting for the remote completion.
+ */
+#include <upcxx.h>
+#include <iostream>
+
+using namespace std;
+using namespace upcxx;
+
+#define COUNT 1024
+#define ROUNDS 8
+
+shared_array< global_ptr<double> > inbufs;
+
+int main(int argc, char **argv)
+{
+  upcxx::init(&argc, &argv);
+
+  inbufs.init(ranks());
+
+  global_ptr<double> inbuf = allocate<double>(myrank(), COUNT * ROUNDS);
+  inbufs[myrank()] = inbuf;
+  double *sendbuf = (double *)allocate<double>(myrank(), COUNT).raw_ptr();
+
+  barrier();
+
+  uint32_t dst_rank = (myrank() + 1) % ranks();
+  global_ptr<double> dst = inbufs[dst_rank];
+
+  event local_done, remote_done;
+  for (int r = 0; r < ROUNDS; r++) {
+    // the send buffer may be reused once the local completion is done
+    local_done.wait();
+    for (int i = 0; i < COUNT; i++) {
+      sendbuf[i] = (double)r * 1e6 + (double)myrank() * 1e3 + i;
+    }
+    async_copy(global_ptr<double>(sendbuf), dst + r * COUNT, COUNT,
+               &local_done, &remote_done);
+  }
+  remote_done.wait();
+
+  barrier();
+
+  uint32_t src_rank = (myrank() + ranks() - 1) % ranks();
+  double *local_inbuf = (double *)inbuf;
+  int num_errors = 0;
+  for (int r = 0; r < ROUNDS; r++) {
+    for (int i = 0; i < COUNT; i++) {
+      double expected = (double)r * 1e6 + (double)src_rank * 1e3 + i;
+      if (local_inbuf[r * COUNT + i] != expected) num_errors++;
+    }
+  }
+
+  // Get the data back with both events set for the get path
+  double *getbuf = (double *)allocate<double>(myrank(), COUNT).raw_ptr();
+  async_copy(dst, global_ptr<double>(getbuf), COUNT, &local_done, &remote_done);
+  local_done.wait();
+  remote_done.wait();
+  for (int i = 0; i < COUNT; i++) {
+    if (getbuf[i] != (double)myrank() * 1e3 + i) num_errors++;
+  }
+
+  if (num_errors > 0) {
+    printf("Rank %u: test_async_copy_completion failed with %d errors!\n",
+           myrank(), num_errors);
+    gasnet_exit(1);
+  }
+
+  barrier();
+  deallocate(getbuf);
+  deallocate(sendbuf);
+  deallocate(inbuf);
+
+  if (myrank() == 0)
+    printf("test_async_copy_completion passed!\n");
+
+  upcxx::finalize();
+  return 0;
+}
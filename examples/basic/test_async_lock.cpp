@@ -0,0 +1,55 @@
+/**
+ * \example test_async_lock.cpp
+ *
+ * Test the queued shared_lock under contention with both lock() and
+ * the non-blocking async_lock()
+ */
+
+#include <upcxx.h>
+#include <iostream>
+
+using namespace upcxx;
+
+#define ITERS 100
+
+shared_lock sl;
+shared_var<int> counter = 0;
+
+int main(int argc, char **argv)
+{
+  upcxx::init(&argc, &argv);
+
+  barrier();
+
+  for (int i = 0; i < ITERS; i++) {
+    if (i % 2 == 0) {
+      sl.lock();
+    } else {
+      // overlap the acquisition with other work
+      event e;
+      sl.async_lock(&e);
+      // a query while queued must not disturb the pending request
+      sl.islocked();
+      while (!e.async_try()) {
+        advance();
+      }
+    }
+    counter = counter + 1; // a non-atomic read-modify-write
+    sl.unlock();
+  }
+
+  barrier();
+
+  if (myrank() == 0) {
+    if ((int)counter != ITERS * (int)ranks()) {
+      printf("test_async_lock failed: counter is %d, but expected %d\n",
+             (int)counter, ITERS * (int)ranks());
+      gasnet_exit(1);
+    }
+    std::cout << "test_async_lock passed!\n";
+  }
+
+  barrier();
+  upcxx::finalize();
+  return 0;
+}
@@ -0,0 +1,96 @@
+/**
+ * \example test_atomics.cpp
+ *
+ * Test typed remote atomics (swap, compare-and-swap, fetch-and-op)
+ * on integer and floating-point types
+ */
+
+#include <upcxx.h>
+#include <iostream>
+#include <inttypes.h>
+
+using namespace upcxx;
+
+shared_array<int32_t> icounters;
+shared_array<uint64_t> ucounters;
+shared_array<double> dcounters;
+shared_array<int64_t> maxvals;
+shared_array<uint32_t> bits;
+
+int main(int argc, char **argv)
+{
+  upcxx::init(&argc, &argv);
+
+  icounters.init(ranks());
+  ucounters.init(ranks());
+  dcounters.init(ranks());
+  maxvals.init(ranks());
+  bits.init(ranks());
+
+  icounters[myrank()] = 0;
+  ucounters[myrank()] = 0;
+  dcounters[myrank()] = 0.0;
+  maxvals[myrank()] = -1;
+  bits[myrank()] = 0;
+
+  barrier();
+
+  int num_errors = 0;
+  for (int i = 0; i < 100; i++) {
+    for (int t = 0; t < ranks(); t++) {
+      fetch_add(&icounters[t], 1);
+      fetch_sub(&icounters[t], 2);
+      fetch_add(&dcounters[t], 0.5);
+      fetch_max(&maxvals[t], (int64_t)(myrank() * 100 + i));
+      // Each rank increments with compare-and-swap
+      uint64_t expected = atomic_load(&ucounters[t]);
+      while (!compare_exchange(&ucounters[t], expected, expected + 1))
+        ;
+    }
+  }
+  for (int t = 0; t < ranks(); t++) {
+    fetch_or(&bits[t], 1u << (myrank() % 32));
+  }
+
+  barrier();
+
+  int32_t ival = icounters[myrank()];
+  uint64_t uval = ucounters[myrank()];
+  double dval = dcounters[myrank()];
+  int64_t mval = maxvals[myrank()];
+  uint32_t bval = bits[myrank()];
+  uint32_t expected_bits = 0;
+  for (uint32_t r = 0; r < ranks(); r++) expected_bits |= 1u << (r % 32);
+
+  if (ival != -100 * (int32_t)ranks()) num_errors++;
+  if (uval != 100 * (uint64_t)ranks()) num_errors++;
+  if (dval != 50.0 * ranks()) num_errors++;
+  if (mval != (int64_t)((ranks() - 1) * 100 + 99)) num_errors++;
+  if (bval != expected_bits) num_errors++;
+
+  barrier();
+
+  // swap and fetch_xor on the neighbor's counters
+  uint32_t neighbor = (myrank() + 1) % ranks();
+  if (myrank() == 0) {
+    int32_t old = atomic_swap(&icounters[neighbor], 42);
+    if (old != -100 * (int32_t)ranks()) num_errors++;
+    atomic_store(&icounters[neighbor], 7);
+    if (atomic_load(&icounters[neighbor]) != 7) num_errors++;
+    if (fetch_xor(&bits[neighbor], expected_bits) != expected_bits) num_errors++;
+    if (atomic_load(&bits[neighbor]) != 0) num_errors++;
+  }
+
+  if (num_errors > 0) {
+    printf("Rank %u: test_atomics failed with %d errors!\n",
+           myrank(), num_errors);
+    gasnet_exit(1);
+  }
+
+  barrier();
+  if (myrank() == 0)
+    std::cout << "test_atomics passed!\n";
+
+  upcxx::finalize();
+  return 0;
+}
@@ -0,0 +1,121 @@
+/**
+ * \example test_dist_hash_map.cpp
+ *
+ * Test insert, find and erase of dist_hash_map from all ranks
+ */
+
+#include <upcxx.h>
+#include <upcxx/finish.h>
+#include <iostream>
+#include <vector>
+
+using namespace upcxx;
+
+struct pair_key_t {
+  uint32_t rank;
+  uint32_t index;
+  bool operator==(const pair_key_t &k) const { return rank == k.rank && index == k.index; }
+};
+
+dist_hash_map<uint64_t, double> m;
+dist_hash_map<pair_key_t, uint64_t> m2;
+
+int main(int argc, char **argv)
+{
+  upcxx::init(&argc, &argv);
+
+  int num_errors = 0;
+  uint64_t n = 1000; // keys per rank, enough to grow the tables
+  m.init(16);
+  m2.init();
+
+  // every rank inserts its own keys
+  std::vector< value_future<bool> > inserted;
+  for (uint64_t i = 0; i < n; i++) {
+    inserted.push_back(m.insert(myrank() * n + i, (double)i));
+  }
+  for (uint64_t i = 0; i < n; i++) {
+    if (!inserted[i].get()) num_errors++;
+  }
+  barrier();
+
+  // replacing a value returns false
+  if (m.insert(myrank() * n, -1.0).get()) num_errors++;
+  barrier();
+
+  // look up the keys of the next rank
+  rank_t peer = (myrank() + 1) % ranks();
+  std::vector< value_future< std::pair<bool, double> > > found;
+  for (uint64_t i = 0; i < n; i++) {
+    found.push_back(m.find(peer * n + i));
+  }
+  for (uint64_t i = 0; i < n; i++) {
+    std::pair<bool, double> r = found[i].get();
+    double expected = (i == 0) ? -1.0 : (double)i;
+    if (!r.first || r.second != expected) num_errors++;
+  }
+  if (m.find(ranks() * n + 1).get().first) num_errors++;
+  barrier();
+
+  // erase the even keys of the next rank with the event form
+  bool *erased = new bool[n];
+  upcxx_finish {
+    for (uint64_t i = 0; i < n; i += 2) {
+      m.erase(peer * n + i, &erased[i]);
+    }
+  }
+  for (uint64_t i = 0; i < n; i += 2) {
+    if (!erased[i]) num_errors++;
+  }
+  delete [] erased;
+  barrier();
+
+  // the erased keys are gone and the others remain
+  for (uint64_t i = 0; i < n; i++) {
+    std::pair<bool, double> r = m.find(myrank() * n + i).get();
+    if (r.first != (i % 2 == 1)) num_errors++;
+  }
+  if (m.erase(myrank() * n).get()) num_errors++;
+
+  // reinsert into the erased slots
+  event e;
+  for (uint64_t i = 0; i < n; i += 2) {
+    m.insert(myrank() * n + i, (double)i, NULL, &e);
+  }
+  e.wait();
+  barrier();
+
+  // every rank owns a share of the keys
+  uint64_t local = m.local_size(), total;
+  upcxx_reduce(&local, &total, 1, 0, UPCXX_SUM, UPCXX_ULONG_LONG);
+  if (myrank() == 0 && total != n * ranks()) num_errors++;
+
+  // struct keys
+  for (uint32_t i = 0; i < 100; i++) {
+    pair_key_t k = { myrank(), i };
+    m2.insert(k, (uint64_t)myrank() * i, NULL, &e);
+  }
+  e.wait();
+  barrier();
+  for (uint32_t i = 0; i < 100; i++) {
+    pair_key_t k = { peer, i };
+    std::pair<bool, uint64_t> r = m2.find(k).get();
+    if (!r.first || r.second != (uint64_t)peer * i) num_errors++;
+  }
+
+  m.destroy();
+  m2.destroy();
+
+  if (num_errors > 0) {
+    printf("Rank %u: test_dist_hash_map failed with %d errors!\n",
+           myrank(), num_errors);
+    gasnet_exit(1);
+  }
+
+  barrier();
+  if (myrank() == 0)
+    std::cout << "test_dist_hash_map passed!\n";
+
+  upcxx::finalize();
+  return 0;
+}
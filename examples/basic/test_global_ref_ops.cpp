@@ -0,0 +1,104 @@
+/**
+ * \example test_global_ref_ops.cpp
+ *
+ * Test that compound assignments through global_ref are atomic when
+ * many ranks update the same elements
+ */
+
+#include <upcxx.h>
+#include <upcxx/finish.h>
+#include <iostream>
+
+using namespace upcxx;
+
+struct pair_t {
+  int a, b;
+  pair_t &operator+=(const pair_t &rhs) { a += rhs.a; b += rhs.b; return *this; }
+};
+
+shared_array<long> counters;
+shared_array<double> dsum;
+shared_array<unsigned long long> bits;
+
+#define XOR_BITS (0xffULL << 32)
+shared_array<long> prod;
+shared_array<pair_t> pairs;
+
+int main(int argc, char **argv)
+{
+  upcxx::init(&argc, &argv);
+
+  int num_errors = 0;
+  int iters = 100;
+  counters.init(ranks());
+  dsum.init(ranks());
+  bits.init(ranks());
+  prod.init(ranks());
+  pairs.init(ranks());
+  counters[myrank()] = 0;
+  dsum[myrank()] = 0.0;
+  bits[myrank()] = 0;
+  prod[myrank()] = 1;
+  pair_t zero = {0, 0};
+  pairs[myrank()] = zero;
+  barrier();
+
+  // all ranks hammer the element owned by rank 0 and their neighbor
+  rank_t peer = (myrank() + 1) % ranks();
+  for (int k = 0; k < iters; k++) {
+    counters[0] += 2;
+    counters[0] -= 1;
+    dsum[peer] += 0.25;
+  }
+  // the OR and XOR bits are disjoint so that the order does not matter
+  bits[0] |= (1ULL << (myrank() % 32));
+  bits[peer] ^= XOR_BITS;
+  if (myrank() < 30) prod[0] *= 2;
+
+  // non-blocking form, completed by the finish scope
+  upcxx_finish {
+    for (int k = 0; k < iters; k++) {
+      counters[peer].async_apply(UPCXX_ATOMIC_FETCH_ADD, 1);
+    }
+  }
+
+  // unsupported types still work through get and put
+  if (myrank() == 0) {
+    pair_t one = {1, 2};
+    pairs[peer] += one;
+  }
+  barrier();
+
+  if (myrank() == 0) {
+    // rank 0 also received the async updates from rank ranks()-1
+    if (counters[0] != (long)iters * ranks() + iters) num_errors++;
+    unsigned long long mask = 0;
+    for (rank_t r = 0; r < ranks(); r++) mask |= 1ULL << (r % 32);
+    // rank 0 is the peer of rank ranks()-1
+    if (bits[0] != (mask | XOR_BITS)) num_errors++;
+    long p = 1;
+    for (rank_t r = 0; r < ranks() && r < 30; r++) p *= 2;
+    if (prod[0] != p) num_errors++;
+  } else {
+    if (counters[myrank()] != iters) num_errors++;
+    if (bits[myrank()] != XOR_BITS) num_errors++;
+  }
+  if (dsum[myrank()] != 0.25 * iters) num_errors++;
+  if (myrank() == 1 % ranks()) {
+    pair_t v = pairs[myrank()];
+    if (v.a != 1 || v.b != 2) num_errors++;
+  }
+
+  if (num_errors > 0) {
+    printf("Rank %u: test_global_ref_ops failed with %d errors!\n",
+           myrank(), num_errors);
+    gasnet_exit(1);
+  }
+
+  barrier();
+  if (myrank() == 0)
+    std::cout << "test_global_ref_ops passed!\n";
+
+  upcxx::finalize();
+  return 0;
+}
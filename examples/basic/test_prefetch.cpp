@@ -0,0 +1,104 @@
+/**
+ * \example test_prefetch.cpp
+ *
+ * Test prefetch() of remote ranges and reading the prefetched data
+ * through global_ref, copy() and prefetch_view().
+ */
+#include <upcxx.h>
+#include <iostream>
+
+using namespace std;
+using namespace upcxx;
+
+const size_t LOCAL_SIZE = 512;
+
+shared_array<double> A;
+
+int main(int argc, char **argv)
+{
+  upcxx::init(&argc, &argv);
+
+  A.init(LOCAL_SIZE * ranks(), LOCAL_SIZE);
+  for (size_t i = 0; i < LOCAL_SIZE; i++) {
+    A[myrank() * LOCAL_SIZE + i] = (double)(myrank() * LOCAL_SIZE + i);
+  }
+  barrier();
+
+  uint32_t peer = (myrank() + 1) % ranks();
+  global_ptr<double> remote = &A[peer * LOCAL_SIZE];
+
+  prefetch(remote, LOCAL_SIZE);
+
+  // overlap some local work with the prefetch
+  double sum = 0.0;
+  for (size_t i = 0; i < LOCAL_SIZE; i++) {
+    sum += A[myrank() * LOCAL_SIZE + i];
+  }
+
+  int num_errors = 0;
+  for (size_t i = 0; i < LOCAL_SIZE; i++) {
+    if (remote[i].get() != (double)(peer * LOCAL_SIZE + i)) num_errors++;
+  }
+
+  double buf[16];
+  upcxx::copy(remote + 16, buf, 16);
+  for (size_t i = 0; i < 16; i++) {
+    if (buf[i] != (double)(peer * LOCAL_SIZE + 16 + i)) num_errors++;
+  }
+
+  double *view = prefetch_view(remote, LOCAL_SIZE);
+  if (view == NULL) {
+    num_errors++;
+  } else {
+    for (size_t i = 0; i < LOCAL_SIZE; i++) {
+      if (view[i] != (double)(peer * LOCAL_SIZE + i)) num_errors++;
+    }
+  }
+
+  // overlapping prefetches, and writes by the calling rank that cover
+  // them only partly must be seen by later reads of every range
+  prefetch(remote + 100, 50);
+  prefetch(remote + 80, 30);
+  double wbuf[20];
+  for (size_t i = 0; i < 20; i++) wbuf[i] = -1.0 - i;
+  upcxx::copy(wbuf, remote + 90, 20);  // [90, 110)
+  remote[120] = -100.0;
+  for (size_t i = 80; i < 150; i++) {
+    double expected = (double)(peer * LOCAL_SIZE + i);
+    if (i >= 90 && i < 110) expected = -1.0 - (i - 90);
+    if (i == 120) expected = -100.0;
+    if (remote[i].get() != expected) num_errors++;
+  }
+  view = prefetch_view(remote + 100, 50);
+  if (view == NULL || view[0] != -11.0 || view[20] != -100.0) num_errors++;
+
+  // a longer prefetch at the same start replaces the shorter one, and
+  // views of the shorter one stay valid until the next barrier
+  prefetch(remote + 200, 8);
+  double *short_view = prefetch_view(remote + 200, 8);
+  prefetch(remote + 200, 64);
+  view = prefetch_view(remote + 200, 64);
+  if (view == NULL || short_view == NULL) {
+    num_errors++;
+  } else {
+    for (size_t i = 0; i < 64; i++) {
+      if (view[i] != (double)(peer * LOCAL_SIZE + 200 + i)) num_errors++;
+    }
+    for (size_t i = 0; i < 8; i++) {
+      if (short_view[i] != (double)(peer * LOCAL_SIZE + 200 + i)) num_errors++;
+    }
+  }
+
+  if (num_errors > 0) {
+    printf("Rank %u: test_prefetch failed with %d errors!\n",
+           myrank(), num_errors);
+    gasnet_exit(1);
+  }
+
+  barrier(); // releases the prefetch buffers
+  if (myrank() == 0)
+    printf("test_prefetch passed!\n");
+
+  upcxx::finalize();
+  return 0;
+}
@@ -0,0 +1,81 @@
+/**
+ * \example test_put_nb.cpp
+ *
+ * Test put_nb() and flush(), which combine small remote writes to
+ * the same rank into a few active messages, and the order of the
+ * writes to the same address.
+ */
+#include <upcxx.h>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+using namespace upcxx;
+
+const size_t LOCAL_SIZE = 4096;
+const uint64_t NUM_WRITES = 100001;
+
+shared_array<uint64_t> A;
+shared_array< global_ptr<uint64_t> > bufs;
+
+int main(int argc, char **argv)
+{
+  upcxx::init(&argc, &argv);
+
+  A.init(LOCAL_SIZE * ranks());
+
+  // Each rank writes every ranks()-th element starting from its own
+  // rank id, so all the elements are written exactly once and most
+  // of the writes are remote.
+  for (size_t i = myrank(); i < A.size(); i += ranks()) {
+    size_t j = (i * 7919) % A.size(); // scatter the writes
+    put_nb(&A[j], (uint64_t)j * 3 + 1);
+  }
+  upcxx::flush();
+
+  barrier();
+
+  // 7919 is a prime, so the scattered indices cover every element.
+  int num_errors = 0;
+  for (size_t i = myrank(); i < A.size(); i += ranks()) {
+    if (A[i].get() != (uint64_t)i * 3 + 1) num_errors++;
+  }
+
+  // Writes to the same address span many buffer-fulls and must be
+  // applied in order, also with writes too large to be combined
+  // mixed in.
+  size_t big = gasnet_AMMaxMedium() / sizeof(uint64_t) + 1;
+  bufs.init(ranks());
+  bufs[myrank()] = allocate<uint64_t>(myrank(), big);
+  barrier();
+  global_ptr<uint64_t> target = bufs[(myrank() + 1) % ranks()];
+  std::vector<uint64_t> block(big);
+  for (uint64_t k = 1; k <= NUM_WRITES; k++) {
+    if (k % 10000 == 0) {
+      for (size_t i = 0; i < big; i++) block[i] = k;
+      put_nb(target, &block[0], big * sizeof(uint64_t));
+    } else {
+      put_nb(target, k);
+    }
+  }
+  upcxx::flush();
+  barrier();
+
+  global_ptr<uint64_t> mine = bufs[myrank()];
+  uint64_t *local = (uint64_t *)mine.raw_ptr();
+  if (local[0] != NUM_WRITES) num_errors++;
+  if (local[big - 1] != NUM_WRITES / 10000 * 10000) num_errors++;
+
+  if (num_errors > 0) {
+    printf("Rank %u: test_put_nb failed with %d errors!\n",
+           myrank(), num_errors);
+    gasnet_exit(1);
+  }
+
+  barrier();
+  if (myrank() == 0)
+    printf("test_put_nb passed!\n");
+
+  upcxx::finalize();
+  return 0;
+}
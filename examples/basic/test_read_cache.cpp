@@ -0,0 +1,74 @@
+/**
+ * \example test_read_cache.cpp
+ *
+ * Test the software read cache for remote global_ref reads and its
+ * invalidation at barriers.
+ */
+#include <upcxx.h>
+#include <iostream>
+
+using namespace std;
+using namespace upcxx;
+
+const size_t LOCAL_SIZE = 1024;
+
+shared_array<int> A;
+
+int check_values(int phase)
+{
+  int num_errors = 0;
+  // read the whole array twice, the second pass should hit the cache
+  for (int pass = 0; pass < 2; pass++) {
+    for (size_t i = 0; i < A.size(); i++) {
+      if (A[i].get() != (int)i + phase) num_errors++;
+    }
+  }
+  return num_errors;
+}
+
+int main(int argc, char **argv)
+{
+  upcxx::init(&argc, &argv);
+
+  A.init(LOCAL_SIZE * ranks(), LOCAL_SIZE);
+  for (size_t i = 0; i < LOCAL_SIZE; i++) {
+    A[myrank() * LOCAL_SIZE + i] = (int)(myrank() * LOCAL_SIZE + i);
+  }
+
+  cache_enable(64 * 1024, 128);
+  barrier();
+
+  int num_errors = check_values(0);
+
+  barrier();
+  // update my part of the array; the barrier below invalidates the
+  // stale copies cached by the other ranks
+  for (size_t i = 0; i < LOCAL_SIZE; i++) {
+    A[myrank() * LOCAL_SIZE + i] = (int)(myrank() * LOCAL_SIZE + i) + 1;
+  }
+  barrier();
+
+  num_errors += check_values(1);
+
+  if (ranks() > 1 && cache_hits() == 0) {
+    printf("Rank %u: expected some cache hits\n", myrank());
+    num_errors++;
+  }
+
+  if (num_errors > 0) {
+    printf("Rank %u: test_read_cache failed with %d errors!\n",
+           myrank(), num_errors);
+    gasnet_exit(1);
+  }
+
+  printf("Rank %u: cache hits %llu, misses %llu\n", myrank(),
+         (unsigned long long)cache_hits(), (unsigned long long)cache_misses());
+
+  cache_disable();
+  barrier();
+  if (myrank() == 0)
+    printf("test_read_cache passed!\n");
+
+  upcxx::finalize();
+  return 0;
+}
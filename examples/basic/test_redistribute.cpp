@@ -0,0 +1,81 @@
+/**
+ * \example test_redistribute.cpp
+ *
+ * Test changing the layout of a shared_array with redistribute()
+ */
+
+#include <upcxx.h>
+#include <iostream>
+
+using namespace upcxx;
+
+shared_array<long> a;
+shared_array<long> b;
+
+// Check that every rank owns the elements of the layout with block
+// size blk_sz and that they hold their global indices
+int check(shared_array<long> &arr, size_t blk_sz)
+{
+  int num_errors = 0;
+  if (arr.get_blk_sz() != blk_sz) num_errors++;
+
+  shared_array<long>::local_view_t v = arr.local_view();
+  size_t count = 0;
+  for (shared_array<long>::local_view_t::iterator it = v.begin();
+       it != v.end(); ++it) {
+    if ((it->global_index / blk_sz) % ranks() != myrank()) num_errors++;
+    for (size_t j = 0; j < it->size; j++) {
+      if (it->data[j] != (long)(it->global_index + j)) num_errors++;
+    }
+    count += it->size;
+  }
+
+  size_t total;
+  upcxx_reduce(&count, &total, 1, 0, UPCXX_SUM, UPCXX_ULONG_LONG);
+  if (myrank() == 0 && total != arr.size()) num_errors++;
+  return num_errors;
+}
+
+int main(int argc, char **argv)
+{
+  upcxx::init(&argc, &argv);
+
+  int num_errors = 0;
+  size_t sz = 1000 * ranks() + 13;
+  a.init(sz, 1);
+  b.set_symmetric(true);
+  b.init(sz, 7);
+
+  shared_array<long>::local_view_t v = a.local_view();
+  for (size_t li = 0; li < v.size(); li++) v[li] = v.global_index(li);
+  v = b.local_view();
+  for (size_t li = 0; li < v.size(); li++) v[li] = v.global_index(li);
+  barrier();
+
+  size_t blk_sizes[] = { 5, 64, 1, 0, 3 };
+  for (int k = 0; k < 5; k++) {
+    size_t blk = blk_sizes[k] ? blk_sizes[k] : (sz + ranks() - 1) / ranks();
+    a.redistribute(blk_sizes[k]);
+    num_errors += check(a, blk);
+    b.redistribute(blk_sizes[k]);
+    num_errors += check(b, blk);
+  }
+
+  // remote reads see the new layout
+  for (size_t i = myrank(); i < sz; i += 97) {
+    if (a[i] != (long)i) num_errors++;
+  }
+
+  if (num_errors > 0) {
+    printf("Rank %u: test_redistribute failed with %d errors!\n",
+           myrank(), num_errors);
+    gasnet_exit(1);
+  }
+
+  barrier();
+  if (myrank() == 0)
+    std::cout << "test_redistribute passed!\n";
+
+  upcxx::finalize();
+  return 0;
+}
@@ -0,0 +1,65 @@
+/**
+ * \example test_rwlock.cpp
+ *
+ * test shared_rwlock
+ */
+
+#include <upcxx.h>
+#include <iostream>
+
+using namespace upcxx;
+
+#define ITERS 200
+
+shared_rwlock rwl;
+shared_var<int> sv1 = 0;
+shared_var<int> sv2 = 0;
+
+int main(int argc, char **argv)
+{
+  upcxx::init(&argc, &argv);
+
+  barrier();
+
+  int num_errors = 0;
+  int num_writes = 0;
+  for (int i = 0; i < ITERS; i++) {
+    if (i % 4 == 0) {
+      // writers keep sv1 and sv2 equal
+      rwl.write_lock();
+      sv1 = sv1 + 1;
+      sv2 = sv2 + 1;
+      rwl.write_unlock();
+      num_writes++;
+    } else {
+      rwl.read_lock();
+      if ((int)sv1 != (int)sv2) num_errors++;
+      rwl.read_unlock();
+    }
+  }
+
+  // try locks don't wait
+  if (rwl.try_read_lock()) rwl.read_unlock();
+  if (rwl.try_write_lock()) rwl.write_unlock();
+
+  barrier();
+
+  if (myrank() == 0 && (int)sv1 != num_writes * (int)ranks()) {
+    printf("Error: sv1 is %d, but expected %d\n",
+           (int)sv1, num_writes * (int)ranks());
+    num_errors++;
+  }
+
+  if (num_errors > 0) {
+    printf("Rank %u: test_rwlock failed with %d errors!\n",
+           myrank(), num_errors);
+    gasnet_exit(1);
+  }
+
+  barrier();
+  if (myrank() == 0)
+    std::cout << "test_rwlock passed!\n";
+
+  upcxx::finalize();
+  return 0;
+}
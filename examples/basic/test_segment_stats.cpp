@@ -0,0 +1,72 @@
+/**
+ * \example test_segment_stats.cpp
+ *
+ * Test the memory usage statistics of the GASNet segment.  Run with
+ * UPCXX_SEGMENT_STATS=yes to also get the report at finalize.
+ */
+
+#include <upcxx.h>
+#include <iostream>
+#include <vector>
+
+using namespace upcxx;
+
+shared_array<double> sa;
+
+int main(int argc, char **argv)
+{
+  upcxx::init(&argc, &argv);
+
+  int num_errors = 0;
+  segment_stats_t before, after, freed;
+  segment_stats(&before);
+
+  global_ptr<char> small = allocate<char>(myrank(), 100);
+  global_ptr<char> large = allocate<char>(myrank(), 1 << 20);
+  sa.init(1024 * ranks());
+
+  segment_stats(&after);
+  if (after.bytes_in_use < before.bytes_in_use + (1 << 20) + 100) num_errors++;
+  if (after.high_water < after.bytes_in_use) num_errors++;
+  if (after.alloc_count[SEG_ALLOC_USER] != before.alloc_count[SEG_ALLOC_USER] + 2)
+    num_errors++;
+  if (after.alloc_bytes[SEG_ALLOC_SHARED_ARRAY] <
+      before.alloc_bytes[SEG_ALLOC_SHARED_ARRAY] + 1024 * sizeof(double))
+    num_errors++;
+  if (after.segment_size == 0 || after.num_free_blocks == 0) num_errors++;
+
+  deallocate(large);
+  deallocate(small);
+
+  segment_stats(&freed);
+  if (freed.bytes_in_use + (1 << 20) + 100 > after.bytes_in_use) num_errors++;
+  if (freed.high_water != after.high_water) num_errors++;
+
+  // a burst of small blocks should not keep its cache chunks once freed
+  const int nburst = 8192;
+  std::vector< global_ptr<char> > burst(nburst);
+  for (int i = 0; i < nburst; i++)
+    burst[i] = allocate<char>(myrank(), 100);
+  segment_stats_t peak, released;
+  segment_stats(&peak);
+  for (int i = 0; i < nburst; i++)
+    deallocate(burst[i]);
+  segment_stats(&released);
+  if (peak.cached_bytes > 0 && released.cached_bytes >= peak.cached_bytes)
+    num_errors++;
+
+  print_segment_stats(stdout);
+
+  if (num_errors > 0) {
+    printf("Rank %u: test_segment_stats failed with %d errors!\n",
+           myrank(), num_errors);
+    gasnet_exit(1);
+  }
+
+  barrier();
+  if (myrank() == 0)
+    std::cout << "test_segment_stats passed!\n";
+
+  upcxx::finalize();
+  return 0;
+}
@@ -0,0 +1,69 @@
+/**
+ * \example test_shared_array_copy.cpp
+ *
+ * Test bulk range get and put of shared_array
+ */
+
+#include <upcxx.h>
+#include <upcxx/finish.h>
+#include <iostream>
+#include <vector>
+
+using namespace upcxx;
+
+shared_array<long> a;
+
+int main(int argc, char **argv)
+{
+  upcxx::init(&argc, &argv);
+
+  int num_errors = 0;
+  size_t blk_sizes[] = { 1, 3, 16 };
+  for (int b = 0; b < 3; b++) {
+    size_t sz = 50 * ranks() + 7;
+    a.init(sz, blk_sizes[b]);
+
+    // every rank puts a different range, rank 0 fills the rest
+    size_t chunk = sz / ranks();
+    size_t begin = myrank() * chunk;
+    size_t end = (myrank() == ranks() - 1) ? sz : begin + chunk;
+    std::vector<long> src(end - begin);
+    for (size_t i = begin; i < end; i++) src[i - begin] = i * 10 + b;
+    event e;
+    if (end > begin) a.async_put(begin, end, &src[0], &e);
+    e.wait();
+    barrier();
+
+    // get an unaligned range that crosses blocks of all ranks
+    size_t gbegin = (myrank() * 7) % sz;
+    size_t gend = sz - (myrank() % 5);
+    std::vector<long> dst(gend - gbegin + 1, -1);
+    a.async_get(gbegin, gend, &dst[0], &e);
+    e.wait();
+    for (size_t i = gbegin; i < gend; i++) {
+      if (dst[i - gbegin] != (long)(i * 10 + b)) num_errors++;
+    }
+    if (dst[gend - gbegin] != -1) num_errors++; // no overrun
+
+    // the default event is the current finish scope
+    long one;
+    upcxx_finish {
+      a.async_get(sz - 1, sz, &one);
+    }
+    if (one != (long)((sz - 1) * 10 + b)) num_errors++;
+    barrier();
+  }
+
+  if (num_errors > 0) {
+    printf("Rank %u: test_shared_array_copy failed with %d errors!\n",
+           myrank(), num_errors);
+    gasnet_exit(1);
+  }
+
+  barrier();
+  if (myrank() == 0)
+    std::cout << "test_shared_array_copy passed!\n";
+
+  upcxx::finalize();
+  return 0;
+}
@@ -0,0 +1,83 @@
+/**
+ * \example test_shared_array_view.cpp
+ *
+ * Test the address translation of shared_array with power-of-two,
+ * compile-time and other block sizes, and its local views
+ */
+
+#include <upcxx.h>
+#include <iostream>
+
+using namespace upcxx;
+
+shared_array<long> a1;     // runtime block size
+shared_array<long, 4> a4;  // compile-time block size
+
+// Check that operator[] and local_view() agree on the distribution
+template<typename T, size_t BLK_SZ>
+int check_array(shared_array<T, BLK_SZ> &a)
+{
+  int num_errors = 0;
+  typedef typename shared_array<T, BLK_SZ>::local_view_t view_t;
+  view_t v = a.local_view();
+
+  // fill the local elements with their global indices
+  size_t count = 0;
+  for (typename view_t::iterator it = v.begin(); it != v.end(); ++it) {
+    for (size_t j = 0; j < it->size; j++) {
+      it->data[j] = it->global_index + j;
+    }
+    count += it->size;
+  }
+  if (count != v.size()) num_errors++;
+  for (size_t li = 0; li < v.size(); li++) {
+    if (v[li] != (T)v.global_index(li)) num_errors++;
+  }
+  barrier();
+
+  // every element is owned by exactly one rank, and the owner's
+  // local view put its global index there
+  size_t owned = 0;
+  for (size_t i = 0; i < a.size(); i++) {
+    global_ref<T> r = a[i];
+    if (r.where() == myrank()) owned++;
+    if (r.get() != (T)i) num_errors++;
+  }
+  if (owned != v.size()) num_errors++;
+  barrier();
+  return num_errors;
+}
+
+int main(int argc, char **argv)
+{
+  upcxx::init(&argc, &argv);
+
+  int num_errors = 0;
+  size_t blk_sizes[] = { 1, 2, 3, 8 };
+  for (int b = 0; b < 4; b++) {
+    // a partial last block
+    a1.init(blk_sizes[b] * (2 * ranks() - 1) + 1, blk_sizes[b]);
+    num_errors += check_array(a1);
+    // ranks without any block
+    a1.init(blk_sizes[b], blk_sizes[b]);
+    num_errors += check_array(a1);
+  }
+
+  a4.init(37 * ranks());
+  num_errors += check_array(a4);
+  a4.init(37 * ranks(), 5); // not the compile-time block size
+  num_errors += check_array(a4);
+
+  if (num_errors > 0) {
+    printf("Rank %u: test_shared_array_view failed with %d errors!\n",
+           myrank(), num_errors);
+    gasnet_exit(1);
+  }
+
+  barrier();
+  if (myrank() == 0)
+    std::cout << "test_shared_array_view passed!\n";
+
+  upcxx::finalize();
+  return 0;
+}
@@ -0,0 +1,85 @@
+/**
+ * \example test_staged_copy.cpp
+ *
+ * Test copy() and async_copy() (gets, puts, and puts with local
+ * completion) from and to local buffers that are not in the GASNet
+ * segment, which are staged through segment bounce buffers.
+ */
+#include <upcxx.h>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+using namespace upcxx;
+
+const size_t COUNT = 100000; // spans several bounce buffers
+
+shared_array< global_ptr<int> > bufs;
+
+int main(int argc, char **argv)
+{
+  upcxx::init(&argc, &argv);
+
+  bufs.init(ranks());
+  bufs[myrank()] = allocate<int>(myrank(), COUNT);
+  barrier();
+
+  uint32_t peer = (myrank() + 1) % ranks();
+  global_ptr<int> remote = bufs[peer];
+
+  std::vector<int> src(COUNT), src2(COUNT), dst(COUNT, 0), dst2(COUNT, 0),
+    dst3(COUNT, 0);
+  for (size_t i = 0; i < COUNT; i++) {
+    src[i] = (int)(myrank() * COUNT + i);
+    src2[i] = -src[i];
+  }
+
+  upcxx::copy(&src[0], remote, COUNT);
+  upcxx::copy(remote, &dst[0], COUNT);
+
+  event e;
+  async_copy(remote, &dst2[0], COUNT, &e);
+  e.wait();
+
+  // non-blocking puts, with and without local completion
+  async_copy(&src2[0], remote, COUNT, &e);
+  e.wait();
+  upcxx::copy(remote, &dst3[0], COUNT);
+  event local_done;
+  async_copy(&src[0], remote, COUNT, &local_done, &e);
+  local_done.wait();
+  src[0] = 42; // src may be reused after the local completion
+  e.wait();
+
+  int num_errors = 0;
+  for (size_t i = 0; i < COUNT; i++) {
+    if (dst[i] != -src2[i]) num_errors++;
+    if (dst2[i] != -src2[i]) num_errors++;
+    if (dst3[i] != src2[i]) num_errors++;
+  }
+  upcxx::copy(remote, &dst[0], COUNT);
+  for (size_t i = 0; i < COUNT; i++) {
+    if (dst[i] != -src2[i]) num_errors++;
+  }
+
+  // the blocking copies are always staged when staging is enabled
+  if (ranks() > 1 &&
+      gasnett_getenv_yesno_withdefault("UPCXX_STAGE_NONSEG_COPY", 1) &&
+      staged_copy_count() < 2) {
+    printf("Rank %u: no copy was staged\n", myrank());
+    num_errors++;
+  }
+
+  if (num_errors > 0) {
+    printf("Rank %u: test_staged_copy failed with %d errors!\n",
+           myrank(), num_errors);
+    gasnet_exit(1);
+  }
+
+  barrier();
+  if (myrank() == 0)
+    printf("test_staged_copy passed!\n");
+
+  upcxx::finalize();
+  return 0;
+}
@@ -0,0 +1,91 @@
+/**
+ * \example test_symmetric.cpp
+ *
+ * Test symmetric heap allocation and symmetric shared arrays
+ */
+
+#include <upcxx.h>
+#include <iostream>
+#include <stdlib.h>
+
+using namespace upcxx;
+
+shared_array<long> sa;
+
+int main(int argc, char **argv)
+{
+  // the symmetric heap is disabled by default
+  setenv("UPCXX_SYMMETRIC_HEAP_SIZE", "4194304", 0);
+  upcxx::init(&argc, &argv);
+
+  int num_errors = 0;
+  size_t n = 1000;
+
+  long *a = symmetric_allocate<long>(n);
+  if (a == NULL) {
+    if (myrank() == 0)
+      std::cout << "test_symmetric: the symmetric heap is disabled, skipped\n";
+    upcxx::finalize();
+    return 0;
+  }
+
+  // a block freed in between is reused at the same offset on all ranks
+  char *tmp = symmetric_allocate<char>(100);
+  long *b = symmetric_allocate<long>(n);
+  symmetric_deallocate(tmp);
+  int *c = symmetric_allocate<int>(10);
+
+  for (size_t i = 0; i < n; i++) {
+    a[i] = myrank() * n + i;
+  }
+  *c = myrank();
+  barrier();
+
+  rank_t peer = (myrank() + 1) % ranks();
+  for (size_t i = 0; i < n; i++) {
+    long v = symmetric_ptr(a, peer)[i];
+    if (v != (long)(peer * n + i)) num_errors++;
+  }
+  int pc = *symmetric_ptr(c, peer);
+  if (pc != (int)peer) num_errors++;
+
+  // write into the next rank's b
+  for (size_t i = 0; i < n; i++) {
+    symmetric_ptr(b, peer)[i] = myrank();
+  }
+  barrier();
+  rank_t prev = (myrank() + ranks() - 1) % ranks();
+  for (size_t i = 0; i < n; i++) {
+    if (b[i] != (long)prev) num_errors++;
+  }
+
+  symmetric_deallocate(c);
+  symmetric_deallocate(b);
+  symmetric_deallocate(a);
+
+  // a symmetric shared array needs no pointer table
+  sa.set_symmetric(true);
+  sa.init(n * ranks(), 4);
+  if (sa._alldata != NULL) num_errors++;
+  for (size_t i = myrank(); i < sa.size(); i += ranks()) {
+    sa[i] = i;
+  }
+  barrier();
+  for (size_t i = 0; i < sa.size(); i++) {
+    if (sa[i].get() != (long)i) num_errors++;
+  }
+  sa.finalize();
+
+  if (num_errors > 0) {
+    printf("Rank %u: test_symmetric failed with %d errors!\n",
+           myrank(), num_errors);
+    gasnet_exit(1);
+  }
+
+  barrier();
+  if (myrank() == 0)
+    std::cout << "test_symmetric passed!\n";
+
+  upcxx::finalize();
+  return 0;
+}
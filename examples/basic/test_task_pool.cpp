@@ -0,0 +1,95 @@
+/**
+ * \example test_task_pool.cpp
+ *
+ * Test the work-stealing task_pool by counting the nodes of an
+ * unbalanced tree whose root is spawned by rank 0
+ */
+
+#include <upcxx.h>
+#include <iostream>
+
+using namespace upcxx;
+
+struct node_t {
+  uint64_t id;
+  uint32_t depth;
+};
+
+task_pool<node_t> pool;
+uint64_t visited = 0;
+
+#define MAX_DEPTH 14
+
+// Deterministic but irregular number of children
+static uint32_t num_children(const node_t &n)
+{
+  if (n.depth >= MAX_DEPTH) return 0;
+  if (n.depth == 0) return 4;
+  uint64_t h = n.id * 0x9E3779B97F4A7C15ULL;
+  h ^= h >> 29;
+  return (h % 5 == 0) ? 0 : 1 + (uint32_t)((h >> 8) % 3);
+}
+
+static node_t child(const node_t &n, uint32_t i)
+{
+  node_t c = { n.id * 5 + i + 1, n.depth + 1 };
+  return c;
+}
+
+void visit(const node_t &n)
+{
+  visited++;
+  for (uint32_t i = 0; i < num_children(n); i++) {
+    pool.spawn(child(n, i));
+  }
+}
+
+uint64_t count_serial(const node_t &n)
+{
+  uint64_t count = 1;
+  for (uint32_t i = 0; i < num_children(n); i++) {
+    count += count_serial(child(n, i));
+  }
+  return count;
+}
+
+int main(int argc, char **argv)
+{
+  upcxx::init(&argc, &argv);
+
+  int num_errors = 0;
+  pool.init();
+
+  // the pool can be run again after it becomes empty
+  for (int round = 0; round < 2; round++) {
+    node_t root = { (uint64_t)round * 1000 + 1, 0 };
+    uint64_t expected = count_serial(root);
+    visited = 0;
+    if (myrank() == 0) pool.spawn(root);
+    pool.run(visit);
+
+    if (pool.local_size() != 0) num_errors++;
+    uint64_t total;
+    upcxx_reduce(&visited, &total, 1, 0, UPCXX_SUM, UPCXX_ULONG_LONG);
+    if (myrank() == 0 && total != expected) {
+      printf("round %d: visited %llu nodes, expected %llu\n", round,
+             (unsigned long long)total, (unsigned long long)expected);
+      num_errors++;
+    }
+    barrier();
+  }
+
+  if (num_errors > 0) {
+    printf("Rank %u: test_task_pool failed with %d errors!\n",
+           myrank(), num_errors);
+    gasnet_exit(1);
+  }
+
+  barrier();
+  if (myrank() == 0)
+    std::cout << "test_task_pool passed! (rank 0 stole "
+              << pool.num_stolen() << " tasks)\n";
+
+  upcxx::finalize();
+  return 0;
+}
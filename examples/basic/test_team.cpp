@@ -407,6 +407,7 @@ int main(int argc, char **argv)
     std::cout << "Testing team allgather on team_all...\n";
 
   test_allgather<size_t>(team_all, 32);
+  test_allgather<size_t>(team_all, 16384); // large enough for the ring
 
   if (myrank() == 0)
     std::cout << "Testing team alltoall on team_all...\n";
@@ -0,0 +1,82 @@
+/**
+ * \example test_update.cpp
+ *
+ * Test aggregated remote updates of shared_array and global_ptr, with
+ * small batches so that many of them fill up
+ */
+
+#include <upcxx.h>
+#include <iostream>
+#include <stdlib.h>
+
+using namespace upcxx;
+
+shared_array<uint64_t> counters;
+shared_array<double> sums;
+shared_array<int64_t> maxvals;
+
+int main(int argc, char **argv)
+{
+  setenv("UPCXX_UPDATE_BATCH_SIZE", "4", 0);
+  upcxx::init(&argc, &argv);
+
+  int num_errors = 0;
+  size_t n = 100 * ranks();
+  int iters = 50;
+  counters.init(n, 3);
+  sums.init(n);
+  maxvals.init(n, 8);
+  for (size_t i = myrank(); i < n; i += ranks()) {
+    counters[i] = 0;
+    sums[i] = 0.0;
+    maxvals[i] = -1;
+  }
+  barrier();
+
+  // a single op, which fills the batches
+  for (int k = 0; k < iters; k++) {
+    for (size_t i = 0; i < n; i++) {
+      counters.update(i, UPCXX_ATOMIC_FETCH_ADD, 1);
+    }
+  }
+
+  // every rank updates every element, mixing ops to the same targets
+  for (int k = 0; k < iters; k++) {
+    for (size_t i = 0; i < n; i++) {
+      counters.update(i, UPCXX_ATOMIC_FETCH_ADD, 1);
+      sums.update(i, UPCXX_ATOMIC_FETCH_ADD, 0.5);
+      maxvals.update(i, UPCXX_ATOMIC_FETCH_MAX, (int64_t)(myrank() * iters + k));
+    }
+  }
+  counters.flush_updates();
+  barrier();
+
+  for (size_t i = myrank(); i < n; i += ranks()) {
+    if (counters[i] != (uint64_t)(2 * iters * ranks())) num_errors++;
+    if (sums[i] != 0.5 * iters * ranks()) num_errors++;
+    if (maxvals[i] != (int64_t)(ranks() * iters - 1)) num_errors++;
+  }
+
+  // updates through global pointers
+  global_ptr<uint64_t> p = &counters[0];
+  for (int k = 0; k < iters; k++) {
+    atomic_update(p, UPCXX_ATOMIC_FETCH_SUB, 1);
+  }
+  update_flush();
+  barrier();
+  if (counters[0] != (uint64_t)(2 * iters * ranks() - iters * ranks()))
+    num_errors++;
+
+  if (num_errors > 0) {
+    printf("Rank %u: test_update failed with %d errors!\n",
+           myrank(), num_errors);
+    gasnet_exit(1);
+  }
+
+  barrier();
+  if (myrank() == 0)
+    std::cout << "test_update passed!\n";
+
+  upcxx::finalize();
+  return 0;
+}
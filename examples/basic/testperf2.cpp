@@ -19,6 +19,7 @@ using namespace std;
 
 shared_var<int> sv = 0;
 shared_lock sl;
+shared_rwlock rwl;
 
 int main (int argc, char **arsv)
 {
@@ -52,6 +53,36 @@ int main (int argc, char **arsv)
   printf("myrank() %d: lock time %lg (us), unlock time % lg (us), shared variable access time (read+write) %lg (us)\n",
          myrank(), (double)total_time1/niters, (double)total_time3/niters, (double)total_time2/niters);
 
+  barrier();
+
+  // reader-writer lock with different percentages of writes
+  int write_pcts[] = {0, 10, 50, 100};
+  long checksum = 0; // keeps the reads from being optimized away
+  for (int p = 0; p < 4; p++) {
+    barrier();
+    start_time = TIME();
+    for (int i = 0; i < niters; i++) {
+      if (i % 100 < write_pcts[p]) {
+        rwl.write_lock();
+        sv = sv + 1;
+        rwl.write_unlock();
+      } else {
+        rwl.read_lock();
+        checksum += sv;
+        rwl.read_unlock();
+      }
+    }
+    total_time1 = TIME() - start_time;
+    barrier();
+    if (myrank() == 0) {
+      printf("rwlock with %d%% writes: average time per critical section %lg (us)\n",
+             write_pcts[p], (double)total_time1/niters);
+    }
+  }
+  if (myrank() == 0) {
+    printf("checksum of the values read %ld\n", checksum);
+  }
+
   barrier();
   finalize();
 
@@ -0,0 +1,97 @@
+/*
+ * testperf_allgather: compare upcxx_allgather with an allgather done
+ * as a gather to rank 0 followed by a broadcast through a temporary
+ * buffer in the segment
+ *
+ * Usage: testperf_allgather [max_bytes_per_rank] [iterations]
+ */
+
+#include <upcxx.h>
+
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+
+using namespace upcxx;
+using namespace std;
+
+#define TIME() gasnett_ticks_to_us(gasnett_ticks_now())
+
+void gather_bcast_allgather(void *src, void *dst, size_t nbytes)
+{
+  void *temp = allocate(nbytes * ranks());
+  assert(temp != NULL);
+  upcxx_gather(src, temp, nbytes, 0);
+  upcxx_bcast(temp, dst, nbytes * ranks(), 0);
+  deallocate(temp);
+}
+
+int check(const vector<char> &dst, size_t nbytes, int iter)
+{
+  for (rank_t r = 0; r < ranks(); r++) {
+    for (size_t i = 0; i < nbytes; i++) {
+      if (dst[r * nbytes + i] != (char)(r + i + iter)) return 1;
+    }
+  }
+  return 0;
+}
+
+// Return the average time of an allgather in microseconds
+double time_allgather(void (*fn)(void *, void *, size_t), size_t nbytes,
+                      int iters, int *errors)
+{
+  vector<char> src(nbytes);
+  vector<char> dst(nbytes * ranks());
+  double total = 0;
+
+  for (int iter = 0; iter < iters; iter++) {
+    for (size_t i = 0; i < nbytes; i++) src[i] = (char)(myrank() + i + iter);
+    barrier();
+    gasnett_tick_t start = TIME();
+    fn(&src[0], &dst[0], nbytes);
+    total += TIME() - start;
+    *errors += check(dst, nbytes, iter);
+  }
+  return total / iters;
+}
+
+void native_allgather(void *src, void *dst, size_t nbytes)
+{
+  upcxx_allgather(src, dst, nbytes);
+}
+
+int main(int argc, char **argv)
+{
+  upcxx::init(&argc, &argv);
+
+  size_t max_bytes = 1 << 18;
+  int iters = 20;
+  if (argc > 1) max_bytes = atol(argv[1]);
+  if (argc > 2) iters = atoi(argv[2]);
+
+  int errors = 0;
+  if (myrank() == 0) {
+    printf("allgather on %u ranks, average time in us\n", ranks());
+    printf("%12s %14s %14s\n", "bytes/rank", "gather+bcast", "native");
+  }
+  for (size_t nbytes = 8; nbytes <= max_bytes; nbytes *= 4) {
+    double t_old = time_allgather(gather_bcast_allgather, nbytes, iters, &errors);
+    double t_new = time_allgather(native_allgather, nbytes, iters, &errors);
+    if (myrank() == 0) {
+      printf("%12lu %14.2f %14.2f\n", (unsigned long)nbytes, t_old, t_new);
+    }
+  }
+
+  if (errors > 0) {
+    printf("Rank %u: testperf_allgather failed with %d errors!\n",
+           myrank(), errors);
+    gasnet_exit(1);
+  }
+
+  barrier();
+  if (myrank() == 0)
+    cout << "testperf_allgather passed!\n";
+
+  upcxx::finalize();
+  return 0;
+}
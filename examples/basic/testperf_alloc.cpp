@@ -0,0 +1,108 @@
+/*
+ * testperf_alloc: stress test the performance of global memory
+ * allocation and deallocation
+ *
+ * Each thread keeps a working set of blocks of random sizes and
+ * repeatedly frees a random block and allocates a new one.  With a
+ * thread-safe build, several threads per rank allocate concurrently.
+ *
+ * Usage: testperf_alloc [num_threads] [num_iterations]
+ */
+
+#include <upcxx.h>
+
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#ifdef UPCXX_THREAD_SAFE
+#include <pthread.h>
+#endif
+
+using namespace upcxx;
+using namespace std;
+
+#define TIME() gasnett_ticks_to_us(gasnett_ticks_now())
+
+#define WORKING_SET 256
+#define MAX_BLOCK_SIZE 8192
+
+int niters = 100000;
+int num_errors = 0;
+
+void *stress(void *arg)
+{
+  unsigned int seed = (unsigned int)(size_t)arg + myrank() * 1000;
+  vector<char *> blocks(WORKING_SET, (char *)NULL);
+  vector<size_t> sizes(WORKING_SET, 0);
+  int errors = 0;
+
+  for (int i = 0; i < niters; i++) {
+    int k = rand_r(&seed) % WORKING_SET;
+    if (blocks[k] != NULL) {
+      // check that nobody else has written into the block
+      if (blocks[k][0] != (char)k || blocks[k][sizes[k] - 1] != (char)k) errors++;
+      deallocate(blocks[k]);
+    }
+    // mostly small blocks with a few large ones
+    sizes[k] = (rand_r(&seed) % 8 == 0) ?
+      rand_r(&seed) % MAX_BLOCK_SIZE + 1 : rand_r(&seed) % 256 + 1;
+    blocks[k] = allocate<char>(sizes[k]);
+    if (blocks[k] == NULL) {
+      fprintf(stderr, "Rank %u: out of global memory\n", myrank());
+      gasnet_exit(1);
+    }
+    blocks[k][0] = (char)k;
+    blocks[k][sizes[k] - 1] = (char)k;
+  }
+
+  for (int k = 0; k < WORKING_SET; k++) {
+    if (blocks[k] != NULL) deallocate(blocks[k]);
+  }
+  __sync_fetch_and_add(&num_errors, errors);
+  return NULL;
+}
+
+int main(int argc, char **argv)
+{
+  init(&argc, &argv);
+
+  int nthreads = 1;
+#ifdef UPCXX_THREAD_SAFE
+  if (argc > 1) nthreads = atoi(argv[1]);
+#endif
+  if (argc > 2) niters = atoi(argv[2]);
+
+  barrier();
+
+  int64_t start_time = TIME();
+#ifdef UPCXX_THREAD_SAFE
+  vector<pthread_t> threads(nthreads);
+  for (int t = 0; t < nthreads; t++) {
+    pthread_create(&threads[t], NULL, stress, (void *)(size_t)t);
+  }
+  for (int t = 0; t < nthreads; t++) {
+    pthread_join(threads[t], NULL);
+  }
+#else
+  stress(NULL);
+#endif
+  int64_t total_time = TIME() - start_time;
+
+  barrier();
+
+  if (num_errors > 0) {
+    printf("Rank %u: testperf_alloc found %d corrupted blocks!\n",
+           myrank(), num_errors);
+    gasnet_exit(1);
+  }
+
+  double nops = 2.0 * niters * nthreads; // one allocate and one deallocate per iteration
+  printf("myrank() %d: %d threads, %lg allocate+deallocate ops in %lg (s), %lg Mops/s\n",
+         myrank(), nthreads, nops, (double)total_time * 1e-6, nops / total_time);
+
+  barrier();
+  finalize();
+
+  return 0;
+}
@@ -0,0 +1,108 @@
+/*
+ * testperf_dist_hash_map: measure the throughput of dist_hash_map
+ *
+ * Each rank inserts, finds and erases random keys, most of which are
+ * owned by other ranks.  Run it on different numbers of ranks to see
+ * how the throughput scales.
+ *
+ * Usage: testperf_dist_hash_map [ops_per_rank] [window]
+ *
+ * window is the number of operations in flight per rank.
+ */
+
+#include <upcxx.h>
+
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+
+using namespace upcxx;
+using namespace std;
+
+#define TIME() gasnett_ticks_to_us(gasnett_ticks_now())
+
+dist_hash_map<uint64_t, uint64_t> m;
+
+uint64_t nops = 100000;
+uint64_t window = 10000;
+
+static inline uint64_t key_of(uint64_t i)
+{
+  // distinct pseudo-random keys per rank
+  return (i * 0x9E3779B97F4A7C15ULL) ^ ((uint64_t)myrank() << 48);
+}
+
+enum op_t { OP_INSERT, OP_FIND, OP_ERASE };
+
+// Run nops operations in windows and return the number of failed ones
+uint64_t run(const char *name, op_t op)
+{
+  bool *results = new bool[window];
+  vector< pair<bool, uint64_t> > values(window);
+  uint64_t failed = 0;
+
+  barrier();
+  gasnett_tick_t start = TIME();
+  for (uint64_t i = 0; i < nops; i += window) {
+    uint64_t n = (nops - i < window) ? nops - i : window;
+    event e;
+    for (uint64_t j = 0; j < n; j++) {
+      uint64_t k = key_of(i + j);
+      switch (op) {
+      case OP_INSERT: m.insert(k, i + j, &results[j], &e); break;
+      case OP_FIND:   m.find(k, &values[j], &e); break;
+      case OP_ERASE:  m.erase(k, &results[j], &e); break;
+      }
+    }
+    e.wait();
+    for (uint64_t j = 0; j < n; j++) {
+      if (op == OP_FIND) {
+        if (!values[j].first || values[j].second != i + j) failed++;
+      } else if (!results[j]) {
+        failed++;
+      }
+    }
+  }
+  barrier();
+  double elapsed = (TIME() - start) * 1e-6;
+
+  if (myrank() == 0) {
+    printf("%-6s %u ranks: %.6f s, %.3f Mops/s total, %.3f Mops/s per rank\n",
+           name, ranks(), elapsed, nops * ranks() * 1e-6 / elapsed,
+           nops * 1e-6 / elapsed);
+  }
+  delete [] results;
+  return failed;
+}
+
+int main(int argc, char **argv)
+{
+  upcxx::init(&argc, &argv);
+
+  if (argc > 1) nops = atol(argv[1]);
+  if (argc > 2) window = atol(argv[2]);
+  if (window < 1) window = 1;
+
+  m.init(nops);
+
+  uint64_t failed = 0;
+  failed += run("insert", OP_INSERT);
+  failed += run("find", OP_FIND);
+  failed += run("erase", OP_ERASE);
+
+  if (m.local_size() != 0) failed++;
+  m.destroy();
+
+  if (failed > 0) {
+    printf("Rank %u: testperf_dist_hash_map failed with %llu errors!\n",
+           myrank(), (unsigned long long)failed);
+    gasnet_exit(1);
+  }
+
+  barrier();
+  if (myrank() == 0)
+    cout << "testperf_dist_hash_map passed!\n";
+
+  upcxx::finalize();
+  return 0;
+}
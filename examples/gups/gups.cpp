@@ -29,6 +29,7 @@ using namespace upcxx;
 #define PERIOD    1317624576693539401LL
 
 shared_array<uint64_t> Table;
+typedef shared_array<uint64_t>::local_view_t table_view_t;
 
 double get_time()
 {
@@ -83,11 +84,14 @@ void RandomAccessUpdate()
 
 uint64_t RandomAccessVerify()
 {
-  uint64_t i, localerrors, errors;
+  uint64_t localerrors, errors;
   localerrors = 0;
-  for (i = myrank(); i < TableSize; i += ranks()) {
-    if (Table[i] != i) {
-      localerrors++;
+  table_view_t lt = Table.local_view();
+  for (table_view_t::iterator it = lt.begin(); it != lt.end(); ++it) {
+    for (size_t j = 0; j < it->size; j++) {
+      if (it->data[j] != it->global_index + j) {
+        localerrors++;
+      }
     }
   }
   upcxx_reduce(&localerrors, &errors, 1, 0, UPCXX_SUM, UPCXX_ULONG_LONG);
@@ -114,9 +118,11 @@ int main(int argc, char **argv)
   barrier(); // upc_barrier;
 
   time = get_time();
-  uint64_t * lt = (uint64_t *) &Table[myrank()];
-  for (uint64_t i = myrank(); i < TableSize; i += ranks()) {
-    *lt++ = i;
+  table_view_t lt = Table.local_view();
+  for (table_view_t::iterator it = lt.begin(); it != lt.end(); ++it) {
+    for (size_t j = 0; j < it->size; j++) {
+      it->data[j] = it->global_index + j;
+    }
   }
 
   barrier();
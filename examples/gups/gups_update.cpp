@@ -0,0 +1,163 @@
+/**
+ * \example gups_update.cpp
+ *
+ * Random Access (GUPS) benchmark comparing element-wise atomic updates
+ * through global_ref (each ^= is one blocking remote atomic) with
+ * atomic updates aggregated per owner (shared_array::update)
+ *
+ * This program uses SPMD execution model.
+ *
+ */
+
+#include <upcxx.h>
+
+#include <stdio.h>
+#include <sys/time.h>
+#include <stdint.h> // for int64_t and uint64_t
+
+using namespace upcxx;
+
+#ifndef N
+#define N (20)
+#endif
+
+#define TableSize (1ULL<<N)
+#define NUPDATE   (4ULL * TableSize)
+
+#define POLY      0x0000000000000007ULL
+#define PERIOD    1317624576693539401LL
+
+shared_array<uint64_t> Table;
+typedef shared_array<uint64_t>::local_view_t table_view_t;
+
+double get_time()
+{
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return tv.tv_sec + ((double) tv.tv_usec / 1000000);
+}
+
+uint64_t starts(int64_t n)
+{
+  int i;
+  uint64_t m2[64];
+  uint64_t temp, ran;
+
+  while (n < 0)         n += PERIOD;
+  while (n > PERIOD)    n -= PERIOD;
+
+  if (n == 0)           return 0x1;
+
+  temp = 0x1;
+  for (i=0; i<64; i++) {
+    m2[i] = temp;
+    temp = (temp << 1) ^ ((int64_t) temp < 0 ? POLY : 0);
+    temp = (temp << 1) ^ ((int64_t) temp < 0 ? POLY : 0);
+  }
+
+  for (i=62; i>=0; i--) if ((n >> i) & 1) break;
+
+  ran = 0x2;
+  while (i > 0) {
+    temp = 0;
+    for (int j=0; j<64; j++) if ((ran >> j) & 1) temp ^= m2[j];
+    ran = temp;
+    i -= 1;
+    if ((n >> i) & 1)  ran = (ran << 1) ^ ((int64_t) ran < 0 ? POLY : 0);
+  }
+
+  return ran;
+}
+
+// One blocking remote atomic (one round trip) per update
+void RandomAccessUpdateRef()
+{
+  uint64_t i;
+  uint64_t ran = starts(NUPDATE / ranks() * myrank());
+
+  for (i = myrank(); i < NUPDATE; i += ranks()) {
+    ran = (ran << 1) ^ (((int64_t) ran < 0) ? POLY : 0);
+    Table[ran & (TableSize-1)] ^= ran;
+  }
+  barrier();
+}
+
+// Atomic updates aggregated per owner
+void RandomAccessUpdateBatched()
+{
+  uint64_t i;
+  uint64_t ran = starts(NUPDATE / ranks() * myrank());
+
+  for (i = myrank(); i < NUPDATE; i += ranks()) {
+    ran = (ran << 1) ^ (((int64_t) ran < 0) ? POLY : 0);
+    Table.update(ran & (TableSize-1), UPCXX_ATOMIC_FETCH_XOR, ran);
+  }
+  Table.flush_updates();
+  barrier();
+}
+
+void InitTable()
+{
+  table_view_t lt = Table.local_view();
+  for (table_view_t::iterator it = lt.begin(); it != lt.end(); ++it) {
+    for (size_t j = 0; j < it->size; j++) {
+      it->data[j] = it->global_index + j;
+    }
+  }
+  barrier();
+}
+
+uint64_t RandomAccessVerify()
+{
+  uint64_t localerrors, errors;
+  localerrors = 0;
+  table_view_t lt = Table.local_view();
+  for (table_view_t::iterator it = lt.begin(); it != lt.end(); ++it) {
+    for (size_t j = 0; j < it->size; j++) {
+      if (it->data[j] != it->global_index + j) {
+        localerrors++;
+      }
+    }
+  }
+  upcxx_reduce(&localerrors, &errors, 1, 0, UPCXX_SUM, UPCXX_ULONG_LONG);
+  return errors;
+}
+
+// Time one mode of updates and verify it by undoing the updates
+void run(const char *name, void (*update)())
+{
+  InitTable();
+
+  double time = get_time();
+  update();
+  time = get_time() - time;
+
+  update(); // do it again to restore the table
+  uint64_t errors = RandomAccessVerify();
+
+  if (myrank() == 0) {
+    printf("%s: %.6f seconds, %.9f GUP/s, verification %s (%llu errors in %llu updates)\n",
+           name, time, (double)NUPDATE * 1e-9 / time,
+           ((double)errors/NUPDATE < 0.01) ? "SUCCESS" : "FAILED",
+           (unsigned long long)errors, (unsigned long long)NUPDATE);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  upcxx::init(&argc, &argv);
+  Table.init(TableSize);
+
+  if (myrank() == 0) {
+    printf("\nTable size = %g MBytes/CPU, %g MB/total on %d threads\n\n",
+           (double)TableSize*8/1024/1024/ranks(),
+           (double)TableSize*8/1024/1024,
+           ranks());
+  }
+
+  run("global_ref updates", RandomAccessUpdateRef);
+  run("aggregated updates", RandomAccessUpdateBatched);
+
+  upcxx::finalize();
+  return 0;
+}
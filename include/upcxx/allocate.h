@@ -4,10 +4,29 @@
 
 #pragma once
 
+#include <vector>
+
 #include "global_ptr.h"
+#include "segment_stats.h"
 
 namespace upcxx
 {
+  /// \cond SHOW_INTERNAL
+  /*
+   * Allocate count blocks of the given sizes on rank and store the
+   * global pointers in ptrs.  Event e is signaled when done.
+   */
+  void allocate_nb(rank_t rank, size_t count, const size_t *sizes,
+                   global_ptr<void> *ptrs, event *e);
+
+  // Allocate nbytes in the local segment on behalf of class c of callers
+  void *seg_allocate(size_t nbytes, seg_alloc_class_t c);
+
+  // symmetric_heap_delta[r] is the distance from the symmetric heap of
+  // the calling rank to that of rank r (symmetric.cpp)
+  extern ptrdiff_t *symmetric_heap_delta;
+  /// \endcond
+
   /**
    * \ingroup gasgroup
    * \brief allocate memory in the global address space of a rank (process)
@@ -40,6 +59,22 @@ namespace upcxx
     return global_ptr<T>(allocate(rank, nbytes));
   }
 
+  /**
+   * \ingroup gasgroup
+   * \brief allocate count elements of type T in the global address
+   * space of a rank without blocking
+   */
+  template<typename T>
+  value_future< global_ptr<T> > async_allocate(rank_t rank, size_t count)
+  {
+    value_future< global_ptr<T> > f;
+    size_t nbytes = count * sizeof(T);
+    // global_ptr<T> has the same layout as global_ptr<void>
+    allocate_nb(rank, 1, &nbytes, (global_ptr<void> *)f.value_addr(),
+                f.get_event());
+    return f;
+  }
+
   template<typename T>
   T* allocate(size_t count)
   {
@@ -47,6 +82,37 @@ namespace upcxx
     return (T*)allocate(nbytes);
   }
 
+  /**
+   * \ingroup gasgroup
+   * \brief allocate memory in the global address space of a rank
+   * without blocking
+   *
+   * \return a future of the pointer to the allocated space
+   * \param rank the rank_t where the memory space should be allocated
+   * \param nbytes the number of bytes to allocate
+   */
+  value_future< global_ptr<void> > async_allocate(rank_t rank, size_t nbytes);
+
+  /**
+   * \ingroup gasgroup
+   * \brief allocate multiple blocks in the global address space of a
+   * rank with one message
+   *
+   * \return the pointers to the allocated blocks
+   * \param rank the rank_t where the memory space should be allocated
+   * \param sizes the sizes in bytes of the blocks
+   */
+  std::vector< global_ptr<void> > allocate(rank_t rank,
+                                           const std::vector<size_t> &sizes);
+
+  /**
+   * \ingroup gasgroup
+   * \brief free memory in the global address space
+   *
+   * Frees of memory on other ranks are queued and sent to each rank
+   * in batches, so the memory may be reused only after the caller
+   * makes progress (e.g., by advance() or waiting on an event).
+   */
   void deallocate(global_ptr<void> ptr);
 
   void deallocate(void *ptr);
@@ -64,4 +130,51 @@ namespace upcxx
   {
     deallocate(global_ptr<void>(ptr));
   }
+
+  /**
+   * \ingroup gasgroup
+   * \brief collectively allocate memory at the same offset of the
+   * symmetric heap on every rank
+   *
+   * All ranks must call symmetric_allocate() and symmetric_deallocate()
+   * in the same order with the same sizes.  The copy of the block on
+   * any rank can then be addressed by symmetric_addr() without any
+   * communication or per-allocation pointer table.  The symmetric heap
+   * is the bottom UPCXX_SYMMETRIC_HEAP_SIZE bytes of the GASNet segment
+   * (at most half of the smallest segment), which are not available to
+   * allocate().  It is disabled by default (0), in which case symmetric
+   * shared arrays use a pointer table instead.
+   *
+   * \return the local address of the block, or NULL on all ranks if the
+   * symmetric heap is disabled or exhausted
+   * \param nbytes the number of bytes to allocate on each rank
+   */
+  void *symmetric_allocate(size_t nbytes, seg_alloc_class_t c = SEG_ALLOC_USER);
+
+  template<typename T>
+  T *symmetric_allocate(size_t count)
+  {
+    return (T *)symmetric_allocate(count * sizeof(T));
+  }
+
+  /**
+   * \ingroup gasgroup
+   * \brief collectively free a block from symmetric_allocate()
+   */
+  void symmetric_deallocate(void *ptr);
+
+  /**
+   * \ingroup gasgroup
+   * \brief the address on rank r of the symmetric block at local address p
+   */
+  static inline void *symmetric_addr(const void *p, rank_t r)
+  {
+    return (char *)p + symmetric_heap_delta[r];
+  }
+
+  template<typename T>
+  global_ptr<T> symmetric_ptr(T *p, rank_t r)
+  {
+    return global_ptr<T>((T *)symmetric_addr(p, r), r);
+  }
 } // namespace upcxx
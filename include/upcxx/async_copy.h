@@ -94,6 +94,60 @@ namespace upcxx
     return async_copy(global_ptr<T>(src), dst, count, done_event);
   }
 
+  /**
+   * \ingroup gasgroup
+   * \brief Non-blocking copy with separate local and remote completion
+   *
+   * local_completion is signaled when the local buffer can be reused
+   * (the src buffer for a put and the dst buffer for a get), and
+   * remote_completion is signaled when the whole transfer is done.  For
+   * a put, the src buffer is reusable as soon as this function returns,
+   * so local_completion is never left pending.  Either event may be NULL
+   * if the caller is not interested in it.
+   *
+   * \param src the pointer of src data
+   * \param dst the pointer of dst data
+   * \param nbytes the number of bytes to be transferred
+   * \param local_completion event signaled when the local buffer can be reused
+   * \param remote_completion event signaled when the transfer is complete
+   */
+  int async_copy(global_ptr<void> src,
+                 global_ptr<void> dst,
+                 size_t nbytes,
+                 event *local_completion,
+                 event *remote_completion);
+
+  template<typename T>
+  int async_copy(global_ptr<T> src,
+                 global_ptr<T> dst,
+                 size_t count,
+                 event *local_completion,
+                 event *remote_completion)
+  {
+    size_t nbytes = count * sizeof(T);
+    return async_copy((global_ptr<void>)src,
+                      (global_ptr<void>)dst,
+                      nbytes,
+                      local_completion,
+                      remote_completion);
+  }
+
+  template<typename T>
+  inline int async_copy(global_ptr<T> src, T* dst, size_t count,
+                        event *local_completion, event *remote_completion)
+  {
+    return async_copy(src, global_ptr<T>(dst), count,
+                      local_completion, remote_completion);
+  }
+
+  template<typename T>
+  inline int async_copy(T* src, global_ptr<T> dst, size_t count,
+                        event *local_completion, event *remote_completion)
+  {
+    return async_copy(global_ptr<T>(src), dst, count,
+                      local_completion, remote_completion);
+  }
+
   /**
    * \ingroup gasgroup
    * \brief Non-blocking signaling copy, which first performs an async copy
@@ -152,6 +206,17 @@ namespace upcxx
                                  remote_completion);
   }
 
+  /**
+   * \ingroup gasgroup
+   * \brief Return the number of copies whose local buffer was outside of
+   * the GASNet segment and had to be staged through segment buffers
+   *
+   * Staging can be disabled by setting UPCXX_STAGE_NONSEG_COPY=no.  The
+   * bounce buffers used by blocking copies are configured by
+   * UPCXX_NUM_BOUNCE_BUFS and UPCXX_BOUNCE_BUF_SIZE.
+   */
+  uint64_t staged_copy_count();
+
   /**
    * async_copy_fence is deprecated. Please use async_wait() instead.
    */
@@ -1,6 +1,14 @@
 /**
  * atomic.h - atomic operations
  *
+ * Remote atomic operations on 32-bit and 64-bit integers and on
+ * floating-point numbers in the global address space.  The operations
+ * are executed as CPU atomics on the rank that owns the data, either
+ * directly when the data are in the same shared-memory node or by an
+ * active message handler otherwise.  So remote atomics on the same
+ * location are atomic with respect to each other, regardless of where
+ * they come from.
+ *
  * This is currently an experimental feature for preview.
  */
 
@@ -9,9 +17,97 @@
 #include "gasnet_api.h"
 #include "event.h"
 #include "global_ptr.h"
+#include "atomic_defs.h"
 
 namespace upcxx
 {
+  /// \cond SHOW_INTERNAL
+  struct atomic_am_t {
+    void *addr;
+    void *result_addr;
+    event *cb_event;
+    int type;
+    int op;
+    char operand1[8];
+    char operand2[8];
+  };
+
+  struct atomic_reply_t {
+    void *result_addr;
+    event *cb_event;
+    int type;
+    char result[8];
+  };
+
+  void atomic_am_handler(gasnet_token_t token, void *buf, size_t nbytes);
+  void atomic_reply_handler(gasnet_token_t token, void *buf, size_t nbytes);
+
+  /*
+   * Apply op with value to the object at addr on rank r without
+   * returning the old value.  Updates to other shared-memory nodes are
+   * queued per target and applied by the owner in batches.  Each
+   * queued update carries its own type and op, so mixed updates to a
+   * target share a batch.  The updates are sent when a batch is full,
+   * by advance(), or by update_flush().
+   */
+  void update_nb(rank_t r, void *addr, atomic_type_t type, atomic_op_t op,
+                 const void *value);
+
+  // Send the queued updates without waiting
+  void send_updates();
+
+  // UPDATE_AM carries an array of update_entry_t's
+  struct update_entry_t {
+    void *addr;
+    char value[8];
+    int type;
+    int op;
+  };
+
+  void update_am_handler(gasnet_token_t token, void *buf, size_t nbytes);
+  void update_reply_handler(gasnet_token_t token);
+
+  // Make the value argument of the remote atomics a non-deduced context
+  // so that, e.g., fetch_add(ptr, 1) works for any integer pointer type
+  template<typename T> struct atomic_identity { typedef T type; };
+
+  template<typename T>
+  inline T atomic_op(global_ptr<T> obj, atomic_op_t op,
+                     T operand1 = T(), T operand2 = T())
+  {
+    event e;
+    T old_val;
+    atomic_op_nb(obj.where(), obj.raw_ptr(), atomic_type_traits<T>::type, op,
+                 &operand1, &operand2, &old_val, &e);
+    atomic_flush(obj.where());
+    e.wait();
+    return old_val;
+  }
+
+  template<typename T>
+  inline void async_atomic_op(global_ptr<T> obj, atomic_op_t op,
+                              T operand1, T operand2,
+                              T *old_val, event *e)
+  {
+    atomic_op_nb(obj.where(), obj.raw_ptr(), atomic_type_traits<T>::type, op,
+                 &operand1, &operand2, old_val, e);
+  }
+
+  template<typename T>
+  inline value_future<T> async_atomic_op(global_ptr<T> obj, atomic_op_t op,
+                                         T operand1 = T(), T operand2 = T())
+  {
+    value_future<T> f;
+    async_atomic_op(obj, op, operand1, operand2, f.value_addr(), f.get_event());
+    return f;
+  }
+  /// \endcond
+
+  /**
+   * \ingroup syncgroup
+   * A value of type T that supports atomic operations both locally
+   * and remotely (through global_ptr< atomic<T> >)
+   */
   template<typename T>
   struct atomic {
   public:
@@ -21,94 +117,221 @@ namespace upcxx
     inline atomic() : _data()
     { }
 
-    inline T load() { return _data; }
-    inline void store(const T& val) { _data = val; }
+    inline T load() { return atomic_apply(&_data, UPCXX_ATOMIC_LOAD, T(), T()); }
+    inline void store(const T& val) { atomic_apply(&_data, UPCXX_ATOMIC_STORE, val, T()); }
 
     inline T fetch_add(const T& add_val)
     {
-      // no threading
-      T old = _data;
-      _data += add_val;
-      return old;
+      return atomic_apply(&_data, UPCXX_ATOMIC_FETCH_ADD, add_val, T());
     }
-    
+
   private:
     T _data;
-    // mutex
   };
 
+  /**
+   * \ingroup syncgroup
+   * Atomically read the remote object
+   */
   template<typename T>
-  struct fetch_add_am_t {
-    atomic<T> *obj;
-    T add_val;
-    T* old_val_addr;
-    event* cb_event;
-  };
+  inline T atomic_load(global_ptr<T> obj)
+  {
+    return atomic_op(obj, UPCXX_ATOMIC_LOAD);
+  }
 
+  /**
+   * \ingroup syncgroup
+   * Atomically write val to the remote object
+   */
   template<typename T>
-  struct fetch_add_reply_t {
-    T old_val;
-    T* old_val_addr;
-    event* cb_event;
-  };
+  inline void atomic_store(global_ptr<T> obj, typename atomic_identity<T>::type val)
+  {
+    atomic_op(obj, UPCXX_ATOMIC_STORE, val);
+  }
 
-  #ifdef UPCXX_HAVE_CXX11
-  template<typename T = uint64_t>
-  #else
+  /**
+   * \ingroup syncgroup
+   * Atomically replace the remote object with val and return its old value
+   */
   template<typename T>
-  #endif
-  static void fetch_add_am_handler(gasnet_token_t token, void *buf, size_t nbytes)
+  inline T atomic_swap(global_ptr<T> obj, typename atomic_identity<T>::type val)
   {
-    fetch_add_am_t<T> *am = (fetch_add_am_t<T> *)buf;
-    fetch_add_reply_t<T> reply;
-
-    // if no threading
-    reply.old_val = am->obj->fetch_add(am->add_val);
-    reply.old_val_addr = am->old_val_addr;
-    reply.cb_event = am->cb_event; // callback event on the src rank
-    // YZ: should use a different GASNet AM handler id for different type T
-    GASNET_SAFE(gasnet_AMReplyMedium0(token, FETCH_ADD_U64_REPLY,
-                                      &reply, sizeof(reply)));
+    return atomic_op(obj, UPCXX_ATOMIC_SWAP, val);
   }
 
-  #ifdef UPCXX_HAVE_CXX11
-  template<typename T = uint64_t>
-  #else
+  /**
+   * \ingroup syncgroup
+   * Atomically replace the remote object with desired if it equals
+   * expected.  Return true on success; otherwise expected is updated
+   * with the current value of the object.
+   */
   template<typename T>
-  #endif
-  static void fetch_add_reply_handler(gasnet_token_t token, void *buf, size_t nbytes)
+  inline bool compare_exchange(global_ptr<T> obj,
+                               T &expected,
+                               typename atomic_identity<T>::type desired)
   {
-    fetch_add_reply_t<T> *reply = (fetch_add_reply_t<T> *)buf;
+    T old_val = atomic_op(obj, UPCXX_ATOMIC_CAS, expected, desired);
+    bool success = (memcmp(&old_val, &expected, sizeof(T)) == 0);
+    expected = old_val;
+    return success;
+  }
 
-    *reply->old_val_addr = reply->old_val;
-    reply->cb_event->decref();
+#define UPCXX_ATOMIC_FETCH_OP_DECL(name, op_code)                       \
+  template<typename T>                                                  \
+  inline T name(global_ptr<T> obj, typename atomic_identity<T>::type val) \
+  {                                                                     \
+    return atomic_op(obj, op_code, val);                                \
+  }                                                                     \
+                                                                        \
+  template<typename T>                                                  \
+  inline T name(global_ptr<atomic<T> > obj,                             \
+                typename atomic_identity<T>::type val)                  \
+  {                                                                     \
+    return atomic_op(global_ptr<T>(obj), op_code, val);                 \
   }
 
   /**
-   * Atomic fetch-and-add: atomically add val to the atomic obj and
-   * then return the old value of the atomic object
+   * \ingroup syncgroup
+   * Atomic fetch-and-op: atomically apply op with val to the remote
+   * object and then return the old value of the object.  The bitwise
+   * operations are only supported for integer types.
    */
-  inline
-  uint64_t fetch_add(global_ptr<atomic<uint64_t> > obj, uint64_t add_val)
+  UPCXX_ATOMIC_FETCH_OP_DECL(fetch_add, UPCXX_ATOMIC_FETCH_ADD)
+  UPCXX_ATOMIC_FETCH_OP_DECL(fetch_sub, UPCXX_ATOMIC_FETCH_SUB)
+  UPCXX_ATOMIC_FETCH_OP_DECL(fetch_and, UPCXX_ATOMIC_FETCH_AND)
+  UPCXX_ATOMIC_FETCH_OP_DECL(fetch_or,  UPCXX_ATOMIC_FETCH_OR)
+  UPCXX_ATOMIC_FETCH_OP_DECL(fetch_xor, UPCXX_ATOMIC_FETCH_XOR)
+  UPCXX_ATOMIC_FETCH_OP_DECL(fetch_min, UPCXX_ATOMIC_FETCH_MIN)
+  UPCXX_ATOMIC_FETCH_OP_DECL(fetch_max, UPCXX_ATOMIC_FETCH_MAX)
+
+#undef UPCXX_ATOMIC_FETCH_OP_DECL
+
+  /**
+   * \ingroup syncgroup
+   * Non-blocking atomic read of the remote object.  The first form
+   * returns a future holding the value.  The second form writes the
+   * value to *val and signals event e when done.
+   */
+  template<typename T>
+  inline value_future<T> async_atomic_load(global_ptr<T> obj)
   {
-    event e;
-    uint64_t old_val;
-    fetch_add_am_t<uint64_t> am;
-
-    gasnet_AMPoll(); // process other AMs to be fair
-
-    am.obj = obj.raw_ptr();
-    am.add_val = add_val;
-    am.old_val_addr = &old_val;
-    am.cb_event = &e;
-    e.incref();
-    
-    // YZ: should use a different GASNet AM handler id for different type T
-    GASNET_SAFE(gasnet_AMRequestMedium0(obj.where(), FETCH_ADD_U64_AM, &am, sizeof(am)));
-    e.wait();
+    return async_atomic_op(obj, UPCXX_ATOMIC_LOAD);
+  }
 
-    gasnet_AMPoll(); // process other AMs to be fair
+  template<typename T>
+  inline void async_atomic_load(global_ptr<T> obj, T *val,
+                                event *e = peek_event())
+  {
+    async_atomic_op(obj, UPCXX_ATOMIC_LOAD, T(), T(), val, e);
+  }
 
-    return old_val;
+  /**
+   * \ingroup syncgroup
+   * Non-blocking atomic write of val to the remote object, which
+   * signals event e when done
+   */
+  template<typename T>
+  inline void async_atomic_store(global_ptr<T> obj,
+                                 typename atomic_identity<T>::type val,
+                                 event *e = peek_event())
+  {
+    async_atomic_op(obj, UPCXX_ATOMIC_STORE, val, T(), (T *)NULL, e);
+  }
+
+  /**
+   * \ingroup syncgroup
+   * Non-blocking compare-and-swap: replace the remote object with
+   * desired if it equals expected.  The old value of the object is
+   * returned in the future (or written to *old_val), so the operation
+   * succeeded if the old value equals expected.
+   */
+  template<typename T>
+  inline value_future<T> async_compare_exchange(global_ptr<T> obj,
+                                                typename atomic_identity<T>::type expected,
+                                                typename atomic_identity<T>::type desired)
+  {
+    return async_atomic_op(obj, UPCXX_ATOMIC_CAS, expected, desired);
+  }
+
+  template<typename T>
+  inline void async_compare_exchange(global_ptr<T> obj,
+                                     typename atomic_identity<T>::type expected,
+                                     typename atomic_identity<T>::type desired,
+                                     T *old_val,
+                                     event *e = peek_event())
+  {
+    async_atomic_op(obj, UPCXX_ATOMIC_CAS, expected, desired, old_val, e);
+  }
+
+#define UPCXX_ASYNC_ATOMIC_OP_DECL(name, op_code)                       \
+  template<typename T>                                                  \
+  inline value_future<T> name(global_ptr<T> obj,                        \
+                              typename atomic_identity<T>::type val)    \
+  {                                                                     \
+    return async_atomic_op(obj, op_code, val);                          \
+  }                                                                     \
+                                                                        \
+  template<typename T>                                                  \
+  inline void name(global_ptr<T> obj,                                   \
+                   typename atomic_identity<T>::type val,               \
+                   T *old_val,                                          \
+                   event *e = peek_event())                             \
+  {                                                                     \
+    async_atomic_op(obj, op_code, val, T(), old_val, e);                \
+  }                                                                     \
+                                                                        \
+  template<typename T>                                                  \
+  inline value_future<T> name(global_ptr<atomic<T> > obj,               \
+                              typename atomic_identity<T>::type val)    \
+  {                                                                     \
+    return async_atomic_op(global_ptr<T>(obj), op_code, val);           \
+  }                                                                     \
+                                                                        \
+  template<typename T>                                                  \
+  inline void name(global_ptr<atomic<T> > obj,                          \
+                   typename atomic_identity<T>::type val,               \
+                   T *old_val,                                          \
+                   event *e = peek_event())                             \
+  {                                                                     \
+    async_atomic_op(global_ptr<T>(obj), op_code, val, T(), old_val, e); \
+  }
+
+  /**
+   * \ingroup syncgroup
+   * Non-blocking atomic swap and fetch-and-op.  The first form returns
+   * a future holding the old value of the remote object.  The second
+   * form writes the old value to *old_val (if not NULL) and signals
+   * event e when done.  Many operations may be in flight at the same
+   * time, and those to the same rank are sent together in one message.
+   */
+  UPCXX_ASYNC_ATOMIC_OP_DECL(async_atomic_swap, UPCXX_ATOMIC_SWAP)
+  UPCXX_ASYNC_ATOMIC_OP_DECL(async_fetch_add, UPCXX_ATOMIC_FETCH_ADD)
+  UPCXX_ASYNC_ATOMIC_OP_DECL(async_fetch_sub, UPCXX_ATOMIC_FETCH_SUB)
+  UPCXX_ASYNC_ATOMIC_OP_DECL(async_fetch_and, UPCXX_ATOMIC_FETCH_AND)
+  UPCXX_ASYNC_ATOMIC_OP_DECL(async_fetch_or,  UPCXX_ATOMIC_FETCH_OR)
+  UPCXX_ASYNC_ATOMIC_OP_DECL(async_fetch_xor, UPCXX_ATOMIC_FETCH_XOR)
+  UPCXX_ASYNC_ATOMIC_OP_DECL(async_fetch_min, UPCXX_ATOMIC_FETCH_MIN)
+  UPCXX_ASYNC_ATOMIC_OP_DECL(async_fetch_max, UPCXX_ATOMIC_FETCH_MAX)
+
+#undef UPCXX_ASYNC_ATOMIC_OP_DECL
+
+  /**
+   * \ingroup syncgroup
+   * Atomically apply op (e.g., UPCXX_ATOMIC_FETCH_ADD) with val to the
+   * remote object without waiting for it.  Updates to the same rank are
+   * aggregated into large messages; use update_flush() to wait for them.
+   */
+  template<typename T>
+  inline void atomic_update(global_ptr<T> obj, atomic_op_t op,
+                            typename atomic_identity<T>::type val)
+  {
+    update_nb(obj.where(), obj.raw_ptr(), atomic_type_traits<T>::type, op, &val);
   }
+
+  /**
+   * \ingroup syncgroup
+   * Send the queued updates of the calling rank and wait until they
+   * have been applied
+   */
+  void update_flush();
 } // end of upcxx
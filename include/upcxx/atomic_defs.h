@@ -0,0 +1,197 @@
+/**
+ * atomic_defs.h - types and local primitives of the remote atomics
+ *
+ * These are separate from atomic.h so that global_ref.h can use them
+ * without including global_ptr.h.
+ */
+
+#pragma once
+
+#include "gasnet_api.h"
+#include "upcxx_types.h"
+
+namespace upcxx
+{
+  struct event;
+
+  /// \cond SHOW_INTERNAL
+  // Types supported by remote atomics
+  enum atomic_type_t {
+    UPCXX_ATOMIC_INT32 = 0,
+    UPCXX_ATOMIC_UINT32,
+    UPCXX_ATOMIC_INT64,
+    UPCXX_ATOMIC_UINT64,
+    UPCXX_ATOMIC_FLOAT,
+    UPCXX_ATOMIC_DOUBLE,
+  };
+
+  // Remote atomic operations
+  enum atomic_op_t {
+    UPCXX_ATOMIC_LOAD = 0,
+    UPCXX_ATOMIC_STORE,
+    UPCXX_ATOMIC_SWAP,
+    UPCXX_ATOMIC_CAS,
+    UPCXX_ATOMIC_FETCH_ADD,
+    UPCXX_ATOMIC_FETCH_SUB,
+    UPCXX_ATOMIC_FETCH_AND,
+    UPCXX_ATOMIC_FETCH_OR,
+    UPCXX_ATOMIC_FETCH_XOR,
+    UPCXX_ATOMIC_FETCH_MIN,
+    UPCXX_ATOMIC_FETCH_MAX,
+    UPCXX_ATOMIC_FETCH_MUL,
+    UPCXX_ATOMIC_FETCH_DIV,
+    UPCXX_ATOMIC_FETCH_MOD, // integer only
+    UPCXX_ATOMIC_FETCH_SHL, // integer only
+    UPCXX_ATOMIC_FETCH_SHR, // integer only
+  };
+
+  // unsupported type, which has no type code
+  template<typename T> struct atomic_type_traits {
+    static const bool is_supported = false;
+  };
+
+#define UPCXX_ATOMIC_TYPE_DECL(T, code, is_int)                 \
+  template<> struct atomic_type_traits<T> {                     \
+    typedef T value_type;                                       \
+    static const atomic_type_t type = code;                     \
+    static const bool is_integer = is_int;                      \
+    static const bool is_supported = true;                      \
+  }
+
+  UPCXX_ATOMIC_TYPE_DECL(int, UPCXX_ATOMIC_INT32, true);
+  UPCXX_ATOMIC_TYPE_DECL(unsigned int, UPCXX_ATOMIC_UINT32, true);
+  UPCXX_ATOMIC_TYPE_DECL(long, (sizeof(long) == 8 ? UPCXX_ATOMIC_INT64 : UPCXX_ATOMIC_INT32), true);
+  UPCXX_ATOMIC_TYPE_DECL(unsigned long, (sizeof(long) == 8 ? UPCXX_ATOMIC_UINT64 : UPCXX_ATOMIC_UINT32), true);
+  UPCXX_ATOMIC_TYPE_DECL(long long, UPCXX_ATOMIC_INT64, true);
+  UPCXX_ATOMIC_TYPE_DECL(unsigned long long, UPCXX_ATOMIC_UINT64, true);
+  UPCXX_ATOMIC_TYPE_DECL(float, UPCXX_ATOMIC_FLOAT, false);
+  UPCXX_ATOMIC_TYPE_DECL(double, UPCXX_ATOMIC_DOUBLE, false);
+
+#undef UPCXX_ATOMIC_TYPE_DECL
+
+  // Apply op to the local object at addr with CPU atomics and return
+  // the old value.  For compare-and-swap, operand1 is the expected value
+  // and operand2 the desired value.
+  template<typename T>
+  inline T atomic_apply(T *addr, atomic_op_t op, T operand1, T operand2)
+  {
+    T old, desired;
+    switch (op) {
+    case UPCXX_ATOMIC_LOAD:
+      __atomic_load(addr, &old, __ATOMIC_SEQ_CST);
+      return old;
+    case UPCXX_ATOMIC_STORE:
+      __atomic_exchange(addr, &operand1, &old, __ATOMIC_SEQ_CST);
+      return old;
+    case UPCXX_ATOMIC_SWAP:
+      __atomic_exchange(addr, &operand1, &old, __ATOMIC_SEQ_CST);
+      return old;
+    case UPCXX_ATOMIC_CAS:
+      old = operand1;
+      __atomic_compare_exchange(addr, &old, &operand2, false,
+                                __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+      return old;
+    default:
+      break;
+    }
+
+    // Read-modify-write operations with a compare-and-swap loop, which
+    // works for both integer and floating-point types
+    __atomic_load(addr, &old, __ATOMIC_SEQ_CST);
+    do {
+      switch (op) {
+      case UPCXX_ATOMIC_FETCH_ADD: desired = old + operand1; break;
+      case UPCXX_ATOMIC_FETCH_SUB: desired = old - operand1; break;
+      case UPCXX_ATOMIC_FETCH_MIN: desired = operand1 < old ? operand1 : old; break;
+      case UPCXX_ATOMIC_FETCH_MAX: desired = operand1 > old ? operand1 : old; break;
+      case UPCXX_ATOMIC_FETCH_MUL: desired = old * operand1; break;
+      case UPCXX_ATOMIC_FETCH_DIV: desired = old / operand1; break;
+      default:
+        fprintf(stderr, "Atomic operation %d is not supported for this type!\n", op);
+        gasnet_exit(1);
+      }
+    } while (!__atomic_compare_exchange(addr, &old, &desired, true,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
+    return old;
+  }
+
+  // Bitwise operations are only defined for integer types
+#define UPCXX_ATOMIC_APPLY_INT_DECL(T)                                  \
+  template<>                                                            \
+  inline T atomic_apply<T>(T *addr, atomic_op_t op, T operand1, T operand2) \
+  {                                                                     \
+    T old;                                                              \
+    switch (op) {                                                       \
+    case UPCXX_ATOMIC_LOAD: return __atomic_load_n(addr, __ATOMIC_SEQ_CST); \
+    case UPCXX_ATOMIC_STORE:                                            \
+    case UPCXX_ATOMIC_SWAP:                                             \
+      return __atomic_exchange_n(addr, operand1, __ATOMIC_SEQ_CST);     \
+    case UPCXX_ATOMIC_CAS:                                              \
+      old = operand1;                                                   \
+      __atomic_compare_exchange_n(addr, &old, operand2, false,          \
+                                  __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);  \
+      return old;                                                       \
+    case UPCXX_ATOMIC_FETCH_ADD:                                        \
+      return __atomic_fetch_add(addr, operand1, __ATOMIC_SEQ_CST);      \
+    case UPCXX_ATOMIC_FETCH_SUB:                                        \
+      return __atomic_fetch_sub(addr, operand1, __ATOMIC_SEQ_CST);      \
+    case UPCXX_ATOMIC_FETCH_AND:                                        \
+      return __atomic_fetch_and(addr, operand1, __ATOMIC_SEQ_CST);      \
+    case UPCXX_ATOMIC_FETCH_OR:                                         \
+      return __atomic_fetch_or(addr, operand1, __ATOMIC_SEQ_CST);       \
+    case UPCXX_ATOMIC_FETCH_XOR:                                        \
+      return __atomic_fetch_xor(addr, operand1, __ATOMIC_SEQ_CST);      \
+    default:                                                            \
+      break;                                                            \
+    }                                                                   \
+    old = __atomic_load_n(addr, __ATOMIC_SEQ_CST);                      \
+    T desired;                                                          \
+    do {                                                                \
+      switch (op) {                                                     \
+      case UPCXX_ATOMIC_FETCH_MIN: desired = operand1 < old ? operand1 : old; break; \
+      case UPCXX_ATOMIC_FETCH_MAX: desired = operand1 > old ? operand1 : old; break; \
+      case UPCXX_ATOMIC_FETCH_MUL: desired = old * operand1; break;     \
+      case UPCXX_ATOMIC_FETCH_DIV: desired = old / operand1; break;     \
+      case UPCXX_ATOMIC_FETCH_MOD: desired = old % operand1; break;     \
+      case UPCXX_ATOMIC_FETCH_SHL: desired = old << operand1; break;    \
+      case UPCXX_ATOMIC_FETCH_SHR: desired = old >> operand1; break;    \
+      default:                                                          \
+        fprintf(stderr, "Unknown atomic operation %d!\n", op);          \
+        gasnet_exit(1);                                                 \
+      }                                                                 \
+    } while (!__atomic_compare_exchange_n(addr, &old, desired, true,    \
+                                          __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)); \
+    return old;                                                         \
+  }
+
+  UPCXX_ATOMIC_APPLY_INT_DECL(int)
+  UPCXX_ATOMIC_APPLY_INT_DECL(unsigned int)
+  UPCXX_ATOMIC_APPLY_INT_DECL(long)
+  UPCXX_ATOMIC_APPLY_INT_DECL(unsigned long)
+  UPCXX_ATOMIC_APPLY_INT_DECL(long long)
+  UPCXX_ATOMIC_APPLY_INT_DECL(unsigned long long)
+
+#undef UPCXX_ATOMIC_APPLY_INT_DECL
+
+  /*
+   * Perform op on the object at addr on rank r, which has the type
+   * denoted by type.  The operands and the result are passed by address
+   * and have the size of the type.  The old value is written to result
+   * (if not NULL) and cb_event is signaled when the operation is done.
+   *
+   * Operations on ranks in the same shared-memory node are done before
+   * the call returns.  Operations on other ranks are queued per target
+   * and sent together in one AM when the queue is full, when
+   * atomic_flush() is called, or by advance().
+   */
+  void atomic_op_nb(rank_t r, void *addr, atomic_type_t type, atomic_op_t op,
+                    const void *operand1, const void *operand2,
+                    void *result, event *cb_event);
+
+  // Send the queued remote atomics to rank r
+  void atomic_flush(rank_t r);
+
+  // Send the queued remote atomics to all ranks
+  void atomic_flush();
+  /// \endcond
+} // namespace upcxx
@@ -6,11 +6,13 @@
 #pragma once
 
 #include <assert.h>
+#include <vector>
 
 #include "gasnet_api.h"
 #include "upcxx_types.h"
 #include "coll_flags.h"
 #include "allocate.h"
+#include "event.h"
 
 namespace upcxx
 {
@@ -45,15 +47,16 @@ namespace upcxx
   }
   #define upcxx_gather upcxx::gather
   
+  /// \cond SHOW_INTERNAL
+  // Allgather on a team with point-to-point messages into dst, by
+  // recursive doubling for small and a ring for large data (allgather.cpp)
+  void coll_allgather(gasnet_team_handle_t team, const void *src, void *dst,
+                      size_t nbytes);
+  /// \endcond
+
   static inline void allgather(void *src, void *dst, size_t nbytes)
   {
-    // gasnet_coll_gather_all(current_gasnet_team(), dst, src, nbytes,
-    //                        UPCXX_GASNET_COLL_FLAG);
-    void *temp = (void *)allocate(nbytes * gasnete_coll_team_size(current_gasnet_team()));
-    assert(temp != NULL);
-    upcxx::gather(src, temp, nbytes, 0);
-    upcxx::bcast(temp, dst, nbytes * gasnete_coll_team_size(current_gasnet_team()), 0);
-    deallocate(temp);
+    coll_allgather(current_gasnet_team(), src, dst, nbytes);
   }
   #define upcxx_allgather upcxx::allgather
   
@@ -63,4 +66,186 @@ namespace upcxx
                                            UPCXX_GASNET_COLL_FLAG));
   }
   #define upcxx_alltoall upcxx::alltoall
+
+  /// \cond SHOW_INTERNAL
+  // Alltoallv on a team by pairwise exchange (alltoallv.cpp).  The
+  // counts and displacements are in elements of elem_size bytes.  It
+  // blocks if e is NULL and signals e when done otherwise.
+  void coll_alltoallv(gasnet_team_handle_t team, const void *src,
+                      const size_t *send_counts, const size_t *send_displs,
+                      void *dst, const size_t *recv_counts,
+                      const size_t *recv_displs, size_t elem_size, event *e);
+  // Get the counts that each rank sends to me
+  void coll_alltoallv_counts(gasnet_team_handle_t team,
+                             const size_t *send_counts, size_t *recv_counts);
+
+  template<class T>
+  void coll_alltoallv_auto(gasnet_team_handle_t team, const T *src,
+                           const size_t *send_counts,
+                           const size_t *send_displs, std::vector<T> &dst,
+                           std::vector<size_t> *recv_counts)
+  {
+    uint32_t n = gasnete_coll_team_size(team);
+    std::vector<size_t> counts(n), displs(n);
+    coll_alltoallv_counts(team, send_counts, &counts[0]);
+    size_t total = 0;
+    for (uint32_t i = 0; i < n; i++) {
+      displs[i] = total;
+      total += counts[i];
+    }
+    dst.resize(total);
+    coll_alltoallv(team, src, send_counts, send_displs,
+                   total ? &dst[0] : NULL, &counts[0], &displs[0],
+                   sizeof(T), NULL);
+    if (recv_counts != NULL) recv_counts->swap(counts);
+  }
+  /// \endcond
+
+  /**
+   * \ingroup collgroup
+   * Send send_counts[i] elements at src + send_displs[i] to rank i, and
+   * receive recv_counts[i] elements from rank i into dst +
+   * recv_displs[i].  The ranks exchange data in pairs, one peer per
+   * step, so that no rank receives from many ranks at once.
+   */
+  template<class T>
+  void alltoallv(const T *src, const size_t *send_counts,
+                 const size_t *send_displs, T *dst,
+                 const size_t *recv_counts, const size_t *recv_displs)
+  {
+    coll_alltoallv(current_gasnet_team(), src, send_counts, send_displs,
+                   dst, recv_counts, recv_displs, sizeof(T), NULL);
+  }
+
+  /**
+   * \ingroup collgroup
+   * Alltoallv that first exchanges the counts: dst is resized to hold
+   * the elements from all ranks, stored in rank order, and the number
+   * received from each rank is returned in recv_counts if not NULL.
+   */
+  template<class T>
+  void alltoallv(const T *src, const size_t *send_counts,
+                 const size_t *send_displs, std::vector<T> &dst,
+                 std::vector<size_t> *recv_counts = NULL)
+  {
+    coll_alltoallv_auto(current_gasnet_team(), src, send_counts, send_displs,
+                        dst, recv_counts);
+  }
+  #define upcxx_alltoallv upcxx::alltoallv
+
+  /// \cond SHOW_INTERNAL
+  // Blocking allreduce on a team (async_coll.cpp)
+  void coll_allreduce(gasnet_team_handle_t team, void *src, void *dst,
+                      size_t count, upcxx_op_t op, upcxx_datatype_t dt);
+  /// \endcond
+
+  /**
+   * \ingroup collgroup
+   * Reduce count elements of src from all ranks with op and store the
+   * result in dst on every rank; src may be dst.  Small data is
+   * reduced by recursive doubling and large data by a reduce-scatter
+   * followed by an allgather, instead of a reduce and a bcast.
+   */
+  template<class T>
+  void allreduce(T *src, T *dst, size_t count, upcxx_op_t op,
+                 upcxx_datatype_t dt)
+  {
+    coll_allreduce(current_gasnet_team(), src, dst, count, op, dt);
+  }
+  #define upcxx_allreduce upcxx::allreduce
+
+  /// \cond SHOW_INTERNAL
+  // Non-blocking collectives on a team (async_coll.cpp)
+  void coll_async_bcast(gasnet_team_handle_t team, void *src, void *dst,
+                        size_t nbytes, uint32_t root, event *e);
+  void coll_async_gather(gasnet_team_handle_t team, void *src, void *dst,
+                         size_t nbytes, uint32_t root, event *e);
+  void coll_async_scatter(gasnet_team_handle_t team, void *src, void *dst,
+                          size_t nbytes, uint32_t root, event *e);
+  void coll_async_alltoall(gasnet_team_handle_t team, void *src, void *dst,
+                           size_t nbytes, event *e);
+  void coll_async_reduce(gasnet_team_handle_t team, void *src, void *dst,
+                         size_t count, uint32_t root, upcxx_op_t op,
+                         upcxx_datatype_t dt, event *e);
+  void coll_async_allreduce(gasnet_team_handle_t team, void *src, void *dst,
+                            size_t count, upcxx_op_t op, upcxx_datatype_t dt,
+                            event *e);
+  void coll_async_barrier(gasnet_team_handle_t team, event *e);
+  /// \endcond
+
+  /**
+   * \ingroup collgroup
+   * Non-blocking versions of the collectives above.  They return right
+   * away and signal event e, the current finish scope by default, when
+   * done; advance() makes progress on them.  The buffers must not be
+   * used until then.  All the ranks must start the non-blocking and
+   * blocking collectives of a team in the same order.
+   */
+  static inline void async_bcast(void *src, void *dst, size_t nbytes,
+                                 uint32_t root, event *e = peek_event())
+  {
+    coll_async_bcast(current_gasnet_team(), src, dst, nbytes, root, e);
+  }
+
+  static inline void async_gather(void *src, void *dst, size_t nbytes,
+                                  uint32_t root, event *e = peek_event())
+  {
+    coll_async_gather(current_gasnet_team(), src, dst, nbytes, root, e);
+  }
+
+  static inline void async_scatter(void *src, void *dst, size_t nbytes,
+                                   uint32_t root, event *e = peek_event())
+  {
+    coll_async_scatter(current_gasnet_team(), src, dst, nbytes, root, e);
+  }
+
+  static inline void async_alltoall(void *src, void *dst, size_t nbytes,
+                                    event *e = peek_event())
+  {
+    coll_async_alltoall(current_gasnet_team(), src, dst, nbytes, e);
+  }
+
+  template<class T>
+  void async_reduce(T *src, T *dst, size_t count, uint32_t root,
+                    upcxx_op_t op, upcxx_datatype_t dt,
+                    event *e = peek_event())
+  {
+    coll_async_reduce(current_gasnet_team(), src, dst, count, root, op, dt, e);
+  }
+
+  /**
+   * \ingroup collgroup
+   * Reduce count elements of src from all ranks with op and store the
+   * result in dst on every rank without blocking.  src may be dst.
+   */
+  template<class T>
+  void async_allreduce(T *src, T *dst, size_t count, upcxx_op_t op,
+                       upcxx_datatype_t dt, event *e = peek_event())
+  {
+    coll_async_allreduce(current_gasnet_team(), src, dst, count, op, dt, e);
+  }
+
+  /**
+   * \ingroup collgroup
+   * Non-blocking alltoallv.  The counts and displacements must stay
+   * valid until e is signaled.
+   */
+  template<class T>
+  void async_alltoallv(const T *src, const size_t *send_counts,
+                       const size_t *send_displs, T *dst,
+                       const size_t *recv_counts, const size_t *recv_displs,
+                       event *e = peek_event())
+  {
+    coll_alltoallv(current_gasnet_team(), src, send_counts, send_displs,
+                   dst, recv_counts, recv_displs, sizeof(T), e);
+  }
+
+  /**
+   * \ingroup collgroup
+   * Signal e once all ranks have called async_barrier()
+   */
+  static inline void async_barrier(event *e = peek_event())
+  {
+    coll_async_barrier(current_gasnet_team(), e);
+  }
 } // end of namespace upcxx
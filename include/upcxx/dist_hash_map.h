@@ -0,0 +1,459 @@
+/**
+ * dist_hash_map.h - distributed hash map
+ *
+ * See test_dist_hash_map.cpp and testperf_dist_hash_map.cpp for usage
+ * examples
+ */
+
+#pragma once
+
+#include <iostream>
+#include <utility> // for std::pair
+
+#include "gasnet_api.h"
+#include "event.h"
+#include "allocate.h"
+#include "coll_flags.h"
+
+namespace upcxx
+{
+  /// \cond SHOW_INTERNAL
+  /*
+   * Operations on a remote dist_hash_map are queued per target rank
+   * and sent in batches.  exec(target, ops, nbytes, replies) runs in
+   * the AM handler on the target rank, applies the batch of ops to the
+   * map object at target, writes the results to replies and returns
+   * their size; done(replies, nbytes) runs in the AM reply handler on
+   * the calling rank.  The ops are sent when a batch is full, by
+   * advance(), or by dhm_send_batches().
+   */
+  typedef size_t (*dhm_exec_fn_t)(void *target, const void *ops,
+                                  size_t nbytes, void *replies);
+  typedef void (*dhm_done_fn_t)(const void *replies, size_t nbytes);
+
+  void dhm_enqueue(rank_t r, void *target, dhm_exec_fn_t exec,
+                   dhm_done_fn_t done, const void *op, size_t op_nbytes,
+                   size_t reply_nbytes);
+
+  // Send the queued operations without waiting
+  void dhm_send_batches();
+
+  // DHM_AM carries a dhm_am_t followed by the ops, and DHM_REPLY a
+  // dhm_reply_t followed by the replies
+  struct dhm_am_t {
+    dhm_exec_fn_t exec;
+    dhm_done_fn_t done;
+    void *target;
+    size_t reply_nbytes; // the maximum size of the replies
+  };
+
+  struct dhm_reply_t {
+    dhm_done_fn_t done;
+    size_t nbytes;
+  };
+
+  void dhm_am_handler(gasnet_token_t token, void *buf, size_t nbytes);
+  void dhm_reply_handler(gasnet_token_t token, void *buf, size_t nbytes);
+  /// \endcond
+
+  /**
+   * \ingroup gasgroup
+   * The default hash function of dist_hash_map, which hashes the bytes
+   * of the key.  Keys with padding bytes or pointers to their contents
+   * need their own hash function.
+   */
+  template<typename K>
+  struct dist_hash
+  {
+    size_t operator()(const K &key) const
+    {
+      // FNV-1a followed by the MurmurHash3 finalizer
+      const unsigned char *p = (const unsigned char *)&key;
+      uint64_t h = 14695981039346656037ULL;
+      for (size_t i = 0; i < sizeof(K); i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+      }
+      h ^= h >> 33;
+      h *= 0xff51afd7ed558ccdULL;
+      h ^= h >> 33;
+      h *= 0xc4ceb9fe1a85ec53ULL;
+      h ^= h >> 33;
+      return (size_t)h;
+    }
+  };
+
+  /**
+   * \ingroup gasgroup
+   * A hash map whose entries are partitioned across ranks by the hash
+   * of their keys.  Each rank keeps its entries in an open-addressing
+   * table in its segment, which grows as needed.
+   *
+   * The operations are asynchronous: they return a future, or signal
+   * an event (the current finish scope by default) and write the
+   * result to the given location when done.  Operations on keys owned
+   * by the calling rank complete immediately; the others are sent to
+   * the owner in batches per destination (up to UPCXX_DHM_BATCH_SIZE
+   * operations each), which are sent when full or by advance().
+   * Remote operations may be applied in any order, so wait for an
+   * operation before issuing one that depends on it.
+   *
+   * K and V must be copyable with memcpy, and K must be comparable
+   * with ==.
+   *
+   * Example:
+   * \code
+   * dist_hash_map<uint64_t, double> m;
+   * m.init(1024);
+   * m.insert(key, 1.0);
+   * value_future< std::pair<bool, double> > f = m.find(key);
+   * if (f.get().first) ...
+   * \endcode
+   */
+  template<typename K, typename V, typename Hash = dist_hash<K> >
+  class dist_hash_map
+  {
+  public:
+    typedef std::pair<bool, V> find_result_t;
+
+    dist_hash_map() : _maps(NULL), _slots(NULL), _capacity(0), _size(0),
+                      _used(0)
+    {
+      upcxx_mutex_init(&_lock);
+    }
+
+    /**
+     * Collectively create the map with room for local_capacity
+     * entries per rank before its first growth.
+     */
+    void init(size_t local_capacity = 1024)
+    {
+      if (!upcxx::is_init()) {
+        std::cerr << "error: attempt to create dist_hash_map before "
+                  << "initializing UPC++" << std::endl;
+        abort();
+      }
+
+      if (_maps == NULL) {
+        _maps = (dist_hash_map **)malloc(global_ranks() * sizeof(dist_hash_map *));
+        assert(_maps != NULL);
+      }
+      allocate_slots(table_capacity(local_capacity));
+
+      dist_hash_map *me = this;
+      gasnet_coll_handle_t h;
+      h = gasnet_coll_gather_all_nb(GASNET_TEAM_ALL, _maps, &me,
+                                    sizeof(dist_hash_map *),
+                                    UPCXX_GASNET_COLL_FLAG);
+      while(gasnet_coll_try_sync(h) != GASNET_OK) {
+        advance(); // need to keep polling the task queue while waiting
+      }
+    }
+
+    /**
+     * Collectively free the tables after all ranks are done with the
+     * map.
+     */
+    void destroy()
+    {
+      barrier();
+      if (_slots != NULL) deallocate(_slots);
+      _slots = NULL;
+      _capacity = _size = _used = 0;
+      free(_maps);
+      _maps = NULL;
+    }
+
+    /**
+     * Insert key with val, or replace the value of key.  The result is
+     * true if key was not in the map.
+     */
+    value_future<bool> insert(const K &key, const V &val)
+    {
+      value_future<bool> f;
+      apply(DHM_INSERT, key, val, f.value_addr(), f.get_event());
+      return f;
+    }
+
+    /**
+     * Insert key with val without a future.  inserted, if not NULL, is
+     * set to true if key was not in the map before e is signaled.
+     */
+    void insert(const K &key, const V &val, bool *inserted,
+                event *e = peek_event())
+    {
+      apply(DHM_INSERT, key, val, inserted, e);
+    }
+
+    /**
+     * Look up key.  The result is (true, value) if key is in the map and
+     * (false, undefined) otherwise.
+     */
+    value_future<find_result_t> find(const K &key)
+    {
+      value_future<find_result_t> f;
+      apply(DHM_FIND, key, V(), f.value_addr(), f.get_event());
+      return f;
+    }
+
+    /**
+     * Look up key without a future.  result is set before e is
+     * signaled.
+     */
+    void find(const K &key, find_result_t *result, event *e = peek_event())
+    {
+      apply(DHM_FIND, key, V(), result, e);
+    }
+
+    /**
+     * Remove key.  The result is true if key was in the map.
+     */
+    value_future<bool> erase(const K &key)
+    {
+      value_future<bool> f;
+      apply(DHM_ERASE, key, V(), f.value_addr(), f.get_event());
+      return f;
+    }
+
+    /**
+     * Remove key without a future.  erased, if not NULL, is set to true
+     * if key was in the map before e is signaled.
+     */
+    void erase(const K &key, bool *erased, event *e = peek_event())
+    {
+      apply(DHM_ERASE, key, V(), erased, e);
+    }
+
+    /**
+     * Send the queued operations of all maps without waiting for them
+     */
+    void flush()
+    {
+      dhm_send_batches();
+    }
+
+    /**
+     * Return the rank that owns key
+     */
+    rank_t owner(const K &key) const
+    {
+      return _hash(key) % global_ranks();
+    }
+
+    /**
+     * Return the number of entries stored on the calling rank
+     */
+    size_t local_size() const
+    {
+      return _size;
+    }
+
+  private:
+    enum { DHM_INSERT = 0, DHM_FIND, DHM_ERASE };
+    enum { SLOT_EMPTY = 0, SLOT_FULL, SLOT_ERASED };
+
+    struct slot_t {
+      K key;
+      V val;
+      char state;
+    };
+
+    struct op_t {
+      int op;
+      size_t lhash; // the hash of key on the owner
+      K key;
+      V val;
+      void *result;
+      event *e;
+    };
+
+    struct reply_t {
+      int op;
+      int found;
+      V val;
+      void *result;
+      event *e;
+    };
+
+    dist_hash_map **_maps; // the map objects of all ranks
+    slot_t *_slots;        // the local table in the segment
+    size_t _capacity;      // power of two
+    size_t _size;          // # of SLOT_FULL slots
+    size_t _used;          // # of SLOT_FULL and SLOT_ERASED slots
+    Hash _hash;
+    upcxx_mutex_t _lock;
+
+    static size_t table_capacity(size_t n)
+    {
+      size_t cap = 16;
+      while (cap * 3 < n * 4) cap <<= 1; // keep the load below 3/4
+      return cap;
+    }
+
+    void allocate_slots(size_t cap)
+    {
+      if (_slots != NULL) deallocate(_slots);
+      _slots = (slot_t *)seg_allocate(cap * sizeof(slot_t), SEG_ALLOC_HASH_MAP);
+      if (_slots == NULL) {
+        fprintf(stderr, "dist_hash_map error: rank %u cannot allocate %lu "
+                "bytes in the segment for its table.\n", global_myrank(),
+                (unsigned long)(cap * sizeof(slot_t)));
+        gasnet_exit(1);
+      }
+      for (size_t i = 0; i < cap; i++) _slots[i].state = SLOT_EMPTY;
+      _capacity = cap;
+      _size = _used = 0;
+    }
+
+    // Move the entries into a new table, dropping the erased slots,
+    // called with _lock held
+    void rehash(size_t cap)
+    {
+      slot_t *old = _slots;
+      size_t old_cap = _capacity;
+      _slots = NULL;
+      allocate_slots(cap);
+      for (size_t i = 0; i < old_cap; i++) {
+        if (old[i].state == SLOT_FULL) {
+          size_t j = (_hash(old[i].key) / global_ranks()) & (_capacity - 1);
+          while (_slots[j].state != SLOT_EMPTY) j = (j + 1) & (_capacity - 1);
+          _slots[j] = old[i];
+          _size++;
+          _used++;
+        }
+      }
+      deallocate(old);
+    }
+
+    // Return the slot of key or NULL, called with _lock held
+    slot_t *lookup(size_t lhash, const K &key, slot_t **first_free = NULL)
+    {
+      if (first_free != NULL) *first_free = NULL;
+      for (size_t i = lhash & (_capacity - 1); ; i = (i + 1) & (_capacity - 1)) {
+        slot_t *s = &_slots[i];
+        if (s->state == SLOT_EMPTY) {
+          if (first_free != NULL && *first_free == NULL) *first_free = s;
+          return NULL;
+        }
+        if (s->state == SLOT_ERASED) {
+          if (first_free != NULL && *first_free == NULL) *first_free = s;
+        } else if (s->key == key) {
+          return s;
+        }
+      }
+    }
+
+    // Apply an operation to the local table and return whether key was
+    // found (for DHM_INSERT whether it was inserted)
+    bool apply_local(int op, size_t lhash, const K &key, const V &val, V *out)
+    {
+      bool found;
+      upcxx_mutex_lock(&_lock);
+      if (op == DHM_INSERT && (_used + 1) * 4 > _capacity * 3) {
+        // grow unless dropping the erased slots makes enough room
+        rehash((_size + 1) * 2 > _capacity ? _capacity * 2 : _capacity);
+      }
+      slot_t *first_free;
+      slot_t *s = lookup(lhash, key, &first_free);
+      switch (op) {
+      case DHM_INSERT:
+        found = (s == NULL);
+        if (s == NULL) {
+          s = first_free;
+          if (s->state == SLOT_EMPTY) _used++;
+          s->key = key;
+          s->state = SLOT_FULL;
+          _size++;
+        }
+        s->val = val;
+        break;
+      case DHM_FIND:
+        found = (s != NULL);
+        if (found) *out = s->val;
+        break;
+      case DHM_ERASE:
+        found = (s != NULL);
+        if (found) {
+          s->state = SLOT_ERASED;
+          _size--;
+        }
+        break;
+      default:
+        fprintf(stderr, "dist_hash_map error: unknown operation %d\n", op);
+        gasnet_exit(1);
+      }
+      upcxx_mutex_unlock(&_lock);
+      return found;
+    }
+
+    static void complete(int op, bool found, const V &val, void *result)
+    {
+      if (result == NULL) return;
+      if (op == DHM_FIND) {
+        find_result_t *r = (find_result_t *)result;
+        r->first = found;
+        if (found) r->second = val;
+      } else {
+        *(bool *)result = found;
+      }
+    }
+
+    void apply(int op, const K &key, const V &val, void *result, event *e)
+    {
+      size_t h = _hash(key);
+      rank_t r = h % global_ranks();
+      size_t lhash = h / global_ranks();
+
+      if (r == global_myrank()) {
+        V out;
+        bool found = apply_local(op, lhash, key, val, &out);
+        complete(op, found, out, result);
+        return;
+      }
+
+      op_t o;
+      o.op = op;
+      o.lhash = lhash;
+      o.key = key;
+      o.val = val;
+      o.result = result;
+      o.e = e;
+      e->incref();
+      dhm_enqueue(r, _maps[r], exec_batch, done_batch, &o, sizeof(op_t),
+                  sizeof(reply_t));
+    }
+
+    // Run by the owner in the AM handler
+    static size_t exec_batch(void *target, const void *ops, size_t nbytes,
+                             void *replies)
+    {
+      dist_hash_map *m = (dist_hash_map *)target;
+      const op_t *o = (const op_t *)ops;
+      reply_t *r = (reply_t *)replies;
+      size_t n = nbytes / sizeof(op_t);
+      assert(nbytes == n * sizeof(op_t));
+
+      for (size_t i = 0; i < n; i++) {
+        r[i].op = o[i].op;
+        r[i].found = m->apply_local(o[i].op, o[i].lhash, o[i].key, o[i].val,
+                                    &r[i].val);
+        r[i].result = o[i].result;
+        r[i].e = o[i].e;
+      }
+      return n * sizeof(reply_t);
+    }
+
+    // Run by the issuing rank in the AM reply handler
+    static void done_batch(const void *replies, size_t nbytes)
+    {
+      const reply_t *r = (const reply_t *)replies;
+      size_t n = nbytes / sizeof(reply_t);
+      assert(nbytes == n * sizeof(reply_t));
+
+      for (size_t i = 0; i < n; i++) {
+        complete(r[i].op, r[i].found, r[i].val, r[i].result);
+        r[i].e->decref();
+      }
+    }
+  }; // class dist_hash_map
+} // namespace upcxx
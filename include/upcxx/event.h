@@ -141,6 +141,81 @@ namespace upcxx
 
   typedef struct event future;
 
+  /**
+   * \ingroup asyncgroup
+   * A future that carries a value of type T, which becomes available
+   * when the asynchronous operation that produces it is done.  Copies
+   * of a value_future share the same value and event.
+   */
+  template<typename T>
+  struct value_future {
+    struct state_t {
+      event e;
+      T value;
+      int refs;
+    };
+
+    inline value_future() : _state(new state_t)
+    {
+      _state->refs = 1;
+    }
+
+    inline value_future(const value_future<T> &f) : _state(f._state)
+    {
+      __sync_fetch_and_add(&_state->refs, 1);
+    }
+
+    inline value_future<T>& operator=(const value_future<T> &f)
+    {
+      if (_state != f._state) {
+        __sync_fetch_and_add(&f._state->refs, 1);
+        release();
+        _state = f._state;
+      }
+      return *this;
+    }
+
+    inline ~value_future()
+    {
+      release();
+    }
+
+    /**
+     * Wait for the value to become available
+     */
+    inline void wait() { _state->e.wait(); }
+
+    /**
+     * Return 1 if the value is available; return 0 if not
+     */
+    inline int async_try() { return _state->e.async_try(); }
+
+    /**
+     * Wait for and return the value
+     */
+    inline T get()
+    {
+      wait();
+      return _state->value;
+    }
+
+    /// \cond SHOW_INTERNAL
+    // The event to signal and the location to write for the producer
+    inline event *get_event() const { return &_state->e; }
+    inline T *value_addr() const { return &_state->value; }
+    /// \endcond
+
+  private:
+    state_t *_state;
+
+    inline void release()
+    {
+      if (__sync_sub_and_fetch(&_state->refs, 1) == 0) {
+        delete _state; // the event destructor waits for completion
+      }
+    }
+  };
+
   inline
   std::ostream& operator<<(std::ostream& out, const event& e)
   {
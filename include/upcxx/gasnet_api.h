@@ -35,13 +35,30 @@ enum upcxxi_am_index_t {
   LOCK_AM,          // inter-node lock
   LOCK_REPLY,       // reply message for LOCK_AM
   UNLOCK_AM,        // inter-node unlock
+  UNLOCK_REPLY,     // reply message for UNLOCK_AM
+  LOCK_LINK_AM,     // link a lock waiter to its predecessor in the queue
+  LOCK_GRANT_AM,    // hand a lock to the next waiter in the queue
+  RWLOCK_AM,        // reader-writer lock request
+  RWLOCK_REPLY,     // reply message for RWLOCK_AM
+  RWLOCK_GRANT_AM,  // grant a queued reader-writer lock request
   AM_BCAST,         // active broadcast
   AM_BCAST_REPLY,   // active broadcast reply
   INC_AM,           // remote increment
-  FETCH_ADD_U64_AM,  // fetch and add for uint64_t
-  FETCH_ADD_U64_REPLY, // reply message for FETCH_ADD_U64_AM
+  ATOMIC_AM,        // remote atomic operation
+  ATOMIC_REPLY,     // reply message for ATOMIC_AM
+  UPDATE_AM,        // apply a batch of remote updates
+  UPDATE_REPLY,     // reply message for UPDATE_AM
+  DHM_AM,           // apply a batch of dist_hash_map operations
+  DHM_REPLY,        // results of a batch of dist_hash_map operations
+  TASK_STEAL_AM,    // steal tasks from a task_pool
+  TASK_STEAL_REPLY, // the stolen tasks
+  TASK_TOKEN_AM,    // task_pool termination detection token
+  TASK_TERMINATE_AM, // all the tasks of a task_pool are done
+  COLL_MSG_AM,      // data of a collective implemented by UPC++
   COPY_AND_SIGNAL_REQUEST, // transfer data and signal a remote event
   COPY_AND_SIGNAL_REPLY,   // reply a COPY_AND_SIGNAL_REQUEST
+  WRITE_COMBINE_AM,        // apply a batch of combined small writes
+  WRITE_COMBINE_REPLY,     // reply message for WRITE_COMBINE_AM
 
   /* array_bulk.c */
   ARRAY_MISC_DELETE_REQUEST,
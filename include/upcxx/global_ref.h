@@ -11,6 +11,9 @@
 #endif
 
 #include "gasnet_api.h"
+#include "read_cache.h"
+#include "event.h"
+#include "atomic_defs.h"
 // #include "async.h"
 
 // #define UPCXX_DEBUG
@@ -29,6 +32,50 @@ namespace upcxx
   #endif
 
   /// \cond SHOW_INTERNAL
+  // Compound assignments to objects of the types supported by the
+  // remote atomics are applied by the owner with one remote atomic
+  template<typename T, bool is_supported = atomic_type_traits<T>::is_supported>
+  struct global_ref_atomic_op
+  {
+    static void apply(rank_t r, T *ptr, atomic_op_t op, const T &rhs) { }
+  };
+
+  template<typename T>
+  struct global_ref_atomic_op<T, true>
+  {
+    static void apply(rank_t r, T *ptr, atomic_op_t op, const T &rhs)
+    {
+      if (r == global_myrank()) {
+        atomic_apply(ptr, op, rhs, rhs);
+        return;
+      }
+
+      event e;
+      T val;
+      atomic_op_nb(r, ptr, atomic_type_traits<T>::type, op, &rhs, &rhs, &val, &e);
+      atomic_flush(r);
+      e.wait();
+      if (read_cache_active()) {
+        atomic_apply(&val, op, rhs, rhs); // val becomes the new value
+        cache_update(r, ptr, &val, sizeof(T));
+      }
+    }
+
+    static void async_apply(rank_t r, T *ptr, atomic_op_t op, const T &rhs,
+                            event *e)
+    {
+      if (!read_cache_active()) {
+        atomic_op_nb(r, ptr, atomic_type_traits<T>::type, op, &rhs, &rhs, NULL, e);
+        return;
+      }
+      // drop the cached copies of the object before and after the op
+      event **done = cache_invalidate_begin(r, ptr, sizeof(T));
+      atomic_op_nb(r, ptr, atomic_type_traits<T>::type, op, &rhs, &rhs, NULL,
+                   done[0]);
+      cache_invalidate_end(done, r, ptr, sizeof(T), e);
+    }
+  };
+
   template<typename T, typename place_t = rank_t>
   struct global_ref_base
   {
@@ -47,7 +94,7 @@ namespace upcxx
         *_ptr = rhs;
       } else {
         // if not local
-        gasnet_put(_pla, _ptr, (void *)&rhs, sizeof(T));
+        cached_put(_pla, _ptr, (void *)&rhs, sizeof(T));
       }
       return *this;
     }
@@ -59,7 +106,7 @@ namespace upcxx
         *_ptr = val;
       } else {
         // if not local
-        gasnet_put(_pla, _ptr, (void *)&val, sizeof(T));
+        cached_put(_pla, _ptr, (void *)&val, sizeof(T));
       }
       return *this;
     }
@@ -71,39 +118,57 @@ namespace upcxx
       return (get() + rhs);
     }
 
-#define UPCXX_GLOBAL_REF_ASSIGN_OP(OP) \
+    // Types supported by the remote atomics are updated atomically by
+    // the owner with one message; other types with a get and a put.
+#define UPCXX_GLOBAL_REF_ASSIGN_OP(OP, ATOMIC_OP) \
     global_ref_base<T>& operator OP (const T &rhs) \
     { \
-      if (_pla == global_myrank()) { \
+      if (atomic_type_traits<T>::is_supported) { \
+        global_ref_atomic_op<T>::apply(_pla, _ptr, ATOMIC_OP, rhs); \
+      } else if (_pla == global_myrank()) { \
         *_ptr OP rhs; \
       } else { \
        T tmp; \
-       gasnet_get(&tmp, _pla, _ptr, sizeof(T)); \
+       cached_get(&tmp, _pla, _ptr, sizeof(T)); \
        tmp OP rhs; \
-       gasnet_put(_pla, _ptr, (void *)&tmp, sizeof(T)); \
+       cached_put(_pla, _ptr, (void *)&tmp, sizeof(T)); \
       } \
       return *this; \
     }
 
-    UPCXX_GLOBAL_REF_ASSIGN_OP(+=)
+    UPCXX_GLOBAL_REF_ASSIGN_OP(+=, UPCXX_ATOMIC_FETCH_ADD)
+
+    UPCXX_GLOBAL_REF_ASSIGN_OP(-=, UPCXX_ATOMIC_FETCH_SUB)
 
-    UPCXX_GLOBAL_REF_ASSIGN_OP(-=)
+    UPCXX_GLOBAL_REF_ASSIGN_OP(*=, UPCXX_ATOMIC_FETCH_MUL)
 
-    UPCXX_GLOBAL_REF_ASSIGN_OP(*=)
+    UPCXX_GLOBAL_REF_ASSIGN_OP(/=, UPCXX_ATOMIC_FETCH_DIV)
 
-    UPCXX_GLOBAL_REF_ASSIGN_OP(/=)
+    UPCXX_GLOBAL_REF_ASSIGN_OP(%=, UPCXX_ATOMIC_FETCH_MOD)
 
-    UPCXX_GLOBAL_REF_ASSIGN_OP(%=)
+    UPCXX_GLOBAL_REF_ASSIGN_OP(^=, UPCXX_ATOMIC_FETCH_XOR)
 
-    UPCXX_GLOBAL_REF_ASSIGN_OP(^=)
+    UPCXX_GLOBAL_REF_ASSIGN_OP(|=, UPCXX_ATOMIC_FETCH_OR)
 
-    UPCXX_GLOBAL_REF_ASSIGN_OP(|=)
+    UPCXX_GLOBAL_REF_ASSIGN_OP(&=, UPCXX_ATOMIC_FETCH_AND)
 
-    UPCXX_GLOBAL_REF_ASSIGN_OP(&=)
+    UPCXX_GLOBAL_REF_ASSIGN_OP(<<=, UPCXX_ATOMIC_FETCH_SHL)
 
-    UPCXX_GLOBAL_REF_ASSIGN_OP(<<=)
+    UPCXX_GLOBAL_REF_ASSIGN_OP(>>=, UPCXX_ATOMIC_FETCH_SHR)
 
-    UPCXX_GLOBAL_REF_ASSIGN_OP(>>=)
+    /**
+     * Atomically apply op (e.g., UPCXX_ATOMIC_FETCH_ADD for +=) with
+     * rhs to the referenced object without waiting for it.  Event e,
+     * the current finish scope by default, is signaled when done.
+     * T must be a type supported by the remote atomics.  With the read
+     * cache or prefetch active, reads of the object by the calling rank
+     * may return the old value until e is signaled; the cached copies
+     * are dropped when the op is done.
+     */
+    void async_apply(atomic_op_t op, const T &rhs, event *e = peek_event())
+    {
+      global_ref_atomic_op<T>::async_apply(_pla, _ptr, op, rhs, e);
+    }
 
     template <typename T2>
     bool operator == (const T2 &rhs)
@@ -124,7 +189,7 @@ namespace upcxx
       } else {
         // if not local
         T tmp;
-        gasnet_get(&tmp, _pla, _ptr, sizeof(T));
+        cached_get(&tmp, _pla, _ptr, sizeof(T));
         return tmp;
       }
     }
@@ -136,7 +201,7 @@ namespace upcxx
       } else {
         // if not local
         T tmp;
-        gasnet_get(&tmp, _pla, _ptr, sizeof(T));
+        cached_get(&tmp, _pla, _ptr, sizeof(T));
         return tmp;
       }
     }
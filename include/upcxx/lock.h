@@ -20,15 +20,28 @@ namespace upcxx
    * implementation.
    */
 
+#define UPCXX_LOCK_NONE ((rank_t)-1)
+
+  struct lock_rv_t; // partial declaration of using its pointer type
+
   /**
    * \ingroup syncgroup
    * global address space lock implemented by active messages and local handler-safe locks.
+   *
+   * The lock is an MCS-style queue lock.  The owner keeps the tail of
+   * the queue of waiting ranks.  A rank acquiring the lock enqueues
+   * itself once and then waits for the lock to be handed to it
+   * directly by its predecessor, so a contended lock doesn't cause
+   * retry messages to the owner.  Ranks that can access the lock
+   * object directly (the owner, or ranks on the same node if the lock
+   * object is in the owner's shared segment) update the tail with
+   * atomic operations instead of sending messages to the owner.
    */
   struct  shared_lock {
   private:
-    volatile int _locked; /**< lock state: 1 - locked, 0 - unlocked */
     rank_t _owner; /**< the owner of the lock */
-    rank_t _holder; /**< the current holder of the lock */
+    rank_t _holder; /**< the rank that last acquired the lock while it was free */
+    volatile rank_t _tail; /**< the last rank in the queue, UPCXX_LOCK_NONE if unlocked */
     shared_lock *myself;
 
 #if defined(UPCXX_THREAD_SAFE) || defined(GASNET_PAR)
@@ -38,9 +51,9 @@ namespace upcxx
   public:
     inline shared_lock(rank_t owner=0)
     {
-      _locked = 0;
       _owner = owner;
       _holder = _owner;
+      _tail = UPCXX_LOCK_NONE;
 
       myself = this;
 #if defined(UPCXX_THREAD_SAFE)  || defined(GASNET_PAR)
@@ -60,7 +73,19 @@ namespace upcxx
     void lock();
 
     /**
-     * Release the lock
+     * Request the lock without blocking.  Event e is signaled when the
+     * lock is acquired, which requires the caller to make progress
+     * (e.g., by advance() or waiting on an event).  The lock must not
+     * be requested again by the same rank until it is released.
+     */
+    void async_lock(event *e = peek_event());
+
+    /**
+     * Release the lock.  If a waiting rank has not linked itself to the
+     * calling rank yet, the lock is handed to it later by the progress
+     * engine (e.g., advance() or waiting on an event), so unlock()
+     * doesn't wait for it.  Requesting the lock again waits for such a
+     * pending handoff to finish.
      */
     void unlock();
 
@@ -83,8 +108,85 @@ namespace upcxx
     static void lock_am_handler(gasnet_token_t token, void *buf, size_t nbytes);
     static void lock_reply_handler(gasnet_token_t token, void *buf, size_t nbytes);
     static void unlock_am_handler(gasnet_token_t token, void *buf, size_t nbytes);
+    static void unlock_reply_handler(gasnet_token_t token, void *buf, size_t nbytes);
+    static void lock_link_am_handler(gasnet_token_t token, void *buf, size_t nbytes);
+    static void lock_grant_am_handler(gasnet_token_t token, void *buf, size_t nbytes);
+
+    // Send the queue links of the pending lock requests and the pending
+    // handoffs, called by advance()
+    static void progress();
+
+    /// \endcond
+
+  private:
+    void request(event *e, int tryonly, lock_rv_t *rv);
+  };
+
+  /**
+   * \ingroup syncgroup
+   * global address space reader-writer lock.  Any number of readers
+   * may hold the lock at the same time, but a writer holds it
+   * exclusively.  Waiting writers have preference over new readers.
+   *
+   * The lock state lives on the owner rank.  Ranks that can access the
+   * lock object directly (the owner, or ranks on the same node if the
+   * lock object is in the owner's shared segment) acquire it with
+   * atomic operations on the lock word.  Other ranks send requests to
+   * the owner, which grants them when the lock becomes available.
+   */
+  struct shared_rwlock {
+  private:
+    volatile uint64_t _state; /**< lock word: writer bit, waiting writers and readers */
+    rank_t _owner; /**< the owner of the lock */
+    shared_rwlock *myself;
+
+  public:
+    inline shared_rwlock(rank_t owner=0) : _state(0), _owner(owner)
+    {
+      myself = this;
+    }
+
+    /**
+     * Acquire the lock for reading and wait until succeed
+     */
+    void read_lock();
+
+    /**
+     * Release the lock acquired for reading
+     */
+    void read_unlock();
+
+    /**
+     * Acquire the lock for writing and wait until succeed
+     */
+    void write_lock();
+
+    /**
+     * Release the lock acquired for writing
+     */
+    void write_unlock();
 
+    /**
+     * Try to acquire the lock for reading (or writing) without
+     * blocking.  return 1 if the lock is acquired; return 0 otherwise.
+     */
+    int try_read_lock();
+    int try_write_lock();
+
+    /// \cond SHOW_INTERNAL
+    inline rank_t get_owner() { return _owner; }
+
+    static void rwlock_am_handler(gasnet_token_t token, void *buf, size_t nbytes);
+    static void rwlock_reply_handler(gasnet_token_t token, void *buf, size_t nbytes);
+    static void rwlock_grant_am_handler(gasnet_token_t token, void *buf, size_t nbytes);
+
+    // Grant the lock to queued remote waiters, called by advance()
+    static void progress();
     /// \endcond
+
+  private:
+    volatile uint64_t *local_state();
+    int remote_op(int op);
   };
 
   struct lock_reply_t; // partial declaration of using its pointer type
@@ -99,15 +201,56 @@ namespace upcxx
     lock_rv_t *rv_addr; // the address for the return value
     event *cb_event;
     int queryonly;
+    int tryonly; // don't enqueue if the lock is held
   };
 
   struct lock_reply_t {
+    shared_lock *lock;
     lock_rv_t *rv_addr;
     lock_rv_t rv;
+    rank_t pred; // the predecessor in the queue
     event *cb_event;
+    int queryonly;
+    int tryonly; // the caller isn't waiting in the queue
   };
 
   struct unlock_am_t {
     shared_lock *lock;
+    int *released_addr;
+    event *cb_event;
+  };
+
+  struct unlock_reply_t {
+    int released;
+    int *released_addr;
+    event *cb_event;
+  };
+
+  // Queue link and lock handoff between waiting ranks
+  struct lock_link_am_t {
+    shared_lock *lock;
+    rank_t owner;
+  };
+
+  enum rwlock_op_t {
+    RWLOCK_READ = 0,
+    RWLOCK_WRITE,
+    RWLOCK_TRY_READ,
+    RWLOCK_TRY_WRITE,
+    RWLOCK_READ_UNLOCK,
+    RWLOCK_WRITE_UNLOCK,
+  };
+
+  struct rwlock_am_t {
+    shared_rwlock *lock;
+    int op;
+    int *granted_addr;
+    event *cb_event;
+  };
+
+  struct rwlock_reply_t {
+    int granted;
+    int *granted_addr;
+    event *cb_event;
   };
 } // namespace upcxx
@@ -0,0 +1,62 @@
+/**
+ * prefetch.h - non-blocking prefetch of remote data
+ *
+ * prefetch() starts a non-blocking get of a remote range into a buffer
+ * managed by the runtime.  Later reads of the range through global_ref,
+ * upcxx::copy() or prefetch_view() are served from that buffer, waiting
+ * for the data only if they have not arrived yet.  Like the read cache,
+ * prefetched data are a snapshot: the buffers are released by barrier()
+ * and cache_invalidate(), and the application must make sure the range
+ * is not written by other ranks in the meantime.
+ */
+
+#pragma once
+
+#include "gasnet_api.h"
+#include "global_ptr.h"
+
+namespace upcxx
+{
+  /**
+   * \ingroup gasgroup
+   * \brief Start fetching nbytes at ptr into a runtime-managed buffer
+   *
+   * A range already prefetched at ptr is replaced if nbytes is larger.
+   */
+  void prefetch(global_ptr<void> ptr, size_t nbytes);
+
+  /**
+   * \ingroup gasgroup
+   * \brief Start fetching count elements at ptr into a runtime-managed buffer
+   *
+   * \tparam T type of the element
+   */
+  template<typename T>
+  inline void prefetch(global_ptr<T> ptr, size_t count)
+  {
+    prefetch(global_ptr<void>(ptr), count * sizeof(T));
+  }
+
+  /// \cond SHOW_INTERNAL
+  void *prefetch_view(global_ptr<void> ptr, size_t nbytes);
+  /// \endcond
+
+  /**
+   * \ingroup gasgroup
+   * \brief Return a local pointer to count elements at ptr
+   *
+   * For a prefetched range, wait for the data and return a pointer into
+   * the prefetch buffer.  For data on the calling rank, return the raw
+   * pointer.  Otherwise return NULL.
+   *
+   * A pointer into a prefetch buffer becomes invalid at the next
+   * barrier() or cache_invalidate(), which release the buffers.
+   *
+   * \tparam T type of the element
+   */
+  template<typename T>
+  inline T *prefetch_view(global_ptr<T> ptr, size_t count)
+  {
+    return (T *)prefetch_view(global_ptr<void>(ptr), count * sizeof(T));
+  }
+} // namespace upcxx
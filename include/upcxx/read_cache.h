@@ -0,0 +1,124 @@
+/**
+ * read_cache.h - opt-in software cache for remote reads
+ *
+ * When enabled, remote reads through global_ref and upcxx::copy()
+ * gets are served from a per-rank, direct-mapped cache of remote
+ * memory lines.  Reads larger than a cache line bypass the cache.
+ *
+ * The cache is not coherent: it is the responsibility of the
+ * application to enable it only for phases in which the cached data
+ * are not written by other ranks.  Writes by the calling rank through
+ * global_ref assignments and compound assignments and through copy()
+ * update the cached lines, and global_ref::async_apply() drops them
+ * when it is done.  Its other writes do not: put_nb(),
+ * atomic_update() and shared_array::update(), async_copy() puts and
+ * the remote atomics (atomic_op(), fetch_add(), ...) may leave stale
+ * data in the cache.  The whole cache is invalidated by barrier() and
+ * by cache_invalidate(), which also release the buffers of prefetch().
+ */
+
+#pragma once
+
+#include "gasnet_api.h"
+#include "upcxx_runtime.h"
+
+namespace upcxx
+{
+  struct event;
+
+  /**
+   * \ingroup gasgroup
+   * \brief Enable the software read cache
+   *
+   * \param capacity total size of the cache in bytes (0 for the default,
+   *        which is set by the env variable UPCXX_READ_CACHE_SIZE)
+   * \param line_size size of a cache line in bytes, must be a power of two
+   *        (0 for the default, which is set by UPCXX_READ_CACHE_LINE_SIZE)
+   */
+  void cache_enable(size_t capacity = 0, size_t line_size = 0);
+
+  /**
+   * \ingroup gasgroup
+   * \brief Disable the software read cache and release its memory
+   */
+  void cache_disable();
+
+  /**
+   * \ingroup gasgroup
+   * \brief Discard all the cached lines
+   */
+  void cache_invalidate();
+
+  /**
+   * \ingroup gasgroup
+   * \brief Number of remote reads served from the cache
+   */
+  uint64_t cache_hits();
+
+  /**
+   * \ingroup gasgroup
+   * \brief Number of remote reads that had to go to the network
+   */
+  uint64_t cache_misses();
+
+  /// \cond SHOW_INTERNAL
+  extern bool _cache_enabled;
+  extern bool _prefetch_active; // defined in prefetch.cpp
+
+  // Return true if remote reads need to check the cache or the
+  // prefetch buffers
+  static inline bool read_cache_active()
+  {
+    return _cache_enabled || _prefetch_active;
+  }
+
+  // Serve a read from a prefetch buffer, return false if the range
+  // has not been prefetched
+  bool prefetch_get(void *dst, rank_t r, const void *addr, size_t nbytes);
+
+  // Update the prefetch buffer (if any) covering a local write
+  void prefetch_update(rank_t r, void *addr, const void *src, size_t nbytes);
+
+  // Stop serving reads from the prefetch buffers overlapping a range
+  void prefetch_discard(rank_t r, void *addr, size_t nbytes);
+
+  // Release all the prefetch buffers
+  void prefetch_release_all();
+
+  // Read nbytes at addr on rank r into dst through the cache
+  void cache_get(void *dst, rank_t r, const void *addr, size_t nbytes);
+
+  // Update the cached copy (if any) after the calling rank writes
+  // nbytes at addr on rank r
+  void cache_update(rank_t r, void *addr, const void *src, size_t nbytes);
+
+  // Drop the cached copies of nbytes at addr on rank r
+  void cache_invalidate_range(rank_t r, void *addr, size_t nbytes);
+
+  // For a non-blocking write of nbytes at addr on rank r: drop the
+  // cached copies of the range now and return an event for the write.
+  // cache_invalidate_end() drops them again when that event is done and
+  // then signals e, so that reads issued meanwhile can't leave stale
+  // data in the cache.
+  event **cache_invalidate_begin(rank_t r, void *addr, size_t nbytes);
+  void cache_invalidate_end(event **done, rank_t r, void *addr, size_t nbytes,
+                            event *e);
+
+  static inline void cached_get(void *dst, rank_t r, void *addr, size_t nbytes)
+  {
+    if (read_cache_active()) {
+      cache_get(dst, r, addr, nbytes);
+    } else {
+      gasnet_get(dst, r, addr, nbytes);
+    }
+  }
+
+  static inline void cached_put(rank_t r, void *addr, void *src, size_t nbytes)
+  {
+    gasnet_put(r, addr, src, nbytes);
+    if (read_cache_active()) {
+      cache_update(r, addr, src, nbytes);
+    }
+  }
+  /// \endcond
+} // namespace upcxx
@@ -116,14 +116,9 @@ namespace upcxx {
   class reduce {
   private:
     template<class T> static T reduce_internal(T val, upcxx_op_t op) {
-      static T *src, *dst;
-      if (!src) {
-        src = upcxx::allocate<T>(2); // YZ: memory leaking?
-        dst = src + 1;
-      }
-      src[0] = reduce_internal(val, op, 0);
-      upcxx::bcast(src, dst, sizeof(T), 0);
-      return dst[0];
+      T result;
+      upcxx::allreduce(&val, &result, 1, op, datatype_wrapper<T>::value);
+      return result;
     }
 
     template<class T> static T reduce_internal(T val, upcxx_op_t op,
@@ -141,8 +136,7 @@ namespace upcxx {
     template<class T> static void reduce_internal(T *src, T *dst,
                                                   int count,
                                                   upcxx_op_t op) {
-      reduce_internal(src, dst, count, op, 0);
-      upcxx::bcast(dst, dst, count * sizeof(T), 0);
+      upcxx::allreduce(src, dst, count, op, datatype_wrapper<T>::value);
     }
 
     template<class T> static void reduce_internal(T *src, T *dst,
@@ -166,6 +160,80 @@ namespace upcxx {
     UPCXXR_REDUCE_INT_DECLS(band, UPCXX_BAND)
   };
 
+  /**
+   * \ingroup collgroup
+   * Reduce val from all ranks with op and return the result on every
+   * rank
+   */
+  template<class T>
+  UPCXXR_NUMBER_TYPE(T) allreduce(T val, upcxx_op_t op)
+  {
+    T result;
+    upcxx::allreduce(&val, &result, 1, op, datatype_wrapper<T>::value);
+    return result;
+  }
+
+  /**
+   * \ingroup collgroup
+   * Allreduce of count elements, with the data type inferred from T;
+   * src may be dst
+   */
+  template<class T>
+  void allreduce(T *src, T *dst, size_t count, upcxx_op_t op)
+  {
+    upcxx::allreduce(src, dst, count, op, datatype_wrapper<T>::value);
+  }
+
+  /**
+   * \ingroup collgroup
+   * In-place allreduce of count elements of buf
+   */
+  template<class T>
+  void allreduce(T *buf, size_t count, upcxx_op_t op)
+  {
+    upcxx::allreduce(buf, buf, count, op, datatype_wrapper<T>::value);
+  }
+
+  /**
+   * \ingroup collgroup
+   * Allreduce of the elements of local arrays (see interfaces.h)
+   */
+  template<class Array>
+  void allreduce(Array src, Array dst, upcxx_op_t op,
+                 UPCXXR_ARRAY_NUM_TYPE(Array) * = 0)
+  {
+    upcxx::allreduce(src.storage_ptr(), dst.storage_ptr(), src.size(), op);
+  }
+
+  template<class Array>
+  void allreduce(Array buf, upcxx_op_t op,
+                 UPCXXR_ARRAY_NUM_TYPE(Array) * = 0)
+  {
+    upcxx::allreduce(buf.storage_ptr(), buf.storage_ptr(), buf.size(), op);
+  }
+
+  /**
+   * \ingroup collgroup
+   * Non-blocking allreduce of count elements, with the data type
+   * inferred from T, which signals e when done
+   */
+  template<class T>
+  void async_allreduce(T *src, T *dst, size_t count, upcxx_op_t op,
+                       event *e = peek_event())
+  {
+    async_allreduce(src, dst, count, op, datatype_wrapper<T>::value, e);
+  }
+
+  template<class Array>
+  void async_allreduce(Array src, Array dst, upcxx_op_t op,
+                       event *e = peek_event(),
+                       UPCXXR_ARRAY_NUM_TYPE(Array) * = 0)
+  {
+    async_allreduce(src.storage_ptr(), dst.storage_ptr(), src.size(), op,
+                    datatype_wrapper<UPCXXI_ARRAY_ELEM_TYPE(Array)>::value,
+                    e);
+  }
+
 } /* namespace upcxx */
 
 #undef UPCXXR_WRAPPER_DECL
@@ -0,0 +1,69 @@
+/**
+ * segment_stats.h - memory usage statistics of the GASNet segment
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+namespace upcxx
+{
+  /// \cond SHOW_INTERNAL
+  // Classes of callers of segment allocation, for memory usage statistics
+  enum seg_alloc_class_t {
+    SEG_ALLOC_USER = 0,     // allocate() by the application
+    SEG_ALLOC_ARRAY,        // multidimensional array buffers (array_bulk)
+    SEG_ALLOC_TEAM,         // team scratch space
+    SEG_ALLOC_SHARED_ARRAY, // shared_array data
+    SEG_ALLOC_HASH_MAP,     // dist_hash_map tables
+    SEG_ALLOC_RUNTIME,      // other runtime buffers
+    SEG_ALLOC_NUM_CLASSES
+  };
+  /// \endcond
+
+  // Free blocks are counted in power-of-two size buckets starting at
+  // 64 bytes; the last bucket also counts all larger blocks
+#define UPCXX_SEG_HIST_BUCKETS 20
+
+  /**
+   * \ingroup gasgroup
+   * Memory usage of the GASNet segment of the calling rank
+   */
+  struct segment_stats_t {
+    uint64_t segment_size;       /**< size of the segment */
+    uint64_t bytes_in_use;       /**< bytes currently allocated */
+    uint64_t high_water;         /**< maximum of bytes_in_use so far */
+    uint64_t free_bytes;         /**< free bytes in the segment heap */
+    uint64_t num_free_blocks;    /**< number of free blocks */
+    uint64_t largest_free_block; /**< size of the largest free block */
+    uint64_t cached_bytes;       /**< bytes held by the small-block caches */
+    uint64_t symmetric_size;     /**< size of the symmetric heap */
+    uint64_t symmetric_free;     /**< free bytes in the symmetric heap */
+    /** free_hist[i] is the number of free blocks of [64*2^i, 64*2^(i+1)) bytes */
+    uint64_t free_hist[UPCXX_SEG_HIST_BUCKETS];
+    /** number of allocations by class of the caller (see seg_alloc_class_t) */
+    uint64_t alloc_count[SEG_ALLOC_NUM_CLASSES];
+    /** bytes allocated by class of the caller */
+    uint64_t alloc_bytes[SEG_ALLOC_NUM_CLASSES];
+  };
+
+  /**
+   * \ingroup gasgroup
+   * Get the memory usage of the GASNet segment of the calling rank
+   */
+  void segment_stats(segment_stats_t *stats);
+
+  /**
+   * \ingroup gasgroup
+   * Print the memory usage of the GASNet segment of the calling rank
+   */
+  void print_segment_stats(FILE *fp = stderr);
+
+  /// \cond SHOW_INTERNAL
+  // Collectively print the per-rank and aggregated segment usage if
+  // UPCXX_SEGMENT_STATS is set, called by finalize()
+  void report_segment_stats();
+  /// \endcond
+} // namespace upcxx
@@ -8,6 +8,7 @@
 
 #include "global_ref.h"
 #include "coll_flags.h"
+#include "atomic.h"
 
 // #define UPCXX_DEBUG
 
@@ -15,6 +16,26 @@ namespace upcxx
 {
   extern std::vector<void*> *pending_array_inits;
 
+  /// \cond SHOW_INTERNAL
+  // log2(N) if N is a power of two, or -1 otherwise
+  template<size_t N>
+  struct static_log2
+  {
+    enum { value = (N & (N - 1)) ? -1 : 1 + static_log2<N / 2>::value };
+  };
+  template<> struct static_log2<1> { enum { value = 0 }; };
+  template<> struct static_log2<0> { enum { value = -1 }; };
+
+  // log2(x) if x is a power of two, or -1 otherwise
+  static inline int pow2_shift(size_t x)
+  {
+    if (x == 0 || (x & (x - 1)) != 0) return -1;
+    int s = 0;
+    while (((size_t)1 << s) < x) s++;
+    return s;
+  }
+  /// \endcond
+
   /**
    * \ingroup gasgroup
    * \brief shared 1-D array with 1-D block-cyclic distribution
@@ -25,29 +46,160 @@ namespace upcxx
    *
    * In UPC++, the block size (blk_sz) can be changed at runtime
    * by set_blk_sz().
+   *
+   * A symmetric shared array (symmetric = true) is allocated with
+   * symmetric_allocate(), so the data of every rank is addressed by
+   * symmetric_addr() instead of a per-array table of ranks() pointers.
+   * It falls back to the pointer table if the symmetric heap is full.
+   *
+   * Address translation uses shifts and masks instead of divisions if
+   * the block size or ranks() is a power of two, with the shift folded
+   * into a constant if the block size is the template argument BLK_SZ.
+   * Loops over the elements owned by the calling rank should use
+   * local_view(), which accesses them as local memory.
    */
   template<typename T, size_t BLK_SZ = 1>
   struct shared_array
   {
     T *_data;
-    T **_alldata;
+    T **_alldata; // NULL if _data is in the symmetric heap
     size_t _blk_sz; // blocking factor
     size_t _local_size;
     size_t _size;
     size_t _type_size;
+    bool _symmetric;
+    int _blk_shift; // log2(_blk_sz) or -1 if not a power of two
+    int _np_shift;  // log2(ranks()) or -1 if not a power of two, set by init
+
+    enum { _static_blk_shift = static_log2<BLK_SZ>::value };
 
     void global2local(const size_t global_index,
                       size_t &local_index,
                       rank_t &rank)
     {
-      rank_t nplaces = ranks();
-      size_t block_id = global_index / _blk_sz;
-      size_t phase = global_index % _blk_sz;
-      local_index = (block_id / nplaces) * _blk_sz + phase ;
-      rank = block_id % nplaces;
+      size_t block_id, phase;
+      if (_static_blk_shift >= 0 && _blk_sz == BLK_SZ) {
+        block_id = global_index >> (_static_blk_shift < 0 ? 0 : _static_blk_shift);
+        phase = global_index & (BLK_SZ - 1);
+      } else if (_blk_shift >= 0) {
+        block_id = global_index >> _blk_shift;
+        phase = global_index & (_blk_sz - 1);
+      } else {
+        block_id = global_index / _blk_sz;
+        phase = global_index % _blk_sz;
+      }
+
+      size_t round;
+      if (_np_shift >= 0) {
+        round = block_id >> _np_shift;
+        rank = block_id & (((size_t)1 << _np_shift) - 1);
+      } else {
+        rank_t nplaces = ranks();
+        round = block_id / nplaces;
+        rank = block_id % nplaces;
+      }
+      local_index = round * _blk_sz + phase;
     }
 
-    shared_array(size_t size=0, size_t blk_sz=BLK_SZ)
+    /**
+     * A block of elements owned by the calling rank
+     */
+    struct local_block
+    {
+      T *data;             /**< local address of the first element */
+      size_t size;         /**< number of elements in the block */
+      size_t global_index; /**< global index of the first element */
+
+      inline T *begin() const { return data; }
+      inline T *end() const { return data + size; }
+    };
+
+    /**
+     * A view of the elements owned by the calling rank, which is
+     * iterable over its blocks and indexable by local index
+     */
+    struct local_view_t
+    {
+      T *_data;
+      size_t _size;     // number of elements in the view
+      size_t _nblocks;
+      size_t _blk_sz;
+      size_t _stride;   // distance in global index between local blocks
+      size_t _first;    // global index of the first local element
+
+      struct iterator
+      {
+        const local_view_t *_view;
+        size_t _block;
+        local_block _cur;
+
+        inline iterator(const local_view_t *view, size_t block)
+          : _view(view), _block(block)
+        {
+          if (_block < _view->_nblocks) _cur = _view->block(_block);
+        }
+
+        inline const local_block &operator*() const { return _cur; }
+        inline const local_block *operator->() const { return &_cur; }
+
+        inline iterator &operator++()
+        {
+          _block++;
+          if (_block < _view->_nblocks) _cur = _view->block(_block);
+          return *this;
+        }
+
+        inline bool operator==(const iterator &other) const
+        {
+          return _block == other._block;
+        }
+
+        inline bool operator!=(const iterator &other) const
+        {
+          return _block != other._block;
+        }
+      };
+
+      /**
+       * Number of local elements
+       */
+      inline size_t size() const { return _size; }
+
+      /**
+       * Number of local blocks
+       */
+      inline size_t num_blocks() const { return _nblocks; }
+
+      /**
+       * The k-th local block
+       */
+      inline local_block block(size_t k) const
+      {
+        local_block b;
+        b.data = _data + k * _blk_sz;
+        b.global_index = _first + k * _stride;
+        b.size = (k == _nblocks - 1) ? _size - k * _blk_sz : _blk_sz;
+        return b;
+      }
+
+      inline iterator begin() const { return iterator(this, 0); }
+      inline iterator end() const { return iterator(this, _nblocks); }
+
+      /**
+       * The element at local index li
+       */
+      inline T &operator[](size_t li) const { return _data[li]; }
+
+      /**
+       * The global index of the element at local index li
+       */
+      inline size_t global_index(size_t li) const
+      {
+        return _first + (li / _blk_sz) * _stride + li % _blk_sz;
+      }
+    };
+
+    shared_array(size_t size=0, size_t blk_sz=BLK_SZ, bool symmetric=false)
     {
 #ifdef UPCXX_DEBUG
       printf("In shared_array constructor, size %lu\n", size);
@@ -58,6 +210,9 @@ namespace upcxx
       _local_size = 0;
       _size = size;
       _type_size = sizeof(T);
+      _symmetric = symmetric;
+      _blk_shift = pow2_shift(blk_sz);
+      _np_shift = -1;
       if (size != 0)
         init(size, blk_sz);
     }
@@ -75,8 +230,20 @@ namespace upcxx
 
     /**
      * Set the current block size (a.k.a. blocking factor in UPC)
+     *
+     * The existing data are not moved, so they are reinterpreted under
+     * the new layout.  Use redistribute() to keep the element values.
      */
-    inline void set_blk_sz(size_t blk_sz) { _blk_sz = blk_sz; }
+    inline void set_blk_sz(size_t blk_sz)
+    {
+      _blk_sz = blk_sz;
+      _blk_shift = pow2_shift(blk_sz);
+    }
+
+    /**
+     * Allocate the data in the symmetric heap at the next init()
+     */
+    inline void set_symmetric(bool symmetric) { _symmetric = symmetric; }
 
     /**
      * Initialize the shared array, which should be done after upcxx::init().
@@ -98,12 +265,7 @@ namespace upcxx
 
       if (sz == 0) return;
 
-      if (_alldata == NULL) {
-        _alldata = (T **)malloc(ranks() * sizeof(T*));
-        assert(_alldata != NULL);
-      }
-
-      if (_data != NULL) deallocate(_data);
+      if (_data != NULL) free_data();
 
       rank_t np = ranks();
       _size = sz;
@@ -111,10 +273,30 @@ namespace upcxx
         _blk_sz = blk_sz;
       else
         _blk_sz = (sz + np - 1) / np;
+      _blk_shift = pow2_shift(_blk_sz);
+      _np_shift = pow2_shift(np);
       _local_size = ((_size+_blk_sz -1)/_blk_sz + np - 1) / np * _blk_sz;
 
+      if (_symmetric) {
+        // all ranks either succeed or fail together
+        _data = (T*)symmetric_allocate(_local_size * _type_size,
+                                       SEG_ALLOC_SHARED_ARRAY);
+        if (_data != NULL) {
+          if (_alldata != NULL) {
+            free(_alldata);
+            _alldata = NULL;
+          }
+          return;
+        }
+      }
+
+      if (_alldata == NULL) {
+        _alldata = (T **)malloc(ranks() * sizeof(T*));
+        assert(_alldata != NULL);
+      }
+
       // allocate the data space in bytes
-      _data = (T*)allocate(myrank(), _local_size * _type_size).raw_ptr();
+      _data = (T*)seg_allocate(_local_size * _type_size, SEG_ALLOC_SHARED_ARRAY);
       assert(_data != NULL);
 
       // \Todo _data allocated in this way is not aligned!!
@@ -147,9 +329,18 @@ namespace upcxx
     void finalize()
     {
       barrier();
-      if (_alldata) free(_alldata);
       if (_data != NULL)
-        deallocate(_data); // _data is from the global address space
+        free_data(); // _data is from the global address space
+      if (_alldata) free(_alldata);
+    }
+
+    void free_data()
+    {
+      if (_alldata == NULL)
+        symmetric_deallocate(_data);
+      else
+        deallocate(_data);
+      _data = NULL;
     }
 
     /**
@@ -166,6 +357,77 @@ namespace upcxx
       this->init(nblocks*blk_sz, blk_sz);
     }
 
+    /**
+     * Collectively change the block size and move every element to its
+     * owner under the new layout.  Each rank sends its local blocks to
+     * the new owners with non-blocking puts of contiguous runs.  All
+     * ranks switch to the new layout together after all the data have
+     * arrived.
+     *
+     * \param new_blk_sz the new blocking factor (0 for a blocked layout
+     *        with one block per rank, as in init())
+     */
+    void redistribute(size_t new_blk_sz)
+    {
+      if (_data == NULL) {
+        set_blk_sz(new_blk_sz);
+        return;
+      }
+
+      rank_t np = ranks();
+      if (new_blk_sz == 0)
+        new_blk_sz = (_size + np - 1) / np;
+      if (new_blk_sz == _blk_sz) return;
+
+      shared_array<T, BLK_SZ> next(0, new_blk_sz, _symmetric);
+      next.init(_size, new_blk_sz);
+
+      event e;
+      local_view_t v = local_view();
+      for (typename local_view_t::iterator it = v.begin(); it != v.end(); ++it) {
+        next.async_put(it->global_index, it->global_index + it->size,
+                       it->data, &e);
+      }
+      e.wait();
+      barrier(); // all elements are at their new owners
+
+      free_data();
+      if (_alldata != NULL) free(_alldata);
+      _data = next._data;
+      _alldata = next._alldata;
+      _blk_sz = next._blk_sz;
+      _blk_shift = next._blk_shift;
+      _local_size = next._local_size;
+    }
+
+    /**
+     * Return a view of the elements owned by the calling rank.  The
+     * view is invalidated by init() and set_blk_sz().
+     *
+     * \see gups.cpp
+     */
+    local_view_t local_view()
+    {
+      local_view_t v;
+      rank_t np = ranks();
+      rank_t me = myrank();
+      size_t total_blocks = (_size + _blk_sz - 1) / _blk_sz;
+      v._data = _data;
+      v._blk_sz = _blk_sz;
+      v._stride = np * _blk_sz;
+      v._first = me * _blk_sz;
+      v._nblocks = (me < total_blocks) ? (total_blocks - me + np - 1) / np : 0;
+      v._size = 0;
+      if (v._nblocks > 0) {
+        // the last block of the array may be partial
+        size_t last_start = v._first + (v._nblocks - 1) * v._stride;
+        size_t last_size = _size - last_start;
+        if (last_size > _blk_sz) last_size = _blk_sz;
+        v._size = (v._nblocks - 1) * _blk_sz + last_size;
+      }
+      return v;
+    }
+
     global_ref<T> operator [] (size_t global_index)
     {
       // address translation
@@ -181,8 +443,127 @@ namespace upcxx
              global_index, local_index, rank);
 #endif
       // only works with statically declared (and presumably aligned) data
-      return global_ref<T>(rank, &_alldata[rank][local_index]);
+      return global_ref<T>(rank, rank_data(rank) + local_index);
+    }
+
+    /**
+     * Copy elements [begin, end) of the shared array to dst without
+     * blocking.  The range is transferred with one copy per contiguous
+     * run of elements owned by the same rank, by memcpy if the owner
+     * shares memory with the calling rank.
+     *
+     * \param begin the global index of the first element
+     * \param end the global index after the last element
+     * \param dst the local destination buffer of (end - begin) elements
+     * \param e the event to be signaled after the transfers are done
+     */
+    void async_get(size_t begin, size_t end, T *dst, event *e = peek_event())
+    {
+      copy_range(begin, end, dst, true, e);
+    }
+
+    /**
+     * Copy src to elements [begin, end) of the shared array without
+     * blocking, split by owner as in async_get()
+     *
+     * \param begin the global index of the first element
+     * \param end the global index after the last element
+     * \param src the local source buffer of (end - begin) elements
+     * \param e the event to be signaled after the transfers are done
+     */
+    void async_put(size_t begin, size_t end, const T *src, event *e = peek_event())
+    {
+      copy_range(begin, end, (T *)src, false, e);
+    }
+
+    /**
+     * Atomically apply op (e.g., UPCXX_ATOMIC_FETCH_XOR) with value to
+     * the element at global_index without waiting for it.  Updates to
+     * the same rank are sent together in large messages and applied by
+     * the owner; call flush_updates() to wait until they are done.
+     * T must be a type supported by the remote atomics.
+     */
+    template<typename V>
+    void update(size_t global_index, atomic_op_t op, V value)
+    {
+      size_t local_index;
+      rank_t rank;
+      global2local(global_index, local_index, rank);
+      T val = value;
+      update_nb(rank, rank_data(rank) + local_index,
+                atomic_type_traits<T>::type, op, &val);
+    }
+
+    /**
+     * Wait until all updates issued by the calling rank are applied.
+     * Call barrier() after it to make all updates visible everywhere.
+     */
+    void flush_updates()
+    {
+      update_flush();
+    }
+
+    /// \cond SHOW_INTERNAL
+    // The base address of the data of rank r
+    inline T *rank_data(rank_t r)
+    {
+      if (_alldata == NULL)
+        return (T *)symmetric_addr(_data, r);
+      return _alldata[r];
+    }
+
+    void copy_run(rank_t r, size_t local_index, size_t count, T *buf,
+                  bool is_get, event *e)
+    {
+      T *remote = rank_data(r) + local_index;
+      T *local = (r == myrank()) ? remote :
+        (T *)pshm_remote_addr2local(r, remote);
+      if (local != NULL) {
+        if (is_get)
+          memcpy(buf, local, count * sizeof(T));
+        else
+          memcpy(local, buf, count * sizeof(T));
+      } else if (is_get) {
+        async_copy(global_ptr<T>(remote, r), global_ptr<T>(buf), count, e);
+      } else {
+        async_copy(global_ptr<T>(buf), global_ptr<T>(remote, r), count, e);
+      }
+    }
+
+    void copy_range(size_t begin, size_t end, T *buf, bool is_get, event *e)
+    {
+      assert(begin <= end && end <= _size);
+
+      // the current run of elements on one rank
+      rank_t run_rank = 0;
+      size_t run_index = 0, run_count = 0;
+      T *run_buf = buf;
+
+      size_t i = begin;
+      while (i < end) {
+        size_t local_index;
+        rank_t r;
+        global2local(i, local_index, r);
+        size_t n = _blk_sz - (i % _blk_sz); // the rest of the block
+        if (n > end - i) n = end - i;
+
+        if (run_count > 0 && r == run_rank &&
+            local_index == run_index + run_count) {
+          run_count += n; // e.g., consecutive blocks on one rank
+        } else {
+          if (run_count > 0)
+            copy_run(run_rank, run_index, run_count, run_buf, is_get, e);
+          run_rank = r;
+          run_index = local_index;
+          run_buf = buf + (i - begin);
+          run_count = n;
+        }
+        i += n;
+      }
+      if (run_count > 0)
+        copy_run(run_rank, run_index, run_count, run_buf, is_get, e);
     }
+    /// \endcond
   }; // struct shared_array
 
   // init should be called by all processes
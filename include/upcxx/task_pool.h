@@ -0,0 +1,146 @@
+/**
+ * task_pool.h - distributed work-stealing task pool
+ *
+ * See test_task_pool.cpp for usage examples
+ */
+
+#pragma once
+
+#include "gasnet_api.h"
+#include "upcxx_runtime.h"
+
+namespace upcxx
+{
+  /// \cond SHOW_INTERNAL
+  /*
+   * The type-independent part of task_pool.  Each rank keeps its
+   * tasks, task_size bytes each, in a deque: the owner pushes and pops
+   * at the bottom and thieves take from the top.  A rank without tasks
+   * steals about half of the tasks of a random victim with an active
+   * message.  Termination is detected with the four-counter method: a
+   * token visits all the idle ranks and sums how many tasks they
+   * spawned and executed, and rank 0 declares termination when two
+   * consecutive waves see the same sums and they are equal.
+   */
+  class task_pool_base
+  {
+  public:
+    task_pool_base(size_t task_size);
+    ~task_pool_base();
+
+    void init();
+    void push(const void *task);
+    bool next_task(void *task);
+    size_t local_size() const { return _count; }
+    uint64_t num_stolen() const { return _stolen; }
+
+    // AM payloads
+    struct steal_am_t {
+      task_pool_base *victim;
+      task_pool_base *thief;
+    };
+
+    struct steal_reply_t {
+      task_pool_base *thief;
+      size_t ntasks; // followed by the tasks
+    };
+
+    struct token_am_t {
+      task_pool_base *pool;
+      uint64_t spawned;
+      uint64_t executed;
+    };
+
+    static void steal_am_handler(gasnet_token_t token, void *buf, size_t nbytes);
+    static void steal_reply_handler(gasnet_token_t token, void *buf, size_t nbytes);
+    static void token_am_handler(gasnet_token_t token, void *buf, size_t nbytes);
+    static void terminate_am_handler(gasnet_token_t token, void *buf, size_t nbytes);
+
+  private:
+    size_t _task_size;
+    task_pool_base **_pools; // the pool objects of all ranks
+
+    // circular deque of tasks, _top is the index of the oldest one
+    char *_buf;
+    size_t _capacity;
+    size_t _top;
+    size_t _count;
+    upcxx_mutex_t _lock;
+
+    bool _running;               // a task returned by next_task() runs
+    uint64_t _spawned;
+    uint64_t _executed;
+    uint64_t _stolen;            // # of tasks stolen by this rank
+    volatile bool _steal_in_flight;
+    unsigned int _seed;          // for choosing victims
+
+    // termination detection
+    volatile bool _token_arrived;
+    uint64_t _token_spawned;
+    uint64_t _token_executed;
+    bool _wave_active;           // rank 0 only
+    uint64_t _last_spawned;      // sums of the last wave, rank 0 only
+    uint64_t _last_executed;
+    volatile bool _terminated;
+
+    task_pool_base(const task_pool_base &);
+    task_pool_base &operator=(const task_pool_base &);
+
+    void grow();
+    bool pop_bottom(void *task);
+    size_t pop_top(void *tasks, size_t max_tasks);
+    void push_tasks(const void *tasks, size_t n);
+    void send_steal();
+    void send_token(rank_t r, uint64_t spawned, uint64_t executed);
+    void progress_termination();
+  };
+  /// \endcond
+
+  /**
+   * \ingroup asyncgroup
+   * A pool of tasks of type T, which must be copyable with memcpy,
+   * balanced dynamically across ranks by work stealing.
+   *
+   * Tasks are added with spawn(), before run() or by the tasks
+   * themselves.  run() is collective: every rank executes its own
+   * tasks newest first, steals the oldest half of the tasks of a
+   * random rank when it has none left, and returns when all the
+   * tasks in the pool have been executed.
+   *
+   * Example:
+   * \code
+   * task_pool<node_t> pool;
+   * void visit(const node_t &n) { ... pool.spawn(child); ... }
+   * pool.init();
+   * if (myrank() == 0) pool.spawn(root);
+   * pool.run(visit);
+   * \endcode
+   */
+  template<typename T>
+  class task_pool : public task_pool_base
+  {
+  public:
+    task_pool() : task_pool_base(sizeof(T)) { }
+
+    /**
+     * Add a task to the deque of the calling rank
+     */
+    void spawn(const T &task)
+    {
+      push(&task);
+    }
+
+    /**
+     * Collectively execute the tasks with fn(task) until the pool is
+     * empty on all ranks.  fn may spawn more tasks.
+     */
+    template<typename Function>
+    void run(Function fn)
+    {
+      T task;
+      while (next_task(&task)) {
+        fn(task);
+      }
+    }
+  };
+} // namespace upcxx
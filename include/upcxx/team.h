@@ -17,6 +17,7 @@
 #include "coll_flags.h"
 #include "utils.h"
 #include "reduce.h"
+#include "read_cache.h"
 
 /// \cond SHOW_INTERNAL
 
@@ -97,6 +98,7 @@ namespace upcxx
         }
       }
       assert(rv == GASNET_OK);
+      if (read_cache_active()) cache_invalidate();
       return UPCXX_SUCCESS;
 
     }
@@ -128,16 +130,7 @@ namespace upcxx
     inline int allgather(void *src, void *dst, size_t nbytes) const
     {
       assert(_gasnet_team != NULL);
-      // YZ: gasnet_coll_gather_all is broken with Intel compiler on Linux!
-      /*
-      gasnet_coll_gather_all(_gasnet_team, dst, src, nbytes, 
-                             UPCXX_GASNET_COLL_FLAG);
-      */
-      void *temp = allocate(nbytes * size());
-      assert(temp != NULL);
-      gather(src, temp, nbytes, 0);
-      bcast(temp, dst, nbytes * size(), 0);
-      deallocate(temp);
+      coll_allgather(_gasnet_team, src, dst, nbytes);
       return UPCXX_SUCCESS;
     }
 
@@ -147,6 +140,26 @@ namespace upcxx
                            UPCXX_GASNET_COLL_FLAG);
     }
 
+    template<class T>
+    void alltoallv(const T *src, const size_t *send_counts,
+                   const size_t *send_displs, T *dst,
+                   const size_t *recv_counts, const size_t *recv_displs) const
+    {
+      assert(_gasnet_team != NULL);
+      coll_alltoallv(_gasnet_team, src, send_counts, send_displs, dst,
+                     recv_counts, recv_displs, sizeof(T), NULL);
+    }
+
+    template<class T>
+    void alltoallv(const T *src, const size_t *send_counts,
+                   const size_t *send_displs, std::vector<T> &dst,
+                   std::vector<size_t> *recv_counts = NULL) const
+    {
+      assert(_gasnet_team != NULL);
+      coll_alltoallv_auto(_gasnet_team, src, send_counts, send_displs, dst,
+                          recv_counts);
+    }
+
     template<class T>
     int reduce(T *src, T *dst, size_t count, uint32_t root,
                upcxx_op_t op) const
@@ -158,7 +171,92 @@ namespace upcxx
                          UPCXX_GASNET_COLL_FLAG);
       return UPCXX_SUCCESS;
     }
-    
+
+    template<class T>
+    int allreduce(T *src, T *dst, size_t count, upcxx_op_t op) const
+    {
+      assert(_gasnet_team != NULL);
+      coll_allreduce(_gasnet_team, src, dst, count, op,
+                     datatype_wrapper<T>::value);
+      return UPCXX_SUCCESS;
+    }
+
+    template<class T>
+    T allreduce(T val, upcxx_op_t op) const
+    {
+      T result;
+      allreduce(&val, &result, 1, op);
+      return result;
+    }
+
+    /**
+     * Non-blocking collectives on the team, which signal event e when
+     * done (see async_bcast() and friends in collective.h)
+     */
+    inline void async_bcast(void *src, void *dst, size_t nbytes,
+                            uint32_t root, event *e = peek_event()) const
+    {
+      assert(_gasnet_team != NULL);
+      coll_async_bcast(_gasnet_team, src, dst, nbytes, root, e);
+    }
+
+    inline void async_gather(void *src, void *dst, size_t nbytes,
+                             uint32_t root, event *e = peek_event()) const
+    {
+      assert(_gasnet_team != NULL);
+      coll_async_gather(_gasnet_team, src, dst, nbytes, root, e);
+    }
+
+    inline void async_scatter(void *src, void *dst, size_t nbytes,
+                              uint32_t root, event *e = peek_event()) const
+    {
+      assert(_gasnet_team != NULL);
+      coll_async_scatter(_gasnet_team, src, dst, nbytes, root, e);
+    }
+
+    inline void async_alltoall(void *src, void *dst, size_t nbytes,
+                               event *e = peek_event()) const
+    {
+      assert(_gasnet_team != NULL);
+      coll_async_alltoall(_gasnet_team, src, dst, nbytes, e);
+    }
+
+    template<class T>
+    void async_reduce(T *src, T *dst, size_t count, uint32_t root,
+                      upcxx_op_t op, event *e = peek_event()) const
+    {
+      assert(_gasnet_team != NULL);
+      coll_async_reduce(_gasnet_team, src, dst, count, root, op,
+                        datatype_wrapper<T>::value, e);
+    }
+
+    template<class T>
+    void async_allreduce(T *src, T *dst, size_t count, upcxx_op_t op,
+                         event *e = peek_event()) const
+    {
+      assert(_gasnet_team != NULL);
+      coll_async_allreduce(_gasnet_team, src, dst, count, op,
+                           datatype_wrapper<T>::value, e);
+    }
+
+    template<class T>
+    void async_alltoallv(const T *src, const size_t *send_counts,
+                         const size_t *send_displs, T *dst,
+                         const size_t *recv_counts,
+                         const size_t *recv_displs,
+                         event *e = peek_event()) const
+    {
+      assert(_gasnet_team != NULL);
+      coll_alltoallv(_gasnet_team, src, send_counts, send_displs, dst,
+                     recv_counts, recv_displs, sizeof(T), e);
+    }
+
+    inline void async_barrier(event *e = peek_event()) const
+    {
+      assert(_gasnet_team != NULL);
+      coll_async_barrier(_gasnet_team, e);
+    }
+
     /**
      * Translate a rank in a team to its global rank
      */
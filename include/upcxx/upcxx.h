@@ -24,9 +24,13 @@
 #include "upcxx_runtime.h"
 #include "team.h"
 #include "allocate.h"
+#include "segment_stats.h"
 #include "event.h"
 #include "global_ptr.h"
 #include "async_copy.h"
+#include "write_combine.h"
+#include "read_cache.h"
+#include "prefetch.h"
 #include "queue.h"
 #include "lock.h"
 #include "shared_var.h"
@@ -36,6 +40,8 @@
 #include "collective.h"
 #include "shared_array.h"
 #include "atomic.h"
+#include "dist_hash_map.h"
+#include "task_pool.h"
 #include "progress_thread.h"
 
 #endif /* UPCXX_H_ */
@@ -15,20 +15,23 @@
 namespace upcxx 
 {
   /// \cond SHOW_INTERNAL
+  // followed by count size_t allocation sizes
   struct alloc_am_t
   {
-    size_t nbytes;
-    void **ptr_addr;
+    size_t count;
+    global_ptr<void> *ptrs_addr;
     event *cb_event;
   };
 
+  // followed by count void* allocated addresses
   struct alloc_reply_t
   {
-    void **ptr_addr;
-    void *ptr;
+    size_t count;
+    global_ptr<void> *ptrs_addr;
     event *cb_event;
   };
 
+  // FREE_CPU_AM carries an array of free_am_t
   struct free_am_t
   {
     void *ptr;
@@ -76,6 +79,52 @@ namespace upcxx
     return advance_in_task_queue(in_task_queue, max_dispatched);
   }
   
+  // Send the queued frees of remote memory
+  void flush_remote_frees();
+
+  // Small operations queued per target rank and sent in batches, each
+  // a medium AM of handler carrying a header of header_nbytes followed
+  // by the entries (am_batcher.cpp).  A batch is sent when it is full,
+  // when flushed, or by advance(), which only visits the targets with
+  // queued entries.  prepare(), if not NULL, is called before sending
+  // the batch buf for rank r and may fill in its header; if it returns
+  // false the batch stays queued and is retried later.  The am_batch_*
+  // functions are called with am_batcher_lock() held.
+  struct am_batch_t;
+  struct am_batcher_t {
+    gasnet_handler_t handler;
+    size_t header_nbytes;
+    size_t max_nbytes;
+    size_t max_count;             // the maximum number of entries
+    bool (*prepare)(rank_t r, char *buf, size_t nbytes);
+    am_batch_t *batches;          // per rank, NULL until initialized
+  };
+
+  void am_batcher_init(am_batcher_t *b, gasnet_handler_t handler,
+                       size_t header_nbytes, size_t max_nbytes,
+                       size_t max_count,
+                       bool (*prepare)(rank_t, char *, size_t) = NULL);
+  void am_batcher_lock();
+  void am_batcher_unlock();
+  // Return the header of the batch for rank r, or NULL if it is empty
+  char *am_batch_header(am_batcher_t *b, rank_t r);
+  // Add an entry of nbytes to the batch for rank r and return it to be
+  // filled in; a batch that can't hold it is sent first.  A new batch
+  // starts with a zeroed header.
+  char *am_batch_append(am_batcher_t *b, rank_t r, size_t nbytes);
+  // Send the batch for rank r if it is full, after an entry is filled in
+  void am_batch_commit(am_batcher_t *b, rank_t r);
+  // Send the batch for rank r now; return false if prepare() refused
+  bool am_batch_send(am_batcher_t *b, rank_t r);
+  // Send the batch for rank r, making progress until prepare() agrees;
+  // the lock is released meanwhile
+  void am_batch_send_wait(am_batcher_t *b, rank_t r);
+  // Send the queued batches of b (for rank r only), without the lock held
+  void am_batcher_flush(am_batcher_t *b);
+  void am_batcher_flush(am_batcher_t *b, rank_t r);
+  // Send the queued batches of all batchers, called by advance()
+  void am_batcher_progress();
+
   // AM handler functions
   void async_am_handler(gasnet_token_t token, void *am, size_t nbytes);
   void async_done_am_handler(gasnet_token_t token, void *am, size_t nbytes);
@@ -85,6 +134,8 @@ namespace upcxx
   void free_cpu_am_handler(gasnet_token_t token, void *am, size_t nbytes);
   void free_gpu_am_handler(gasnet_token_t token, void *am, size_t nbytes);
   void inc_am_handler(gasnet_token_t token, void *am, size_t nbytes);
+  void write_combine_am_handler(gasnet_token_t token, void *am, size_t nbytes);
+  void write_combine_reply_handler(gasnet_token_t token, void *reply, size_t nbytes);
 
   MEDIUM_HANDLER_DECL(copy_and_signal_request, 4, 8);
   SHORT_HANDLER_DECL(copy_and_signal_reply, 2, 4);
@@ -114,6 +165,17 @@ namespace upcxx
   extern int env_use_dmapp; // defined in upcxx_runtime.cpp
 
 
+  // Symmetric heap at the bottom of the segment (symmetric.cpp).
+  // init_symmetric_heap returns the number of bytes it reserves.
+  extern size_t symmetric_heap_size;
+  size_t init_symmetric_heap();
+  size_t symmetric_heap_free_bytes();
+
+  static inline bool is_symmetric_addr(const void *p)
+  {
+    return (uintptr_t)p - (uintptr_t)my_gasnet_seginfo->addr < symmetric_heap_size;
+  }
+
   static inline void init_gasnet_seg_mspace()
   {
     all_gasnet_seginfo =
@@ -125,17 +187,38 @@ namespace upcxx
 
     my_gasnet_seginfo = &all_gasnet_seginfo[gasnet_mynode()];
 
-    _gasnet_mspace = create_mspace_with_base(my_gasnet_seginfo->addr,
-                                             my_gasnet_seginfo->size, 1);
+    size_t sym_size = init_symmetric_heap();
+    _gasnet_mspace = create_mspace_with_base((char *)my_gasnet_seginfo->addr + sym_size,
+                                             my_gasnet_seginfo->size - sym_size, 1);
     assert(_gasnet_mspace != 0);
 
     // Set the mspace limit to the gasnet segment size so it won't go outside.
-    mspace_set_footprint_limit(_gasnet_mspace, my_gasnet_seginfo->size);
+    mspace_set_footprint_limit(_gasnet_mspace, my_gasnet_seginfo->size - sym_size);
   }
 
   void gasnet_seg_free(void *p);
-  void *gasnet_seg_memalign(size_t nbytes, size_t alignment);
-  void *gasnet_seg_alloc(size_t nbytes);
+  void *gasnet_seg_memalign(size_t nbytes, size_t alignment,
+                            seg_alloc_class_t c = SEG_ALLOC_RUNTIME);
+  void *gasnet_seg_alloc(size_t nbytes, seg_alloc_class_t c = SEG_ALLOC_RUNTIME);
+
+  // Segment usage accounting (segment_stats.cpp)
+  void seg_stats_alloc(size_t nbytes, seg_alloc_class_t c);
+  void seg_stats_free(size_t nbytes);
+
+#if defined(UPCXX_THREAD_SAFE) || defined(GASNET_PAR)
+  extern upcxx_mutex_t upcxxi_mutex_for_memory;
+#endif
+
+  // Per-thread caches of small segment blocks (seg_cache.cpp).
+  // seg_cache_alloc returns NULL if nbytes is too large to be cached;
+  // seg_cache_free returns false if p is not a cached block.
+#define SEG_CACHE_ALIGN 64
+  void *seg_cache_alloc(size_t nbytes);
+  bool seg_cache_free(void *p);
+  // the block size of p if it is a cached block, or 0 otherwise
+  size_t seg_cache_usable_size(void *p);
+  // the bytes of segment chunks used by the caches
+  size_t seg_cache_bytes();
 
   // Return the supernode of node n in GASNet
   static inline gasnet_node_t gasnet_supernode_of(gasnet_node_t n)
@@ -152,6 +235,79 @@ namespace upcxx
   }
 #endif
   
+  // Point-to-point messages of the collectives implemented by UPC++
+  // (coll_msg.cpp).  A collective calls coll_post to receive into buf
+  // the messages tagged with its team key and sequence number, sends
+  // its data to offsets of the peers' buffers with coll_send, and
+  // waits for the bytes of each step with coll_wait.  If step_offsets
+  // is given, the offsets of the messages of step k are relative to
+  // step_offsets[k].
+  struct coll_msg_t {
+    uint64_t key;
+    uint32_t seq;
+    uint32_t step;
+    size_t offset;
+  };
+
+  struct coll_recv_t;
+  uint64_t coll_team_key(gasnet_team_handle_t team);
+  // Register the key of a team created by splitting parent (team::split)
+  void coll_team_split(gasnet_team_handle_t parent, gasnet_team_handle_t child,
+                       uint32_t color);
+  uint32_t coll_next_seq(uint64_t key);
+  coll_recv_t *coll_post(uint64_t key, uint32_t seq, void *buf,
+                         uint32_t nsteps, const size_t *step_offsets = NULL);
+  void coll_unpost(coll_recv_t *c);
+  size_t coll_received(coll_recv_t *c, uint32_t step);
+  void coll_wait(coll_recv_t *c, uint32_t step, size_t nbytes);
+  void coll_send(rank_t r, uint64_t key, uint32_t seq, uint32_t step,
+                 size_t offset, const void *src, size_t nbytes);
+  void coll_msg_am_handler(gasnet_token_t token, void *buf, size_t nbytes);
+
+  // Local reductions with the functions of the GASNet reductions
+  // (collective.cpp): inout[i] = inout[i] op in[i]
+  size_t coll_datatype_size(upcxx_datatype_t dt);
+  void coll_reduce_local(void *inout, const void *in, size_t count,
+                         upcxx_datatype_t dt, upcxx_op_t op);
+
+  // An outstanding non-blocking collective (async_coll.cpp).
+  // progress() returns true when the collective is done.
+  struct async_coll_t {
+    bool (*progress)(async_coll_t *op);
+    event *e;
+    gasnet_coll_handle_t h;       // for the GASNet collectives
+    // for the collectives done in steps of coll_msg messages
+    gasnet_team_handle_t team;
+    uint32_t me;                  // team rank
+    uint32_t n;                   // team size
+    uint64_t key;
+    uint32_t seq;
+    uint32_t nsteps;
+    uint32_t step;                // the current step
+    bool sent;                    // the data of the step has been sent
+    coll_recv_t *recv;
+    char *scratch;                // receives the data of the steps
+    void *dst;
+    size_t count;
+    size_t nbytes;
+    upcxx_datatype_t dt;
+    upcxx_op_t op;
+    size_t elem_size;
+    // for alltoallv (alltoallv.cpp), in elements of elem_size bytes
+    const char *src;
+    const size_t *send_counts;
+    const size_t *send_displs;
+    const size_t *recv_counts;
+  };
+
+  // Allocate a collective on team that makes progress with progress()
+  async_coll_t *new_async_coll(gasnet_team_handle_t team,
+                               bool (*progress)(async_coll_t *));
+  // Register op, which signals e when done
+  void async_coll_start(async_coll_t *op, event *e);
+  // Make progress on the outstanding collectives, called by advance()
+  void async_coll_progress();
+
   void init_pshm_teams(const gasnet_nodeinfo_t *nodeinfo_from_gasnet,
                        uint32_t num_nodes);
 } // namespace upcxx
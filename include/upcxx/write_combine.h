@@ -0,0 +1,71 @@
+/**
+ * write_combine.h - write-combining buffers for small remote puts
+ *
+ * put_nb() stores small values into a per-destination buffer instead
+ * of issuing one network put per value.  A buffer is shipped to its
+ * destination as a single active message, which applies all the
+ * buffered writes in the AM handler, when it gets full, by advance(),
+ * or when flush() is called.  Writes to the same rank are applied in
+ * the order they were issued: at most one buffer per destination is in
+ * flight, so put_nb() may wait for the previous one to be applied, and
+ * a write too large to be combined waits for the buffered ones.  The
+ * data is guaranteed to be visible at the destination only after
+ * flush() or async_wait() returns.
+ */
+
+#pragma once
+
+#include "gasnet_api.h"
+#include "global_ptr.h"
+
+namespace upcxx
+{
+  /**
+   * \ingroup gasgroup
+   * \brief Buffer a small write to a remote location
+   *
+   * \param dst the global address to be written
+   * \param src the local address of the data
+   * \param nbytes the number of bytes to be written
+   */
+  void put_nb(global_ptr<void> dst, const void *src, size_t nbytes);
+
+  /**
+   * \ingroup gasgroup
+   * \brief Buffer a write of val to a remote location
+   *
+   * \tparam T type of the element
+   * \param dst the global address to be written
+   * \param val the value to be written
+   */
+  template<typename T>
+  inline void put_nb(global_ptr<T> dst, const T& val)
+  {
+    put_nb(global_ptr<void>(dst), &val, sizeof(T));
+  }
+
+  /**
+   * \ingroup gasgroup
+   * \brief Send out all the buffered put_nb writes and wait until
+   * they are applied at their destinations
+   */
+  void flush();
+
+  /// \cond SHOW_INTERNAL
+  struct write_combine_am_t {
+    event *ack_event;
+    size_t nbytes; // payload bytes after this header
+  };
+
+  // Each buffered write is a header followed by its data, padded
+  // to keep the next header aligned.
+  struct write_combine_entry_t {
+    void *addr;
+    size_t nbytes;
+  };
+
+  struct write_combine_reply_t {
+    event *ack_event;
+  };
+  /// \endcond
+} // namespace upcxx
@@ -0,0 +1,94 @@
+/**
+ * allgather.cpp - allgather with point-to-point messages into the
+ * destination buffers
+ *
+ * Small allgathers use Bruck's variant of recursive doubling, which
+ * takes ceil(log2(n)) steps for any team size n.  Large ones use a
+ * ring of n-1 steps, each moving one block to the next rank, which
+ * sends every block over every link only once.
+ */
+
+#include "upcxx.h"
+#include "upcxx/upcxx_internal.h"
+
+namespace upcxx
+{
+  // The largest total size (nbytes * team size) done by recursive
+  // doubling; larger allgathers use the ring
+  static size_t allgather_ring_threshold = 0;
+
+  // Send blocks [first, first+count) mod n of dst, n blocks in all
+  static void send_blocks(rank_t r, uint64_t key, uint32_t seq, uint32_t step,
+                          const char *dst, uint32_t first, uint32_t count,
+                          uint32_t n, size_t nbytes)
+  {
+    uint32_t count1 = (count < n - first) ? count : n - first;
+    coll_send(r, key, seq, step, first * nbytes, dst + first * nbytes,
+              count1 * nbytes);
+    if (count > count1) {
+      coll_send(r, key, seq, step, 0, dst, (count - count1) * nbytes);
+    }
+  }
+
+  static void allgather_bruck(gasnet_team_handle_t team, uint64_t key,
+                              uint32_t seq, uint32_t me, uint32_t n,
+                              char *dst, size_t nbytes)
+  {
+    uint32_t nsteps = 0;
+    while ((1u << nsteps) < n) nsteps++;
+
+    coll_recv_t *c = coll_post(key, seq, dst, nsteps);
+    // before step k, the rank holds the 2^k blocks starting at its own
+    // and it receives the next ones from the rank 2^k after it
+    uint32_t step = 0;
+    for (uint32_t dist = 1; dist < n; dist <<= 1, step++) {
+      uint32_t count = (dist < n - dist) ? dist : n - dist;
+      rank_t to = gasnete_coll_team_rank2node(team, (me + n - dist) % n);
+      send_blocks(to, key, seq, step, dst, me, count, n, nbytes);
+      coll_wait(c, step, count * nbytes);
+    }
+    coll_unpost(c);
+  }
+
+  static void allgather_ring(gasnet_team_handle_t team, uint64_t key,
+                             uint32_t seq, uint32_t me, uint32_t n,
+                             char *dst, size_t nbytes)
+  {
+    coll_recv_t *c = coll_post(key, seq, dst, n - 1);
+    rank_t right = gasnete_coll_team_rank2node(team, (me + 1) % n);
+    // in step s, pass on the block received in step s-1
+    for (uint32_t s = 0; s < n - 1; s++) {
+      uint32_t blk = (me + n - s) % n;
+      coll_send(right, key, seq, s, blk * nbytes, dst + blk * nbytes, nbytes);
+      coll_wait(c, s, nbytes);
+    }
+    coll_unpost(c);
+  }
+
+  void coll_allgather(gasnet_team_handle_t team, const void *src, void *dst,
+                      size_t nbytes)
+  {
+    uint32_t n = gasnete_coll_team_size(team);
+    uint32_t me = gasnete_coll_team_node2rank(team, global_myrank());
+    char *out = (char *)dst;
+
+    if (src != out + me * nbytes) {
+      memcpy(out + me * nbytes, src, nbytes);
+    }
+    if (n == 1 || nbytes == 0) return;
+
+    if (allgather_ring_threshold == 0) {
+      allgather_ring_threshold =
+        gasnett_getenv_int_withdefault("UPCXX_ALLGATHER_RING_THRESHOLD",
+                                       65536, 1);
+    }
+
+    uint64_t key = coll_team_key(team);
+    uint32_t seq = coll_next_seq(key);
+    if (nbytes * n <= allgather_ring_threshold) {
+      allgather_bruck(team, key, seq, me, n, out, nbytes);
+    } else {
+      allgather_ring(team, key, seq, me, n, out, nbytes);
+    }
+  }
+} // namespace upcxx
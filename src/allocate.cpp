@@ -1,118 +1,203 @@
+#include <vector>
+
 #include "upcxx.h"
 #include "upcxx/upcxx_internal.h"
 
 namespace upcxx
 {
-  global_ptr<void> allocate(rank_t rank, size_t nbytes)
+  // Queued frees of remote memory per target rank, batches of free_am_t
+  static am_batcher_t free_batcher;
+
+  static inline void *local_alloc(size_t nbytes,
+                                  seg_alloc_class_t c = SEG_ALLOC_USER)
   {
     void *addr;
+#ifdef USE_GASNET_FAST_SEGMENT
+    addr = gasnet_seg_alloc(nbytes, c);
+#else
+    addr = malloc(nbytes);
+#endif
+    return addr;
+  }
 
-    if (rank == global_myrank()) {
+  void *seg_allocate(size_t nbytes, seg_alloc_class_t c)
+  {
+    void *addr = local_alloc(nbytes, c);
+    if (addr == NULL) {
+      fprintf(stderr, "Memory allocation error");
+    }
+    return addr;
+  }
+
+  static inline void local_free(void *ptr)
+  {
 #ifdef USE_GASNET_FAST_SEGMENT
-      addr = gasnet_seg_alloc(nbytes);
+    gasnet_seg_free(ptr);
 #else
-      addr = malloc(nbytes);
+    free(ptr);
 #endif
-      if (addr == NULL) {
-        fprintf(stderr, "Memory allocation error");
+  }
+
+  void allocate_nb(rank_t rank, size_t count, const size_t *sizes,
+                   global_ptr<void> *ptrs, event *e)
+  {
+    if (rank == global_myrank()) {
+      for (size_t i = 0; i < count; i++) {
+        void *addr = local_alloc(sizes[i]);
+        if (addr == NULL) {
+          fprintf(stderr, "Memory allocation error");
+        }
+        ptrs[i] = global_ptr<void>(addr, rank);
       }
-    } else {
-      event e;
-      e.incref();
-      alloc_am_t am = { nbytes, &addr, &e };
-      UPCXX_CALL_GASNET(gasnet_AMRequestMedium0(rank, ALLOC_CPU_AM, &am, sizeof(am)));
-      e.wait();
+      return;
+    }
+
+    // Send the sizes in as few messages as possible, limited by the
+    // size of both the request and the reply
+    size_t max_count = (gasnet_AMMaxMedium() - sizeof(alloc_am_t)) / sizeof(size_t);
+    size_t max_reply_count = (gasnet_AMMaxMedium() - sizeof(alloc_reply_t)) / sizeof(void *);
+    if (max_reply_count < max_count) max_count = max_reply_count;
+
+    std::vector<char> buf;
+    for (size_t i = 0; i < count; i += max_count) {
+      size_t n = (count - i < max_count) ? count - i : max_count;
+      buf.resize(sizeof(alloc_am_t) + n * sizeof(size_t));
+      alloc_am_t *am = (alloc_am_t *)&buf[0];
+      am->count = n;
+      am->ptrs_addr = ptrs + i;
+      am->cb_event = e;
+      memcpy(am + 1, sizes + i, n * sizeof(size_t));
+      e->incref();
+      UPCXX_CALL_GASNET(
+          GASNET_CHECK_RV(gasnet_AMRequestMedium0(rank, ALLOC_CPU_AM,
+                                                  &buf[0], buf.size())));
     }
-    global_ptr<void> ptr(addr, rank);
+  }
+
+  global_ptr<void> allocate(rank_t rank, size_t nbytes)
+  {
+    event e;
+    global_ptr<void> ptr;
+    allocate_nb(rank, 1, &nbytes, &ptr, &e);
+    e.wait();
 
 #ifdef DEBUG
-    fprintf(stderr, "allocated %llu bytes at %p on node %d\n", nbytes, addr, rank);
+    fprintf(stderr, "allocated %llu bytes at %p on node %d\n", nbytes, ptr.raw_ptr(), rank);
 #endif
 
     return ptr;
   }
 
+  value_future< global_ptr<void> > async_allocate(rank_t rank, size_t nbytes)
+  {
+    value_future< global_ptr<void> > f;
+    allocate_nb(rank, 1, &nbytes, f.value_addr(), f.get_event());
+    return f;
+  }
+
+  std::vector< global_ptr<void> > allocate(rank_t rank,
+                                           const std::vector<size_t> &sizes)
+  {
+    std::vector< global_ptr<void> > ptrs(sizes.size());
+    if (sizes.empty()) return ptrs;
+
+    event e;
+    allocate_nb(rank, sizes.size(), &sizes[0], &ptrs[0], &e);
+    e.wait();
+    return ptrs;
+  }
+
+  void flush_remote_frees()
+  {
+    am_batcher_flush(&free_batcher);
+  }
+
   void deallocate(global_ptr<void> ptr)
   {
     if (ptr.where() == global_myrank()) {
-#ifdef USE_GASNET_FAST_SEGMENT
-      gasnet_seg_free(ptr.raw_ptr());
-#else
-      free(ptr.raw_ptr());
-#endif
+      local_free(ptr.raw_ptr());
     } else {
-      free_am_t am;
-      am.ptr = ptr.raw_ptr();
-      UPCXX_CALL_GASNET(gasnet_AMRequestMedium0(ptr.where(), FREE_CPU_AM, &am, sizeof(am)));
+      am_batcher_lock();
+      if (free_batcher.batches == NULL)
+        am_batcher_init(&free_batcher, FREE_CPU_AM, 0, gasnet_AMMaxMedium(),
+                        gasnet_AMMaxMedium() / sizeof(free_am_t));
+      free_am_t *am = (free_am_t *)am_batch_append(&free_batcher, ptr.where(),
+                                                   sizeof(free_am_t));
+      am->ptr = ptr.raw_ptr();
+      am_batch_commit(&free_batcher, ptr.where());
+      am_batcher_unlock();
     }
   }
 
   void deallocate(void *ptr)
   {
-#ifdef USE_GASNET_FAST_SEGMENT
-    gasnet_seg_free(ptr);
-#else
-    free(ptr);
-#endif
+    local_free(ptr);
   } 
 
   void alloc_cpu_am_handler(gasnet_token_t token, void *buf, size_t nbytes)
   {
     assert(buf != NULL);
-    assert(nbytes == sizeof(alloc_am_t));
     alloc_am_t *am = (alloc_am_t *)buf;
+    assert(nbytes == sizeof(alloc_am_t) + am->count * sizeof(size_t));
+    size_t *sizes = (size_t *)(am + 1);
 
 #ifdef UPCXX_DEBUG
     std::cerr << "Rank " << global_myrank() << " is inside alloc_cpu_am_handler.\n";
 #endif
 
-    alloc_reply_t reply;
-    reply.ptr_addr = am->ptr_addr; // pass back the ptr_addr from the scr node
-#ifdef USE_GASNET_FAST_SEGMENT
-    reply.ptr = gasnet_seg_alloc(am->nbytes);
-#else
-    reply.ptr = malloc(am->nbytes);
-#endif
+    std::vector<char> reply_buf(sizeof(alloc_reply_t) + am->count * sizeof(void *));
+    alloc_reply_t *reply = (alloc_reply_t *)&reply_buf[0];
+    void **ptrs = (void **)(reply + 1);
+    reply->count = am->count;
+    reply->ptrs_addr = am->ptrs_addr; // pass back the ptrs_addr from the scr node
+    reply->cb_event = am->cb_event;
+    for (size_t i = 0; i < am->count; i++) {
+      ptrs[i] = local_alloc(sizes[i]);
 
 #ifdef UPCXX_DEBUG
-    assert(reply.ptr != NULL);
-    std::cerr << "Rank " << global_myrank() << " allocated " << am->nbytes
-              << " memory at " << reply.ptr << "\n";
+      assert(ptrs[i] != NULL);
+      std::cerr << "Rank " << global_myrank() << " allocated " << sizes[i]
+                << " memory at " << ptrs[i] << "\n";
 #endif
+    }
 
-    reply.cb_event = am->cb_event;
-    GASNET_CHECK_RV(gasnet_AMReplyMedium0(token, ALLOC_REPLY, &reply, sizeof(reply)));
+    GASNET_CHECK_RV(gasnet_AMReplyMedium0(token, ALLOC_REPLY,
+                                          &reply_buf[0], reply_buf.size()));
   }
 
   void alloc_reply_handler(gasnet_token_t token, void *buf, size_t nbytes)
   {
     // internal error checking
     assert(buf != NULL);
-    assert(nbytes == sizeof(alloc_reply_t));
+    alloc_reply_t *reply = (alloc_reply_t *)buf;
+    assert(nbytes == sizeof(alloc_reply_t) + reply->count * sizeof(void *));
     // end of internal error checking
 
-    alloc_reply_t *reply = (alloc_reply_t *)buf;
+    gasnet_node_t src;
+    GASNET_CHECK_RV(gasnet_AMGetMsgSource(token, &src));
+    void **ptrs = (void **)(reply + 1);
 
 #ifdef UPCXX_DEBUG
-    std::cerr << "Rank " << global_myrank() << " is in alloc_reply_handler. reply->ptr "
-              << reply->ptr << "\n";
+    std::cerr << "Rank " << global_myrank() << " is in alloc_reply_handler. count "
+              << reply->count << "\n";
 #endif
 
-    *(reply->ptr_addr) = reply->ptr;
+    for (size_t i = 0; i < reply->count; i++) {
+      reply->ptrs_addr[i] = global_ptr<void>(ptrs[i], src);
+    }
     reply->cb_event->decref();
   }
 
   void free_cpu_am_handler(gasnet_token_t token, void *buf, size_t nbytes)
   {
     assert(buf != NULL);
-    assert(nbytes == sizeof(free_am_t));
     free_am_t *am = (free_am_t *)buf;
-    if (am->ptr != NULL) {
-#ifdef USE_GASNET_FAST_SEGMENT
-      gasnet_seg_free(am->ptr);
-#else
-      free(am->ptr);
-#endif
+    size_t n = nbytes / sizeof(free_am_t);
+    assert(nbytes == n * sizeof(free_am_t));
+    for (size_t i = 0; i < n; i++) {
+      if (am[i].ptr != NULL) {
+        local_free(am[i].ptr);
+      }
     }
   }
 } // namespace upcxx
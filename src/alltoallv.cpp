@@ -0,0 +1,85 @@
+/**
+ * alltoallv.cpp - alltoallv with point-to-point messages into the
+ * destination buffers
+ *
+ * The ranks exchange their data in n steps of a pairwise schedule: in
+ * step s, rank i sends its block for rank i+s and receives the block
+ * of rank i-s (mod n), and it starts a step only when it has received
+ * the data of the previous one.  So each rank receives from one peer
+ * at a time instead of from all of them at once.
+ */
+
+#include "upcxx.h"
+#include "upcxx/upcxx_internal.h"
+
+namespace upcxx
+{
+  static bool progress_alltoallv(async_coll_t *op)
+  {
+    size_t es = op->elem_size;
+    while (op->step < op->n) {
+      uint32_t to = (op->me + op->step) % op->n;
+      uint32_t from = (op->me + op->n - op->step) % op->n;
+      if (!op->sent) {
+        coll_send(gasnete_coll_team_rank2node(op->team, to), op->key, op->seq,
+                  op->step, 0, op->src + op->send_displs[to] * es,
+                  op->send_counts[to] * es);
+        op->sent = true;
+      }
+      if (coll_received(op->recv, op->step) < op->recv_counts[from] * es) {
+        return false;
+      }
+      op->step++;
+      op->sent = false;
+    }
+    return true;
+  }
+
+  void coll_alltoallv(gasnet_team_handle_t team, const void *src,
+                      const size_t *send_counts, const size_t *send_displs,
+                      void *dst, const size_t *recv_counts,
+                      const size_t *recv_displs, size_t elem_size, event *e)
+  {
+    async_coll_t *op = new_async_coll(team, progress_alltoallv);
+    op->src = (const char *)src;
+    op->send_counts = send_counts;
+    op->send_displs = send_displs;
+    op->recv_counts = recv_counts;
+    op->elem_size = elem_size;
+    op->key = coll_team_key(team);
+    op->seq = coll_next_seq(op->key);
+    op->nsteps = op->n;
+
+    // the data of step s comes from rank me-s
+    size_t *offsets = new size_t[op->n];
+    for (uint32_t s = 0; s < op->n; s++) {
+      offsets[s] = recv_displs[(op->me + op->n - s) % op->n] * elem_size;
+    }
+    op->recv = coll_post(op->key, op->seq, dst, op->n, offsets);
+    delete [] offsets;
+
+    if (e != NULL) {
+      async_coll_start(op, e);
+    } else {
+      event done;
+      async_coll_start(op, &done);
+      done.wait();
+    }
+  }
+
+  void coll_alltoallv_counts(gasnet_team_handle_t team,
+                             const size_t *send_counts, size_t *recv_counts)
+  {
+    uint32_t n = gasnete_coll_team_size(team);
+    size_t *ones = new size_t[n];
+    size_t *displs = new size_t[n];
+    for (uint32_t i = 0; i < n; i++) {
+      ones[i] = 1;
+      displs[i] = i;
+    }
+    coll_alltoallv(team, send_counts, ones, displs, recv_counts, ones, displs,
+                   sizeof(size_t), NULL);
+    delete [] ones;
+    delete [] displs;
+  }
+} // namespace upcxx
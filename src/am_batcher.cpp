@@ -0,0 +1,170 @@
+/**
+ * am_batcher.cpp - queue small operations per target rank and send
+ * them in batches of active messages
+ */
+
+#include <vector>
+
+#include "upcxx.h"
+#include "upcxx/upcxx_internal.h"
+
+// #define UPCXX_DEBUG
+
+namespace upcxx
+{
+  struct am_batch_t {
+    std::vector<char> buf; // the header followed by the entries
+    size_t count;          // the number of entries
+    bool queued;           // on the dirty list
+  };
+
+  // The targets that may have queued entries, shared by all batchers,
+  // so that advance() only visits those
+  static std::vector< std::pair<am_batcher_t *, rank_t> > *am_dirty = NULL;
+  static volatile int am_num_dirty = 0;
+
+#if defined(UPCXX_THREAD_SAFE) || defined(GASNET_PAR)
+  static upcxx_mutex_t am_batch_lock = UPCXX_MUTEX_INITIALIZER;
+#endif
+
+  void am_batcher_lock()
+  {
+    upcxx_mutex_lock(&am_batch_lock);
+  }
+
+  void am_batcher_unlock()
+  {
+    upcxx_mutex_unlock(&am_batch_lock);
+  }
+
+  void am_batcher_init(am_batcher_t *b, gasnet_handler_t handler,
+                       size_t header_nbytes, size_t max_nbytes,
+                       size_t max_count,
+                       bool (*prepare)(rank_t, char *, size_t))
+  {
+    if (am_dirty == NULL)
+      am_dirty = new std::vector< std::pair<am_batcher_t *, rank_t> >;
+    b->handler = handler;
+    b->header_nbytes = header_nbytes;
+    b->max_nbytes = max_nbytes;
+    b->max_count = max_count;
+    b->prepare = prepare;
+    b->batches = new am_batch_t[global_ranks()];
+    for (rank_t r = 0; r < global_ranks(); r++) {
+      b->batches[r].count = 0;
+      b->batches[r].queued = false;
+    }
+  }
+
+  char *am_batch_header(am_batcher_t *b, rank_t r)
+  {
+    am_batch_t &batch = b->batches[r];
+    return batch.buf.empty() ? NULL : &batch.buf[0];
+  }
+
+  bool am_batch_send(am_batcher_t *b, rank_t r)
+  {
+    am_batch_t &batch = b->batches[r];
+    if (batch.buf.empty()) return true;
+    if (b->prepare != NULL && !(*b->prepare)(r, &batch.buf[0], batch.buf.size()))
+      return false;
+
+#ifdef UPCXX_DEBUG
+    fprintf(stderr, "Rank %u sends a batch of %lu entries (%lu bytes) to rank %u\n",
+            global_myrank(), batch.count, batch.buf.size(), r);
+#endif
+
+    UPCXX_CALL_GASNET(
+        GASNET_CHECK_RV(gasnet_AMRequestMedium0(r, b->handler, &batch.buf[0],
+                                                batch.buf.size())));
+    batch.buf.clear();
+    batch.count = 0;
+    return true;
+  }
+
+  void am_batch_send_wait(am_batcher_t *b, rank_t r)
+  {
+    while (!am_batch_send(b, r)) {
+      am_batcher_unlock();
+      advance();
+      am_batcher_lock();
+    }
+  }
+
+  char *am_batch_append(am_batcher_t *b, rank_t r, size_t nbytes)
+  {
+    am_batch_t &batch = b->batches[r];
+    if (!batch.buf.empty() && batch.buf.size() + nbytes > b->max_nbytes) {
+      am_batch_send_wait(b, r);
+    }
+    if (batch.buf.empty()) {
+      batch.buf.reserve(b->max_nbytes);
+      batch.buf.resize(b->header_nbytes, 0);
+      if (!batch.queued) {
+        batch.queued = true;
+        am_dirty->push_back(std::make_pair(b, r));
+        am_num_dirty++;
+      }
+    }
+    size_t offset = batch.buf.size();
+    batch.buf.resize(offset + nbytes);
+    batch.count++;
+    return &batch.buf[offset];
+  }
+
+  void am_batch_commit(am_batcher_t *b, rank_t r)
+  {
+    am_batch_t &batch = b->batches[r];
+    if (batch.count >= b->max_count || batch.buf.size() >= b->max_nbytes) {
+      am_batch_send(b, r);
+    }
+  }
+
+  void am_batcher_flush(am_batcher_t *b, rank_t r)
+  {
+    if (am_num_dirty == 0) return;
+    am_batcher_lock();
+    if (b->batches != NULL) am_batch_send_wait(b, r);
+    am_batcher_unlock();
+  }
+
+  void am_batcher_flush(am_batcher_t *b)
+  {
+    if (am_num_dirty == 0) return;
+    am_batcher_lock();
+    if (b->batches == NULL) {
+      am_batcher_unlock();
+      return;
+    }
+    std::vector<rank_t> targets;
+    for (size_t i = 0; i < am_dirty->size(); i++) {
+      if ((*am_dirty)[i].first == b) targets.push_back((*am_dirty)[i].second);
+    }
+    for (size_t i = 0; i < targets.size(); i++) {
+      am_batch_send_wait(b, targets[i]);
+    }
+    am_batcher_unlock();
+  }
+
+  void am_batcher_progress()
+  {
+    if (am_num_dirty == 0) return;
+
+    am_batcher_lock();
+    std::vector< std::pair<am_batcher_t *, rank_t> > dirty;
+    dirty.swap(*am_dirty);
+    am_num_dirty = 0;
+    for (size_t i = 0; i < dirty.size(); i++) {
+      am_batcher_t *b = dirty[i].first;
+      rank_t r = dirty[i].second;
+      b->batches[r].queued = false;
+      if (!am_batch_send(b, r)) {
+        // not ready to be sent yet, try again later
+        b->batches[r].queued = true;
+        am_dirty->push_back(dirty[i]);
+        am_num_dirty++;
+      }
+    }
+    am_batcher_unlock();
+  }
+} // namespace upcxx
@@ -34,9 +34,9 @@
 #define SUNPACK(a0) ((size_t)UNPACK(a0))
 #define SUNPACK2(a0, a1) ((size_t)UNPACK2(a0, a1))
 
-#define upcxxa_malloc_handlersafe(s) gasnet_seg_alloc(s)
+#define upcxxa_malloc_handlersafe(s) gasnet_seg_alloc(s, SEG_ALLOC_ARRAY)
 #define upcxxa_free_handlersafe(p)   gasnet_seg_free(p)
-#define upcxxa_malloc(s)             gasnet_seg_alloc(s)
+#define upcxxa_malloc(s)             gasnet_seg_alloc(s, SEG_ALLOC_ARRAY)
 #define upcxxa_free(p)               gasnet_seg_free(p)
 
 /* look into how to sync puts in UPC++ */
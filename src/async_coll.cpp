@@ -0,0 +1,444 @@
+/**
+ * async_coll.cpp - non-blocking collectives
+ *
+ * A non-blocking collective is kept in a list of outstanding
+ * collectives until it is done, and advance() makes progress on all
+ * of them.  bcast, gather, scatter, alltoall and reduce use the
+ * non-blocking GASNet collectives; allreduce and barrier run as a
+ * sequence of steps of point-to-point messages (coll_msg.cpp).
+ */
+
+#include <list>
+#include <vector>
+
+#include "upcxx.h"
+#include "upcxx/upcxx_internal.h"
+
+// #define UPCXX_DEBUG
+
+namespace upcxx
+{
+  static std::list<async_coll_t *> *async_colls = NULL;
+  static volatile int async_coll_num_pending = 0;
+
+#if defined(UPCXX_THREAD_SAFE) || defined(GASNET_PAR)
+  static upcxx_mutex_t async_coll_lock = UPCXX_MUTEX_INITIALIZER;
+#endif
+
+  async_coll_t *new_async_coll(gasnet_team_handle_t team,
+                               bool (*progress)(async_coll_t *))
+  {
+    async_coll_t *op = new async_coll_t;
+    memset(op, 0, sizeof(async_coll_t));
+    op->progress = progress;
+    op->team = team;
+    op->n = gasnete_coll_team_size(team);
+    op->me = gasnete_coll_team_node2rank(team, global_myrank());
+    return op;
+  }
+
+  // Free the native state of a collective
+  static void free_async_coll(async_coll_t *op)
+  {
+    if (op->recv != NULL) coll_unpost(op->recv);
+    free(op->scratch);
+    delete op;
+  }
+
+  void async_coll_start(async_coll_t *op, event *e)
+  {
+    op->e = e;
+    e->incref();
+    // start the first steps right away
+    if ((*op->progress)(op)) {
+      free_async_coll(op);
+      e->decref();
+      return;
+    }
+    upcxx_mutex_lock(&async_coll_lock);
+    if (async_colls == NULL) async_colls = new std::list<async_coll_t *>;
+    async_colls->push_back(op);
+    async_coll_num_pending++;
+    upcxx_mutex_unlock(&async_coll_lock);
+  }
+
+  void async_coll_progress()
+  {
+    if (async_coll_num_pending == 0) return;
+
+    std::list<async_coll_t *> done;
+    upcxx_mutex_lock(&async_coll_lock);
+    std::list<async_coll_t *>::iterator it = async_colls->begin();
+    while (it != async_colls->end()) {
+      if ((*(*it)->progress)(*it)) {
+        done.push_back(*it);
+        it = async_colls->erase(it);
+        async_coll_num_pending--;
+      } else {
+        ++it;
+      }
+    }
+    upcxx_mutex_unlock(&async_coll_lock);
+
+    for (it = done.begin(); it != done.end(); ++it) {
+      event *e = (*it)->e;
+      free_async_coll(*it);
+      e->decref();
+    }
+  }
+
+  /*
+   * Collectives done by GASNet
+   */
+  static bool progress_gasnet(async_coll_t *op)
+  {
+    int rv;
+    UPCXX_CALL_GASNET(rv = gasnet_coll_try_sync(op->h));
+    return (rv == GASNET_OK);
+  }
+
+  void coll_async_bcast(gasnet_team_handle_t team, void *src, void *dst,
+                        size_t nbytes, uint32_t root, event *e)
+  {
+    async_coll_t *op = new_async_coll(team, progress_gasnet);
+    UPCXX_CALL_GASNET(op->h = gasnet_coll_broadcast_nb(team, dst, root, src,
+                                                       nbytes,
+                                                       UPCXX_GASNET_COLL_FLAG));
+    async_coll_start(op, e);
+  }
+
+  void coll_async_gather(gasnet_team_handle_t team, void *src, void *dst,
+                         size_t nbytes, uint32_t root, event *e)
+  {
+    async_coll_t *op = new_async_coll(team, progress_gasnet);
+    UPCXX_CALL_GASNET(op->h = gasnet_coll_gather_nb(team, root, dst, src,
+                                                    nbytes,
+                                                    UPCXX_GASNET_COLL_FLAG));
+    async_coll_start(op, e);
+  }
+
+  void coll_async_scatter(gasnet_team_handle_t team, void *src, void *dst,
+                          size_t nbytes, uint32_t root, event *e)
+  {
+    async_coll_t *op = new_async_coll(team, progress_gasnet);
+    UPCXX_CALL_GASNET(op->h = gasnet_coll_scatter_nb(team, dst, root, src,
+                                                     nbytes,
+                                                     UPCXX_GASNET_COLL_FLAG));
+    async_coll_start(op, e);
+  }
+
+  void coll_async_alltoall(gasnet_team_handle_t team, void *src, void *dst,
+                           size_t nbytes, event *e)
+  {
+    async_coll_t *op = new_async_coll(team, progress_gasnet);
+    UPCXX_CALL_GASNET(op->h = gasnet_coll_exchange_nb(team, dst, src, nbytes,
+                                                      UPCXX_GASNET_COLL_FLAG));
+    async_coll_start(op, e);
+  }
+
+  void coll_async_reduce(gasnet_team_handle_t team, void *src, void *dst,
+                         size_t count, uint32_t root, upcxx_op_t op_code,
+                         upcxx_datatype_t dt, event *e)
+  {
+    async_coll_t *op = new_async_coll(team, progress_gasnet);
+    UPCXX_CALL_GASNET(op->h = gasnet_coll_reduce_nb(team, root, dst, src, 0, 0,
+                                                    coll_datatype_size(dt),
+                                                    count, dt, op_code,
+                                                    UPCXX_GASNET_COLL_FLAG));
+    async_coll_start(op, e);
+  }
+
+  /*
+   * Collectives done in steps.  The describe function of a collective
+   * tells what a rank sends and receives in a step; the rank first
+   * sends, then waits for the data of the step and combines it into
+   * or copies it to its destination.
+   */
+  struct coll_step_t {
+    int to;                       // team rank to send to, or -1
+    const void *send;
+    size_t send_nbytes;
+    size_t send_offset;           // in the receive buffer of the peer
+    int from;                     // team rank to receive from, or -1
+    size_t recv_nbytes;
+    const char *recv_data;        // where the received data lands
+    void *recv_dst;               // where it goes, NULL to drop it
+    bool combine;                 // reduce it into recv_dst
+  };
+
+  static uint32_t log2_ceil(uint32_t n)
+  {
+    uint32_t l = 0;
+    while ((1u << l) < n) l++;
+    return l;
+  }
+
+  static bool progress_steps(async_coll_t *op,
+                             void (*describe)(async_coll_t *, coll_step_t *))
+  {
+    while (op->step < op->nsteps) {
+      coll_step_t s;
+      memset(&s, 0, sizeof(s));
+      s.to = s.from = -1;
+      (*describe)(op, &s);
+      if (s.to >= 0 && !op->sent) {
+        coll_send(gasnete_coll_team_rank2node(op->team, s.to), op->key,
+                  op->seq, op->step, s.send_offset, s.send, s.send_nbytes);
+        op->sent = true;
+      }
+      if (s.from >= 0) {
+        if (coll_received(op->recv, op->step) < s.recv_nbytes) return false;
+        if (s.recv_dst == NULL || s.recv_nbytes == 0) {
+          // nothing to keep
+        } else if (s.combine) {
+          coll_reduce_local(s.recv_dst, s.recv_data,
+                            s.recv_nbytes / op->elem_size, op->dt, op->op);
+        } else {
+          memcpy(s.recv_dst, s.recv_data, s.recv_nbytes);
+        }
+      }
+      op->step++;
+      op->sent = false;
+    }
+    return true;
+  }
+
+  // Post the receive of a collective of nsteps steps into the scratch
+  // buffer, with the data of step k at step_offsets[k] if given
+  static void start_steps(async_coll_t *op, uint32_t nsteps,
+                          size_t scratch_nbytes, const size_t *step_offsets,
+                          event *e)
+  {
+    op->key = coll_team_key(op->team);
+    op->seq = coll_next_seq(op->key);
+    op->nsteps = nsteps;
+    op->scratch = (char *)malloc(scratch_nbytes + 1);
+    assert(op->scratch != NULL);
+    op->recv = coll_post(op->key, op->seq, op->scratch, nsteps, step_offsets);
+    async_coll_start(op, e);
+  }
+
+  // Dissemination barrier: in step k, signal the rank 2^k after and
+  // wait for the rank 2^k before
+  static void barrier_step(async_coll_t *op, coll_step_t *s)
+  {
+    static char token = 0;
+    uint32_t dist = 1u << op->step;
+    s->to = (op->me + dist) % op->n;
+    s->send = &token;
+    s->send_nbytes = 1;
+    s->send_offset = op->step;
+    s->from = (op->me + op->n - dist) % op->n;
+    s->recv_nbytes = 1;
+  }
+
+  static bool progress_barrier(async_coll_t *op)
+  {
+    return progress_steps(op, barrier_step);
+  }
+
+  void coll_async_barrier(gasnet_team_handle_t team, event *e)
+  {
+    async_coll_t *op = new_async_coll(team, progress_barrier);
+    uint32_t nsteps = log2_ceil(op->n);
+    start_steps(op, nsteps, nsteps, NULL, e);
+  }
+
+  /*
+   * Allreduce.  With n = 2^L + rem ranks, the first step folds the
+   * first 2*rem ranks in pairs (the even rank sends its data to the odd
+   * one) and the last step returns the result to the even ranks of the
+   * pairs, so the steps in between run on 2^L ranks.  For small data,
+   * they exchange and combine the whole data in L steps of recursive
+   * doubling.  For large data, L steps of recursive halving leave each
+   * rank with one reduced block of 1/2^L of the data
+   * (reduce-scatter), and L steps of recursive doubling collect the
+   * blocks on all ranks (allgather), which moves about 2x the data per
+   * rank instead of L times.
+   */
+  static size_t allreduce_rsag_threshold = 0;
+
+  struct allreduce_layout_t {
+    uint32_t L;                   // log2 of the ranks after the fold
+    uint32_t rem;                 // the number of folded pairs
+    bool folded;                  // an even rank of a pair
+    uint32_t newrank;             // rank among the 2^L ranks
+  };
+
+  static void allreduce_layout(async_coll_t *op, uint32_t L,
+                               allreduce_layout_t *l)
+  {
+    l->L = L;
+    l->rem = op->n - (1u << L);
+    l->folded = (op->me < 2 * l->rem && op->me % 2 == 0);
+    l->newrank = (op->me < 2 * l->rem) ? op->me / 2 : op->me - l->rem;
+  }
+
+  static int allreduce_rank(const allreduce_layout_t *l, uint32_t newrank)
+  {
+    return (newrank < l->rem) ? newrank * 2 + 1 : newrank + l->rem;
+  }
+
+  // The fold step and the last step, both with the whole data
+  static bool allreduce_edge_step(async_coll_t *op,
+                                  const allreduce_layout_t *l,
+                                  coll_step_t *s)
+  {
+    bool last = (op->step == op->nsteps - 1);
+    if (op->step != 0 && !last) return false;
+    if (op->me < 2 * l->rem) {
+      bool sender = ((op->me % 2 == 0) != last);
+      if (sender) {
+        s->to = last ? op->me - 1 : op->me + 1;
+        s->send = op->dst;
+        s->send_nbytes = op->nbytes;
+      } else {
+        s->from = last ? op->me + 1 : op->me - 1;
+        s->recv_nbytes = op->nbytes;
+        s->recv_data = op->scratch;
+        s->recv_dst = op->dst;
+        s->combine = !last;
+      }
+    }
+    return true;
+  }
+
+  static void allreduce_rd_step(async_coll_t *op, coll_step_t *s)
+  {
+    allreduce_layout_t l;
+    allreduce_layout(op, op->nsteps - 2, &l);
+    if (allreduce_edge_step(op, &l, s) || l.folded) return;
+
+    // the data of step k lands at k*nbytes of the scratch buffer
+    uint32_t partner = l.newrank ^ (1u << (op->step - 1));
+    s->to = s->from = allreduce_rank(&l, partner);
+    s->send = op->dst;
+    s->send_nbytes = op->nbytes;
+    s->send_offset = op->step * op->nbytes;
+    s->recv_nbytes = op->nbytes;
+    s->recv_data = op->scratch + op->step * op->nbytes;
+    s->recv_dst = op->dst;
+    s->combine = true;
+  }
+
+  static bool progress_allreduce_rd(async_coll_t *op)
+  {
+    return progress_steps(op, allreduce_rd_step);
+  }
+
+  // The byte offset of block b of the 2^L blocks of the data
+  static size_t block_offset(async_coll_t *op, uint32_t L, uint32_t b)
+  {
+    return (op->count * b >> L) * op->elem_size;
+  }
+
+  // The scratch buffer holds the data of the fold step, the allgather
+  // steps (at the offsets of their blocks) and the last step in its
+  // first nbytes, and the data of reduce-scatter step k after that,
+  // at rs_offset(k)
+  static size_t rs_offset(async_coll_t *op, const allreduce_layout_t *l,
+                          uint32_t k)
+  {
+    size_t offset = op->nbytes;
+    for (uint32_t i = 1; i < k; i++) {
+      uint32_t mask = (1u << l->L) >> i;
+      uint32_t lo = (l->newrank & ~(mask - 1));
+      offset += block_offset(op, l->L, lo + mask) - block_offset(op, l->L, lo);
+    }
+    return offset;
+  }
+
+  static void allreduce_rsag_step(async_coll_t *op, coll_step_t *s)
+  {
+    allreduce_layout_t l;
+    allreduce_layout(op, (op->nsteps - 2) / 2, &l);
+    if (allreduce_edge_step(op, &l, s) || l.folded) return;
+
+    uint32_t L = l.L;
+    uint32_t mask, lo, plo;
+    if (op->step <= L) {
+      // reduce-scatter: keep the half of the blocks with mine and send
+      // the other half to the partner, which keeps that one
+      mask = (1u << L) >> op->step;
+      lo = l.newrank & ~(mask - 1);
+      plo = lo ^ mask;
+      s->send_offset = 0;
+      s->recv_data = op->scratch + rs_offset(op, &l, op->step);
+      s->recv_dst = (char *)op->dst + block_offset(op, L, lo);
+      s->combine = true;
+      s->send = (char *)op->dst + block_offset(op, L, plo);
+      s->send_nbytes = block_offset(op, L, plo + mask) - block_offset(op, L, plo);
+      s->recv_nbytes = block_offset(op, L, lo + mask) - block_offset(op, L, lo);
+    } else {
+      // allgather: send my reduced blocks and get those of the partner
+      mask = 1u << (op->step - L - 1);
+      lo = l.newrank & ~(mask - 1);
+      plo = lo ^ mask;
+      s->send_offset = block_offset(op, L, lo);
+      s->recv_data = op->scratch + block_offset(op, L, plo);
+      s->recv_dst = (char *)op->dst + block_offset(op, L, plo);
+      s->combine = false;
+      s->send = (char *)op->dst + block_offset(op, L, lo);
+      s->send_nbytes = block_offset(op, L, lo + mask) - block_offset(op, L, lo);
+      s->recv_nbytes = block_offset(op, L, plo + mask) - block_offset(op, L, plo);
+    }
+    s->to = s->from = allreduce_rank(&l, l.newrank ^ mask);
+  }
+
+  static bool progress_allreduce_rsag(async_coll_t *op)
+  {
+    return progress_steps(op, allreduce_rsag_step);
+  }
+
+  void coll_async_allreduce(gasnet_team_handle_t team, void *src, void *dst,
+                            size_t count, upcxx_op_t op_code,
+                            upcxx_datatype_t dt, event *e)
+  {
+    async_coll_t *op = new_async_coll(team, progress_allreduce_rd);
+    op->dst = dst;
+    op->count = count;
+    op->dt = dt;
+    op->op = op_code;
+    op->elem_size = coll_datatype_size(dt);
+    op->nbytes = count * op->elem_size;
+    if (src != dst) memcpy(dst, src, op->nbytes);
+    if (op->n == 1 || count == 0) {
+      delete op;
+      return;
+    }
+
+    if (allreduce_rsag_threshold == 0) {
+      allreduce_rsag_threshold =
+        gasnett_getenv_int_withdefault("UPCXX_ALLREDUCE_RSAG_THRESHOLD",
+                                       16384, 1);
+    }
+
+    // the largest power of two not greater than n
+    uint32_t L = log2_ceil(op->n);
+    if ((1u << L) > op->n) L--;
+    if (L > 0 && op->nbytes > allreduce_rsag_threshold &&
+        count >= (1u << L)) {
+      allreduce_layout_t l;
+      allreduce_layout(op, L, &l);
+      uint32_t nsteps = 2 * L + 2;
+      std::vector<size_t> offsets(nsteps, 0);
+      for (uint32_t k = 1; k <= L; k++) offsets[k] = rs_offset(op, &l, k);
+      op->progress = progress_allreduce_rsag;
+      // each reduce-scatter block may have one element more than the
+      // average, so their data takes at most nbytes + 2^L elements
+      start_steps(op, nsteps,
+                  2 * op->nbytes + (1u << L) * op->elem_size,
+                  &offsets[0], e);
+    } else {
+      start_steps(op, L + 2, (L + 2) * op->nbytes, NULL, e);
+    }
+  }
+
+  void coll_allreduce(gasnet_team_handle_t team, void *src, void *dst,
+                      size_t count, upcxx_op_t op, upcxx_datatype_t dt)
+  {
+    event done;
+    coll_async_allreduce(team, src, dst, count, op, dt, &done);
+    done.wait();
+  }
+} // namespace upcxx
@@ -5,6 +5,200 @@
 
 namespace upcxx
 {
+  event **allocate_events(uint32_t num_events);
+  void deallocate_events(uint32_t num_events, event **events);
+
+  /*
+   * Staging of local buffers outside of the GASNet segment
+   *
+   * RDMA from or to local memory that is not in the registered
+   * segment is slow or not supported on some conduits.  Blocking
+   * copies stage such buffers through a small pool of bounce buffers
+   * in the segment, chunked and pipelined.  Non-blocking copies stage
+   * through a temporary segment buffer that is released when the
+   * transfer completes.
+   */
+#define UPCXX_MAX_BOUNCE_BUFS 16
+
+  static char *bounce_bufs[UPCXX_MAX_BOUNCE_BUFS];
+  static bool bounce_busy[UPCXX_MAX_BOUNCE_BUFS]; // claimed by a copy
+  static int num_bounce_bufs = 0;
+  static size_t bounce_buf_size = 0;
+  static int env_stage_nonseg_copy = -1;
+  static uint64_t num_staged_copies = 0;
+
+#if defined(UPCXX_THREAD_SAFE) || defined(GASNET_PAR)
+  static upcxx_mutex_t bounce_lock = UPCXX_MUTEX_INITIALIZER;
+#endif
+
+  uint64_t staged_copy_count()
+  {
+    return num_staged_copies;
+  }
+
+  // Return true if the local buffer needs to be staged, called with
+  // bounce_lock held
+  static bool need_staging(const void *p, size_t nbytes)
+  {
+    if (env_stage_nonseg_copy < 0) {
+      env_stage_nonseg_copy =
+        gasnett_getenv_yesno_withdefault("UPCXX_STAGE_NONSEG_COPY", 1);
+      if (env_stage_nonseg_copy) {
+        num_bounce_bufs = gasnett_getenv_int_withdefault("UPCXX_NUM_BOUNCE_BUFS", 4, 1);
+        if (num_bounce_bufs < 1) num_bounce_bufs = 1;
+        if (num_bounce_bufs > UPCXX_MAX_BOUNCE_BUFS)
+          num_bounce_bufs = UPCXX_MAX_BOUNCE_BUFS;
+        bounce_buf_size = gasnett_getenv_int_withdefault("UPCXX_BOUNCE_BUF_SIZE",
+                                                         64*1024, 1);
+        // this also initializes my_gasnet_seginfo
+        for (int i = 0; i < num_bounce_bufs; i++) {
+          bounce_bufs[i] = (char *)gasnet_seg_alloc(bounce_buf_size);
+          assert(bounce_bufs[i] != NULL);
+        }
+      }
+    }
+    if (!env_stage_nonseg_copy) return false;
+
+    uintptr_t seg_start = (uintptr_t)my_gasnet_seginfo->addr;
+    uintptr_t seg_end = seg_start + my_gasnet_seginfo->size;
+    return ((uintptr_t)p < seg_start || (uintptr_t)p + nbytes > seg_end);
+  }
+
+  // Claim the free bounce buffers, at least one, for a staged copy and
+  // return their number.  bounce_lock is only held while claiming, so
+  // copies by other threads can use the remaining buffers meanwhile.
+  static int claim_bounce_bufs(char **bufs)
+  {
+    int n = 0;
+    while (1) {
+      upcxx_mutex_lock(&bounce_lock);
+      for (int b = 0; b < num_bounce_bufs; b++) {
+        if (!bounce_busy[b]) {
+          bounce_busy[b] = true;
+          bufs[n++] = bounce_bufs[b];
+        }
+      }
+      upcxx_mutex_unlock(&bounce_lock);
+      if (n > 0) return n;
+      advance(); // all in use by other threads
+    }
+  }
+
+  static void release_bounce_bufs(char **bufs, int n)
+  {
+    upcxx_mutex_lock(&bounce_lock);
+    for (int b = 0; b < num_bounce_bufs; b++) {
+      for (int i = 0; i < n; i++) {
+        if (bounce_bufs[b] == bufs[i]) bounce_busy[b] = false;
+      }
+    }
+    upcxx_mutex_unlock(&bounce_lock);
+  }
+
+  static void staged_put(rank_t r, char *dst, const char *src, size_t nbytes)
+  {
+    char *bufs[UPCXX_MAX_BOUNCE_BUFS];
+    int nbufs = claim_bounce_bufs(bufs);
+    gasnet_handle_t h[UPCXX_MAX_BOUNCE_BUFS];
+    for (int b = 0; b < nbufs; b++) h[b] = GASNET_HANDLE_INVALID;
+
+    int b = 0;
+    for (size_t offset = 0; offset < nbytes; offset += bounce_buf_size) {
+      size_t n = nbytes - offset < bounce_buf_size ? nbytes - offset : bounce_buf_size;
+      if (h[b] != GASNET_HANDLE_INVALID)
+        UPCXX_CALL_GASNET(gasnet_wait_syncnb(h[b]));
+      memcpy(bufs[b], src + offset, n);
+      UPCXX_CALL_GASNET(h[b] = gasnet_put_nb_bulk(r, dst + offset, bufs[b], n));
+      b = (b + 1) % nbufs;
+    }
+    for (b = 0; b < nbufs; b++) {
+      if (h[b] != GASNET_HANDLE_INVALID)
+        UPCXX_CALL_GASNET(gasnet_wait_syncnb(h[b]));
+    }
+    release_bounce_bufs(bufs, nbufs);
+  }
+
+  static void staged_get(char *dst, rank_t r, const char *src, size_t nbytes)
+  {
+    char *bufs[UPCXX_MAX_BOUNCE_BUFS];
+    int nbufs = claim_bounce_bufs(bufs);
+    gasnet_handle_t h[UPCXX_MAX_BOUNCE_BUFS];
+    size_t nchunks = (nbytes + bounce_buf_size - 1) / bounce_buf_size;
+
+    // keep up to nbufs gets in flight
+    for (size_t c = 0; c < nchunks + nbufs; c++) {
+      int b = c % nbufs;
+      if (c >= (size_t)nbufs) {
+        size_t done = c - nbufs;
+        if (done >= nchunks) continue;
+        size_t offset = done * bounce_buf_size;
+        size_t n = nbytes - offset < bounce_buf_size ? nbytes - offset : bounce_buf_size;
+        UPCXX_CALL_GASNET(gasnet_wait_syncnb(h[b]));
+        memcpy(dst + offset, bufs[b], n);
+      }
+      if (c < nchunks) {
+        size_t offset = c * bounce_buf_size;
+        size_t n = nbytes - offset < bounce_buf_size ? nbytes - offset : bounce_buf_size;
+        UPCXX_CALL_GASNET(h[b] = gasnet_get_nb_bulk(bufs[b], r,
+                                                    (void *)(src + offset), n));
+      }
+    }
+    release_bounce_bufs(bufs, nbufs);
+  }
+
+  // Check whether the local buffer of a copy needs staging and count
+  // the staged copies
+  static bool check_staging(const void *p, size_t nbytes)
+  {
+    upcxx_mutex_lock(&bounce_lock);
+    bool staging = need_staging(p, nbytes);
+    if (staging) num_staged_copies++;
+    upcxx_mutex_unlock(&bounce_lock);
+    return staging;
+  }
+
+  static void finish_staged_copy(void *buf, void *dst, size_t nbytes, event *e)
+  {
+    if (dst != NULL) memcpy(dst, buf, nbytes);
+    gasnet_seg_free(buf);
+    e->decref();
+  }
+
+  // Non-blocking copy through a temporary segment buffer.  Return
+  // false if the local buffer doesn't need staging or no segment
+  // memory is available for it.  For a put, the local buffer is copied
+  // into the segment before returning.
+  static bool staged_async_copy(global_ptr<void> src, global_ptr<void> dst,
+                                size_t nbytes, event *e)
+  {
+    void *local_buf = (dst.where() == global_myrank()) ? dst.raw_ptr() : src.raw_ptr();
+    upcxx_mutex_lock(&bounce_lock);
+    bool staging = need_staging(local_buf, nbytes);
+    upcxx_mutex_unlock(&bounce_lock);
+    if (!staging) return false;
+
+    void *buf = gasnet_seg_alloc(nbytes);
+    if (buf == NULL) return false;
+
+    upcxx_mutex_lock(&bounce_lock);
+    num_staged_copies++;
+    upcxx_mutex_unlock(&bounce_lock);
+
+    event **temp_events = allocate_events(1);
+    void *copy_back = NULL;
+    if (src.where() == global_myrank()) {
+      memcpy(buf, src.raw_ptr(), nbytes);
+      async_copy(global_ptr<void>(buf), dst, nbytes, temp_events[0]);
+    } else {
+      copy_back = dst.raw_ptr();
+      async_copy(src, global_ptr<void>(buf), nbytes, temp_events[0]);
+    }
+    e->incref();
+    async_after(global_myrank(), temp_events[0], NULL)(finish_staged_copy, buf, copy_back, nbytes, e);
+    async_after(global_myrank(), temp_events[0], NULL)(deallocate_events, 1, temp_events);
+    return true;
+  }
+
   int copy(global_ptr<void> src, global_ptr<void> dst, size_t nbytes)
   {
 #ifdef DEBUG
@@ -12,16 +206,33 @@ namespace upcxx
             src.where(), src.raw_ptr(), nbytes, dst.where(), dst.raw_ptr());
 #endif
     if (dst.where() == global_myrank()) {
-      UPCXX_CALL_GASNET(gasnet_get_bulk(dst.raw_ptr(), src.where(), src.raw_ptr(), nbytes));
+      if (read_cache_active()) {
+        cache_get(dst.raw_ptr(), src.where(), src.raw_ptr(), nbytes);
+      } else {
+        if (check_staging(dst.raw_ptr(), nbytes)) {
+          staged_get((char *)dst.raw_ptr(), src.where(), (char *)src.raw_ptr(), nbytes);
+        } else {
+          UPCXX_CALL_GASNET(gasnet_get_bulk(dst.raw_ptr(), src.where(), src.raw_ptr(), nbytes));
+        }
+      }
     } else if (src.where() == global_myrank()) {
-      UPCXX_CALL_GASNET(gasnet_put_bulk(dst.where(), dst.raw_ptr(), src.raw_ptr(), nbytes));
+      if (check_staging(src.raw_ptr(), nbytes)) {
+        staged_put(dst.where(), (char *)dst.raw_ptr(), (char *)src.raw_ptr(), nbytes);
+      } else {
+        UPCXX_CALL_GASNET(gasnet_put_bulk(dst.where(), dst.raw_ptr(), src.raw_ptr(), nbytes));
+      }
+      if (read_cache_active()) {
+        cache_update(dst.where(), dst.raw_ptr(), src.raw_ptr(), nbytes);
+      }
     } else {
-      void *buf;
-      buf = malloc(nbytes);
+      // stage the third-party copy through the segment when possible
+      void *buf = gasnet_seg_alloc(nbytes);
+      bool in_seg = (buf != NULL);
+      if (!in_seg) buf = malloc(nbytes);
       assert(buf != NULL);
       UPCXX_CALL_GASNET(gasnet_get_bulk(buf, src.where(), src.raw_ptr(), nbytes));
       UPCXX_CALL_GASNET(gasnet_put_bulk(dst.where(), dst.raw_ptr(), buf, nbytes));
-      ::free(buf);
+      if (in_seg) gasnet_seg_free(buf); else ::free(buf);
     }
 
     return UPCXX_SUCCESS;
@@ -34,6 +245,9 @@ namespace upcxx
       fprintf(stderr, "async_copy error: either the src pointer or the dst ptr needs to be local.\n");
       gasnet_exit(1);
     }
+
+    if (staged_async_copy(src, dst, nbytes, e)) return UPCXX_SUCCESS;
+
     if (e == system_event) {
       // use implicit non-blocking copy for the global scope,
       // need to call gasnet_wait_syncnbi_all() to synchronize later
@@ -59,6 +273,56 @@ namespace upcxx
     return UPCXX_SUCCESS;
   }
 
+  int async_copy(global_ptr<void> src, global_ptr<void> dst, size_t nbytes,
+                 event *local_completion, event *remote_completion)
+  {
+    if (dst.where() != global_myrank() && src.where() != global_myrank()) {
+      fprintf(stderr, "async_copy error: either the src pointer or the dst ptr needs to be local.\n");
+      gasnet_exit(1);
+    }
+
+    if (remote_completion == NULL) remote_completion = system_event;
+
+    if (dst.where() == global_myrank()) {
+      // For a get the local buffer is the destination, so the local
+      // and remote completions happen at the same time.
+      if (local_completion == NULL || local_completion == remote_completion) {
+        return async_copy(src, dst, nbytes, remote_completion);
+      }
+      event **temp_events = allocate_events(1);
+      async_copy(src, dst, nbytes, temp_events[0]);
+      local_completion->incref();
+      async_after(global_myrank(), temp_events[0], NULL)(event_decref, local_completion, 1);
+      if (remote_completion != system_event) {
+        remote_completion->incref();
+        async_after(global_myrank(), temp_events[0], NULL)(event_decref, remote_completion, 1);
+      }
+      async_after(global_myrank(), temp_events[0], NULL)(deallocate_events, 1, temp_events);
+      return UPCXX_SUCCESS;
+    }
+
+    // src.where() == global_myrank()
+    if (local_completion == NULL) {
+      // nobody waits for local completion, so keep using the bulk put
+      return async_copy(src, dst, nbytes, remote_completion);
+    }
+
+    // The non-bulk put returns only after the src buffer is safe to
+    // be overwritten, which is the local completion of the transfer.
+    // So does a staged put, which copies src into the segment first.
+    // Thus local_completion needs no further signaling.
+    if (staged_async_copy(src, dst, nbytes, remote_completion))
+      return UPCXX_SUCCESS;
+    if (remote_completion == system_event) {
+      UPCXX_CALL_GASNET(gasnet_put_nbi(dst.where(), dst.raw_ptr(), src.raw_ptr(), nbytes));
+    } else {
+      gasnet_handle_t h;
+      UPCXX_CALL_GASNET(h = gasnet_put_nb(dst.where(), dst.raw_ptr(), src.raw_ptr(), nbytes));
+      remote_completion->add_gasnet_handle(h);
+    }
+    return UPCXX_SUCCESS;
+  }
+
   GASNETT_INLINE(copy_and_set_reply_inner)
   void copy_and_signal_reply_inner(gasnet_token_t token, void *local_completion, void *remote_completion)
   {
@@ -0,0 +1,236 @@
+/**
+ * atomic.cpp - implement remote atomic operations
+ */
+
+#include <vector>
+
+#include "upcxx.h"
+#include "upcxx/upcxx_internal.h"
+
+// #define UPCXX_DEBUG
+
+namespace upcxx
+{
+  // Queued remote atomics per target rank, batches of atomic_am_t
+  static am_batcher_t atomic_batcher;
+
+  // Called with am_batcher_lock() held
+  static void init_atomic_batches()
+  {
+    size_t max_fit = gasnet_AMMaxMedium() / sizeof(atomic_am_t);
+    size_t batch_max = gasnett_getenv_int_withdefault("UPCXX_ATOMIC_BATCH_SIZE",
+                                                      64, 1);
+    if (batch_max > max_fit) batch_max = max_fit;
+    if (batch_max < 1) batch_max = 1;
+    am_batcher_init(&atomic_batcher, ATOMIC_AM, 0, gasnet_AMMaxMedium(),
+                    batch_max);
+  }
+
+  void atomic_flush(rank_t r)
+  {
+    am_batcher_flush(&atomic_batcher, r);
+  }
+
+  void atomic_flush()
+  {
+    am_batcher_flush(&atomic_batcher);
+  }
+
+  static size_t atomic_type_size(int type)
+  {
+    switch (type) {
+    case UPCXX_ATOMIC_INT32:
+    case UPCXX_ATOMIC_UINT32:
+    case UPCXX_ATOMIC_FLOAT:
+      return 4;
+    case UPCXX_ATOMIC_INT64:
+    case UPCXX_ATOMIC_UINT64:
+    case UPCXX_ATOMIC_DOUBLE:
+      return 8;
+    default:
+      fprintf(stderr, "Unknown remote atomic type %d!\n", type);
+      gasnet_exit(1);
+    }
+    return 0;
+  }
+
+  template<typename T>
+  static inline void atomic_apply_raw(void *addr, atomic_op_t op,
+                                      const void *operand1, const void *operand2,
+                                      void *result)
+  {
+    T op1, op2;
+    memcpy(&op1, operand1, sizeof(T));
+    memcpy(&op2, operand2, sizeof(T));
+    T old = atomic_apply((T *)addr, op, op1, op2);
+    memcpy(result, &old, sizeof(T));
+  }
+
+  // Apply op to the local object at addr, which has the type denoted by type
+  static void atomic_apply_local(void *addr, int type, atomic_op_t op,
+                                 const void *operand1, const void *operand2,
+                                 void *result)
+  {
+    switch (type) {
+    case UPCXX_ATOMIC_INT32:
+      atomic_apply_raw<int32_t>(addr, op, operand1, operand2, result); break;
+    case UPCXX_ATOMIC_UINT32:
+      atomic_apply_raw<uint32_t>(addr, op, operand1, operand2, result); break;
+    case UPCXX_ATOMIC_INT64:
+      atomic_apply_raw<int64_t>(addr, op, operand1, operand2, result); break;
+    case UPCXX_ATOMIC_UINT64:
+      atomic_apply_raw<uint64_t>(addr, op, operand1, operand2, result); break;
+    case UPCXX_ATOMIC_FLOAT:
+      atomic_apply_raw<float>(addr, op, operand1, operand2, result); break;
+    case UPCXX_ATOMIC_DOUBLE:
+      atomic_apply_raw<double>(addr, op, operand1, operand2, result); break;
+    default:
+      fprintf(stderr, "Unknown remote atomic type %d!\n", type);
+      gasnet_exit(1);
+    }
+  }
+
+  void atomic_op_nb(rank_t r, void *addr, atomic_type_t type, atomic_op_t op,
+                    const void *operand1, const void *operand2,
+                    void *result, event *cb_event)
+  {
+    size_t sz = atomic_type_size(type);
+    char old_val[8];
+
+    if (r == global_myrank() || is_memory_shared_with(r)) {
+      // the target is in the same shared-memory node, use CPU atomics
+      void *local_addr = (r == global_myrank()) ? addr : pshm_remote_addr2local(r, addr);
+      atomic_apply_local(local_addr, type, op, operand1, operand2, old_val);
+      if (result != NULL) memcpy(result, old_val, sz);
+      return;
+    }
+
+    if (cb_event != NULL) cb_event->incref();
+
+    am_batcher_lock();
+    if (atomic_batcher.batches == NULL) init_atomic_batches();
+    atomic_am_t *am = (atomic_am_t *)am_batch_append(&atomic_batcher, r,
+                                                     sizeof(atomic_am_t));
+    am->addr = addr;
+    am->result_addr = result;
+    am->cb_event = cb_event;
+    am->type = type;
+    am->op = op;
+    memcpy(am->operand1, operand1, sz);
+    memcpy(am->operand2, operand2, sz);
+    am_batch_commit(&atomic_batcher, r);
+    am_batcher_unlock();
+  }
+
+  void atomic_am_handler(gasnet_token_t token, void *buf, size_t nbytes)
+  {
+    atomic_am_t *am = (atomic_am_t *)buf;
+    size_t n = nbytes / sizeof(atomic_am_t);
+    assert(nbytes == n * sizeof(atomic_am_t));
+
+    std::vector<atomic_reply_t> replies(n);
+    for (size_t i = 0; i < n; i++) {
+      atomic_apply_local(am[i].addr, am[i].type, (atomic_op_t)am[i].op,
+                         am[i].operand1, am[i].operand2, replies[i].result);
+      replies[i].result_addr = am[i].result_addr;
+      replies[i].cb_event = am[i].cb_event; // callback event on the src rank
+      replies[i].type = am[i].type;
+    }
+    GASNET_CHECK_RV(gasnet_AMReplyMedium0(token, ATOMIC_REPLY, &replies[0],
+                                          n * sizeof(atomic_reply_t)));
+  }
+
+  void atomic_reply_handler(gasnet_token_t token, void *buf, size_t nbytes)
+  {
+    atomic_reply_t *reply = (atomic_reply_t *)buf;
+    size_t n = nbytes / sizeof(atomic_reply_t);
+    assert(nbytes == n * sizeof(atomic_reply_t));
+
+    for (size_t i = 0; i < n; i++) {
+      if (reply[i].result_addr != NULL)
+        memcpy(reply[i].result_addr, reply[i].result,
+               atomic_type_size(reply[i].type));
+      if (reply[i].cb_event != NULL)
+        reply[i].cb_event->decref();
+    }
+  }
+
+  // Queued remote updates per target rank, batches of update_entry_t
+  static am_batcher_t update_batcher;
+  // counts the batches sent but not yet applied
+  static event *update_event = NULL;
+
+  static bool prepare_update_batch(rank_t r, char *buf, size_t nbytes)
+  {
+    update_event->incref();
+    return true;
+  }
+
+  // Called with am_batcher_lock() held
+  static void init_update_batches()
+  {
+    update_event = new event;
+    size_t max_fit = gasnet_AMMaxMedium() / sizeof(update_entry_t);
+    size_t batch_max = gasnett_getenv_int_withdefault("UPCXX_UPDATE_BATCH_SIZE",
+                                                      max_fit, 1);
+    if (batch_max > max_fit) batch_max = max_fit;
+    if (batch_max < 1) batch_max = 1;
+    am_batcher_init(&update_batcher, UPDATE_AM, 0, gasnet_AMMaxMedium(),
+                    batch_max, prepare_update_batch);
+  }
+
+  void send_updates()
+  {
+    am_batcher_flush(&update_batcher);
+  }
+
+  void update_flush()
+  {
+    send_updates();
+    if (update_event != NULL) update_event->wait();
+  }
+
+  void update_nb(rank_t r, void *addr, atomic_type_t type, atomic_op_t op,
+                 const void *value)
+  {
+    size_t sz = atomic_type_size(type);
+    char old_val[8];
+
+    if (r == global_myrank() || is_memory_shared_with(r)) {
+      void *local_addr = (r == global_myrank()) ? addr : pshm_remote_addr2local(r, addr);
+      atomic_apply_local(local_addr, type, op, value, value, old_val);
+      return;
+    }
+
+    am_batcher_lock();
+    if (update_batcher.batches == NULL) init_update_batches();
+    update_entry_t *entry =
+      (update_entry_t *)am_batch_append(&update_batcher, r, sizeof(update_entry_t));
+    entry->addr = addr;
+    memcpy(entry->value, value, sz);
+    entry->type = type;
+    entry->op = op;
+    am_batch_commit(&update_batcher, r);
+    am_batcher_unlock();
+  }
+
+  void update_am_handler(gasnet_token_t token, void *buf, size_t nbytes)
+  {
+    update_entry_t *entries = (update_entry_t *)buf;
+    size_t n = nbytes / sizeof(update_entry_t);
+    assert(nbytes == n * sizeof(update_entry_t));
+
+    char old_val[8];
+    for (size_t i = 0; i < n; i++) {
+      atomic_apply_local(entries[i].addr, entries[i].type,
+                         (atomic_op_t)entries[i].op,
+                         entries[i].value, entries[i].value, old_val);
+    }
+    GASNET_CHECK_RV(gasnet_AMReplyShort0(token, UPDATE_REPLY));
+  }
+
+  void update_reply_handler(gasnet_token_t token)
+  {
+    update_event->decref();
+  }
+} // namespace upcxx
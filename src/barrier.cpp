@@ -17,6 +17,8 @@ namespace upcxx {
       }
     } while (rv != GASNET_OK);
 
+    if (read_cache_active()) cache_invalidate();
+
     return UPCXX_SUCCESS;
   }
 } // namespace upcxx
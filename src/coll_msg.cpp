@@ -0,0 +1,223 @@
+/**
+ * coll_msg.cpp - point-to-point messages of the collectives implemented
+ * by UPC++ itself (e.g., allgather)
+ *
+ * A message of a collective is tagged with the key of its team, the
+ * sequence number of the collective on the team and the step of the
+ * algorithm, and its data is written at an offset of the buffer that
+ * the receiver posts for the collective.  Messages that arrive before
+ * the receiver posts its buffer are kept until it does.
+ */
+
+#include <list>
+#include <map>
+#include <vector>
+
+#include "upcxx.h"
+#include "upcxx/upcxx_internal.h"
+
+// #define UPCXX_DEBUG
+
+namespace upcxx
+{
+  struct coll_recv_t {
+    uint64_t key;
+    uint32_t seq;
+    char *buf;
+    std::vector<size_t> base;     // offset of the data of each step, if any
+    std::vector<size_t> received; // bytes received per step
+  };
+
+  struct coll_pending_t {
+    coll_msg_t header;
+    std::vector<char> data;
+  };
+
+  static std::list<coll_recv_t *> *coll_posted = NULL;
+  static std::list<coll_pending_t> *coll_pending = NULL;
+  static std::map<gasnet_team_handle_t, uint64_t> *coll_team_keys = NULL;
+  static std::map<uint64_t, uint32_t> *coll_seqs = NULL;
+  static std::map<uint64_t, uint32_t> *coll_splits = NULL; // per parent key
+
+#if defined(UPCXX_THREAD_SAFE) || defined(GASNET_PAR)
+  static upcxx_mutex_t coll_msg_lock = UPCXX_MUTEX_INITIALIZER;
+#endif
+
+  static void init_coll_msg()
+  {
+    coll_posted = new std::list<coll_recv_t *>;
+    coll_pending = new std::list<coll_pending_t>;
+    coll_team_keys = new std::map<gasnet_team_handle_t, uint64_t>;
+    coll_seqs = new std::map<uint64_t, uint32_t>;
+    coll_splits = new std::map<uint64_t, uint32_t>;
+    (*coll_team_keys)[GASNET_TEAM_ALL] = 14695981039346656037ULL;
+  }
+
+  static inline uint64_t coll_hash(uint64_t key, uint64_t v)
+  {
+    for (int i = 0; i < 8; i++) {
+      key ^= (v >> (i * 8)) & 0xFF;
+      key *= 1099511628211ULL;
+    }
+    return key;
+  }
+
+  // Teams with the same members (e.g., two splits of the same parent)
+  // must not share a key, so the key of a team is derived from the key
+  // of its parent, the number of splits of the parent before it and its
+  // color, which all members agree on as splits are collective.
+  void coll_team_split(gasnet_team_handle_t parent, gasnet_team_handle_t child,
+                       uint32_t color)
+  {
+    uint64_t parent_key = coll_team_key(parent);
+    upcxx_mutex_lock(&coll_msg_lock);
+    uint32_t nsplits = (*coll_splits)[parent_key]++;
+    (*coll_team_keys)[child] =
+      coll_hash(coll_hash(parent_key, nsplits), color);
+    upcxx_mutex_unlock(&coll_msg_lock);
+  }
+
+  uint64_t coll_team_key(gasnet_team_handle_t team)
+  {
+    upcxx_mutex_lock(&coll_msg_lock);
+    if (coll_team_keys == NULL) init_coll_msg();
+    std::map<gasnet_team_handle_t, uint64_t>::iterator it = coll_team_keys->find(team);
+    if (it == coll_team_keys->end()) {
+      fprintf(stderr, "Rank %u: collective on a team that was not created by "
+              "team::split()\n", global_myrank());
+      gasnet_exit(1);
+    }
+    uint64_t key = it->second;
+    upcxx_mutex_unlock(&coll_msg_lock);
+    return key;
+  }
+
+  uint32_t coll_next_seq(uint64_t key)
+  {
+    upcxx_mutex_lock(&coll_msg_lock);
+    if (coll_seqs == NULL) init_coll_msg();
+    uint32_t seq = (*coll_seqs)[key]++;
+    upcxx_mutex_unlock(&coll_msg_lock);
+    return seq;
+  }
+
+  // Called with coll_msg_lock held
+  static void coll_deliver(coll_recv_t *c, const coll_msg_t *m,
+                           const void *data, size_t nbytes)
+  {
+    assert(m->step < c->received.size());
+    size_t base = c->base.empty() ? 0 : c->base[m->step];
+    memcpy(c->buf + base + m->offset, data, nbytes);
+    c->received[m->step] += nbytes;
+  }
+
+  coll_recv_t *coll_post(uint64_t key, uint32_t seq, void *buf,
+                         uint32_t nsteps, const size_t *step_offsets)
+  {
+    coll_recv_t *c = new coll_recv_t;
+    c->key = key;
+    c->seq = seq;
+    c->buf = (char *)buf;
+    if (step_offsets != NULL) {
+      c->base.assign(step_offsets, step_offsets + nsteps);
+    }
+    c->received.resize(nsteps, 0);
+
+    upcxx_mutex_lock(&coll_msg_lock);
+    if (coll_posted == NULL) init_coll_msg();
+    coll_posted->push_back(c);
+    // deliver the messages that arrived early
+    std::list<coll_pending_t>::iterator it = coll_pending->begin();
+    while (it != coll_pending->end()) {
+      if (it->header.key == key && it->header.seq == seq) {
+        coll_deliver(c, &it->header, it->data.empty() ? NULL : &it->data[0],
+                     it->data.size());
+        it = coll_pending->erase(it);
+      } else {
+        ++it;
+      }
+    }
+    upcxx_mutex_unlock(&coll_msg_lock);
+    return c;
+  }
+
+  void coll_unpost(coll_recv_t *c)
+  {
+    upcxx_mutex_lock(&coll_msg_lock);
+    coll_posted->remove(c);
+    upcxx_mutex_unlock(&coll_msg_lock);
+    delete c;
+  }
+
+  size_t coll_received(coll_recv_t *c, uint32_t step)
+  {
+    upcxx_mutex_lock(&coll_msg_lock);
+    size_t nbytes = c->received[step];
+    upcxx_mutex_unlock(&coll_msg_lock);
+    return nbytes;
+  }
+
+  void coll_wait(coll_recv_t *c, uint32_t step, size_t nbytes)
+  {
+    while (coll_received(c, step) < nbytes) {
+      advance(); // keep polling the network and the task queue
+    }
+  }
+
+  static void coll_handle_msg(const coll_msg_t *m, const void *data,
+                              size_t nbytes)
+  {
+    upcxx_mutex_lock(&coll_msg_lock);
+    if (coll_posted == NULL) init_coll_msg();
+    for (std::list<coll_recv_t *>::iterator it = coll_posted->begin();
+         it != coll_posted->end(); ++it) {
+      if ((*it)->key == m->key && (*it)->seq == m->seq) {
+        coll_deliver(*it, m, data, nbytes);
+        upcxx_mutex_unlock(&coll_msg_lock);
+        return;
+      }
+    }
+    // the receiver has not started the collective yet
+    coll_pending->push_back(coll_pending_t());
+    coll_pending->back().header = *m;
+    coll_pending->back().data.assign((const char *)data,
+                                     (const char *)data + nbytes);
+    upcxx_mutex_unlock(&coll_msg_lock);
+  }
+
+  void coll_send(rank_t r, uint64_t key, uint32_t seq, uint32_t step,
+                 size_t offset, const void *src, size_t nbytes)
+  {
+    coll_msg_t m;
+    m.key = key;
+    m.seq = seq;
+    m.step = step;
+
+    if (r == global_myrank()) {
+      m.offset = offset;
+      coll_handle_msg(&m, src, nbytes);
+      return;
+    }
+
+    size_t max_payload = gasnet_AMMaxMedium() - sizeof(coll_msg_t);
+    char *buf = (char *)malloc(gasnet_AMMaxMedium());
+    assert(buf != NULL);
+    for (size_t done = 0; done < nbytes; done += max_payload) {
+      size_t len = (nbytes - done < max_payload) ? nbytes - done : max_payload;
+      m.offset = offset + done;
+      memcpy(buf, &m, sizeof(coll_msg_t));
+      memcpy(buf + sizeof(coll_msg_t), (const char *)src + done, len);
+      UPCXX_CALL_GASNET(
+          GASNET_CHECK_RV(gasnet_AMRequestMedium0(r, COLL_MSG_AM, buf,
+                                                  sizeof(coll_msg_t) + len)));
+    }
+    free(buf);
+  }
+
+  void coll_msg_am_handler(gasnet_token_t token, void *buf, size_t nbytes)
+  {
+    coll_msg_t *m = (coll_msg_t *)buf;
+    assert(nbytes >= sizeof(coll_msg_t));
+    coll_handle_msg(m, m + 1, nbytes - sizeof(coll_msg_t));
+  }
+} // namespace upcxx
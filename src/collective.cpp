@@ -150,9 +150,32 @@ namespace upcxx {
     }
   } // end of _complex_reduce_fn
 
+  static gasnet_coll_fn_entry_t fntable[UPCXX_DATATYPE_COUNT];
+
+  static const size_t datatype_sizes[UPCXX_DATATYPE_COUNT] = {
+    sizeof(char), sizeof(unsigned char), sizeof(short),
+    sizeof(unsigned short), sizeof(int), sizeof(unsigned int), sizeof(long),
+    sizeof(unsigned long), sizeof(long long), sizeof(unsigned long long),
+    sizeof(float), sizeof(double), sizeof(std::complex<float>),
+    sizeof(std::complex<double>)
+  };
+
+  size_t coll_datatype_size(upcxx_datatype_t dt)
+  {
+    assert(dt < UPCXX_DATATYPE_COUNT);
+    return datatype_sizes[dt];
+  }
+
+  void coll_reduce_local(void *inout, const void *in, size_t count,
+                         upcxx_datatype_t dt, upcxx_op_t op)
+  {
+    assert(dt < UPCXX_DATATYPE_COUNT);
+    (*fntable[dt].fnptr)(inout, count, inout, count, in, datatype_sizes[dt],
+                         0, op);
+  }
+
   void init_collectives()
   {
-    gasnet_coll_fn_entry_t fntable[UPCXX_DATATYPE_COUNT];
 
     fntable[UPCXX_CHAR].fnptr = _int_reduce_fn<char>;
     fntable[UPCXX_CHAR].flags = 0;
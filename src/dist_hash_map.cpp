@@ -0,0 +1,91 @@
+/**
+ * dist_hash_map.cpp - send batches of dist_hash_map operations
+ */
+
+#include "upcxx.h"
+#include "upcxx/upcxx_internal.h"
+
+// #define UPCXX_DEBUG
+
+namespace upcxx
+{
+  // Queued operations per target rank, a dhm_am_t followed by the
+  // operations of one map
+  static am_batcher_t dhm_batcher;
+
+  // Called with am_batcher_lock() held
+  static void init_dhm_batches()
+  {
+    size_t batch_max = gasnett_getenv_int_withdefault("UPCXX_DHM_BATCH_SIZE",
+                                                      256, 1);
+    if (batch_max < 1) batch_max = 1;
+    am_batcher_init(&dhm_batcher, DHM_AM, sizeof(dhm_am_t),
+                    gasnet_AMMaxMedium(), batch_max);
+  }
+
+  void dhm_send_batches()
+  {
+    am_batcher_flush(&dhm_batcher);
+  }
+
+  void dhm_enqueue(rank_t r, void *target, dhm_exec_fn_t exec,
+                   dhm_done_fn_t done, const void *op, size_t op_nbytes,
+                   size_t reply_nbytes)
+  {
+    size_t max_medium = gasnet_AMMaxMedium();
+    if (sizeof(dhm_am_t) + op_nbytes > max_medium ||
+        sizeof(dhm_reply_t) + reply_nbytes > max_medium) {
+      fprintf(stderr, "dist_hash_map error: an operation of %lu bytes "
+              "does not fit in an active message of %lu bytes.\n",
+              (unsigned long)op_nbytes, (unsigned long)max_medium);
+      gasnet_exit(1);
+    }
+
+    am_batcher_lock();
+    if (dhm_batcher.batches == NULL) init_dhm_batches();
+    dhm_am_t *am = (dhm_am_t *)am_batch_header(&dhm_batcher, r);
+    // a batch holds the operations of one map and its replies must fit
+    // in one reply message
+    if (am != NULL &&
+        (am->target != target || am->exec != exec ||
+         sizeof(dhm_reply_t) + am->reply_nbytes + reply_nbytes > max_medium)) {
+      am_batch_send(&dhm_batcher, r);
+    }
+    memcpy(am_batch_append(&dhm_batcher, r, op_nbytes), op, op_nbytes);
+    am = (dhm_am_t *)am_batch_header(&dhm_batcher, r);
+    if (am->exec == NULL) {
+      // a new batch
+      am->exec = exec;
+      am->done = done;
+      am->target = target;
+    }
+    am->reply_nbytes += reply_nbytes;
+    am_batch_commit(&dhm_batcher, r);
+    am_batcher_unlock();
+  }
+
+  void dhm_am_handler(gasnet_token_t token, void *buf, size_t nbytes)
+  {
+    dhm_am_t *am = (dhm_am_t *)buf;
+    assert(nbytes >= sizeof(dhm_am_t));
+
+    size_t reply_size = sizeof(dhm_reply_t) + am->reply_nbytes;
+    char *reply = (char *)malloc(reply_size);
+    assert(reply != NULL);
+    dhm_reply_t *header = (dhm_reply_t *)reply;
+    header->done = am->done;
+    header->nbytes = (*am->exec)(am->target, am + 1,
+                                 nbytes - sizeof(dhm_am_t), header + 1);
+    assert(header->nbytes <= am->reply_nbytes);
+    GASNET_CHECK_RV(gasnet_AMReplyMedium0(token, DHM_REPLY, reply,
+                                          sizeof(dhm_reply_t) + header->nbytes));
+    free(reply);
+  }
+
+  void dhm_reply_handler(gasnet_token_t token, void *buf, size_t nbytes)
+  {
+    dhm_reply_t *header = (dhm_reply_t *)buf;
+    assert(nbytes == sizeof(dhm_reply_t) + header->nbytes);
+    (*header->done)(header + 1, header->nbytes);
+  }
+} // namespace upcxx
@@ -7,6 +7,7 @@
 #include <vector>
 
 #include "upcxx.h"
+#include "upcxx/upcxx_internal.h"
 
 //#define UPCXX_DEBUG
 
@@ -226,6 +227,8 @@ namespace upcxx
 
   void async_wait()
   {
+    flush(); // complete the buffered put_nb writes
+    flush_remote_frees();
     while (!outstanding_events->empty()) {
       upcxx::advance(10,10);
     }
@@ -3,12 +3,71 @@
  */
 
 #include <assert.h>
+#include <list>
+#include <map>
+#include <vector>
 
 #include "upcxx.h"
 #include "upcxx/upcxx_internal.h"
 
 namespace upcxx
 {
+  /*
+   * The queue node of the calling rank for a lock, identified by the
+   * owner rank and the lock address on the owner.  The queue nodes are
+   * kept in a rank-local table rather than in the lock object because
+   * the lock object may not exist at the same address on every rank.
+   */
+  struct lock_qnode_t {
+    rank_t next;          // the successor in the queue
+    event *acquire_event; // signaled when the lock is handed to us
+    bool handoff;         // unlocked, hand off to the successor when it links
+    lock_qnode_t() : next(UPCXX_LOCK_NONE), acquire_event(NULL), handoff(false) { }
+  };
+
+  typedef std::pair<rank_t, shared_lock *> lock_key_t;
+
+  struct lock_link_t {
+    lock_key_t key;
+    rank_t pred;
+  };
+
+  static std::map<lock_key_t, lock_qnode_t> *lock_qnodes = NULL;
+  static std::vector<lock_link_t> *lock_links = NULL;
+  static std::vector<lock_link_t> *lock_grants = NULL; // pred is the successor
+  static volatile int lock_num_pending = 0; // links and grants to send
+
+#if defined(UPCXX_THREAD_SAFE) || defined(GASNET_PAR)
+  static upcxx_mutex_t lock_qnodes_lock = UPCXX_MUTEX_INITIALIZER;
+#endif
+
+  // Return the queue node for key, called with lock_qnodes_lock held
+  static lock_qnode_t &get_qnode(const lock_key_t &key)
+  {
+    if (lock_qnodes == NULL) {
+      lock_qnodes = new std::map<lock_key_t, lock_qnode_t>;
+      lock_links = new std::vector<lock_link_t>;
+      lock_grants = new std::vector<lock_link_t>;
+    }
+    return (*lock_qnodes)[key];
+  }
+
+  /*
+   * Return the local address of the lock object at addr on the owner
+   * rank if this rank can access it directly, or NULL otherwise.  A
+   * lock on another rank of the same node is accessible only if it is
+   * in the owner's shared segment (e.g., in a shared_array).
+   */
+  static void *lock_local_addr(rank_t owner, void *addr)
+  {
+    if (owner == global_myrank()) return addr;
+    if (all_gasnet_seginfo == NULL || !is_memory_shared_with(owner)) return NULL;
+    uintptr_t seg_start = (uintptr_t)all_gasnet_seginfo[owner].addr;
+    uintptr_t seg_end = seg_start + all_gasnet_seginfo[owner].size;
+    if ((uintptr_t)addr < seg_start || (uintptr_t)addr >= seg_end) return NULL;
+    return pshm_remote_addr2local(owner, addr);
+  }
+
   void shared_lock::lock_am_handler(gasnet_token_t token,
                                     void *buf,
                                     size_t nbytes)
@@ -20,30 +79,45 @@ namespace upcxx
     gasnet_node_t srcnode;
     GASNET_CHECK_RV(gasnet_AMGetMsgSource(token, &srcnode));
 
+    lock_reply_t reply;
+    reply.pred = UPCXX_LOCK_NONE;
+
     if (!am->queryonly) {
-      upcxx_mutex_lock(&lock->_mutex);
 #ifdef UPCXX_DEBUG
-      printf("lock_am_handler() rank %u, lock %p, _locked %d, _holder %u, _owner %u\n",
-             global_myrank(), lock, lock->_locked, lock->_holder, lock->_owner);
+      printf("lock_am_handler() rank %u, lock %p, _tail %u, _owner %u\n",
+             global_myrank(), lock, lock->_tail, lock->_owner);
 #endif
 
-      if (lock->_locked == 0) {
-        lock->_holder = srcnode;
-        lock->_locked = 1;
-      } else if (lock->_holder == srcnode) {
+      // The tail may also be updated by ranks on this node concurrently
+      if (lock->_tail == srcnode) {
         // \Todo Need to check the lock sequence carefully to avoid deadlocks!
 
         fprintf(stderr, "node %d is trying to lock a lock that it is holding!\n",
         srcnode);
         gasnet_exit(1);
       }
-      upcxx_mutex_unlock(&lock->_mutex);
+      if (am->tryonly) {
+        if (__sync_bool_compare_and_swap(&lock->_tail, UPCXX_LOCK_NONE, srcnode))
+          lock->_holder = srcnode;
+      } else {
+        // enqueue the caller and let it link itself to its predecessor
+        reply.pred = __atomic_exchange_n(&lock->_tail, srcnode, __ATOMIC_SEQ_CST);
+        if (reply.pred == UPCXX_LOCK_NONE)
+          lock->_holder = srcnode;
+      }
     }
-    lock_reply_t reply;
     reply.rv.holder = lock->_holder;
-    reply.rv.islocked = lock->_locked;
+    reply.rv.islocked = (lock->_tail != UPCXX_LOCK_NONE);
+    if (am->tryonly && lock->_tail != srcnode) {
+      // _holder may be stale if the lock has been handed off
+      reply.rv.holder = lock->_tail;
+    }
+
+    reply.lock = lock;
     reply.rv_addr = am->rv_addr;
     reply.cb_event = am->cb_event;
+    reply.queryonly = am->queryonly;
+    reply.tryonly = am->tryonly;
 
     GASNET_CHECK_RV(gasnet_AMReplyMedium0(token, LOCK_REPLY, &reply, sizeof(reply)));
   }
@@ -56,51 +130,231 @@ namespace upcxx
     lock_reply_t *reply = (lock_reply_t *)buf;
     assert(nbytes == sizeof(lock_reply_t));
 
-    reply->rv_addr->holder = reply->rv.holder;
-    reply->rv_addr->islocked = reply->rv.islocked;
+    if (reply->rv_addr != NULL) {
+      reply->rv_addr->holder = reply->rv.holder;
+      reply->rv_addr->islocked = reply->rv.islocked;
+    }
+
+    gasnet_node_t owner;
+    GASNET_CHECK_RV(gasnet_AMGetMsgSource(token, &owner));
+    lock_key_t key(owner, reply->lock);
+
+    if (reply->queryonly || reply->tryonly) {
+      // the caller isn't in the queue, so leave its queue node alone
+      reply->cb_event->decref();
+      return;
+    }
+
+    upcxx_mutex_lock(&lock_qnodes_lock);
+    if (reply->pred != UPCXX_LOCK_NONE) {
+      // Queued behind pred: the lock will be handed to us by pred after
+      // it learns about us.  AM handlers can't send requests, so the
+      // link message is sent later by progress().
+      lock_link_t link;
+      link.key = key;
+      link.pred = reply->pred;
+      lock_links->push_back(link);
+      lock_num_pending++;
+      upcxx_mutex_unlock(&lock_qnodes_lock);
+      return;
+    }
+    get_qnode(key).acquire_event = NULL;
+    upcxx_mutex_unlock(&lock_qnodes_lock);
+
     reply->cb_event->decref();
   }
 
+  void shared_lock::lock_link_am_handler(gasnet_token_t token,
+                                         void *buf,
+                                         size_t nbytes)
+  {
+    lock_link_am_t *am = (lock_link_am_t *)buf;
+    assert(nbytes == sizeof(lock_link_am_t));
+
+    gasnet_node_t srcnode;
+    GASNET_CHECK_RV(gasnet_AMGetMsgSource(token, &srcnode));
+
+    upcxx_mutex_lock(&lock_qnodes_lock);
+    lock_qnode_t &qnode = get_qnode(lock_key_t(am->owner, am->lock));
+    assert(qnode.next == UPCXX_LOCK_NONE);
+    if (qnode.handoff) {
+      // We have already released the lock: hand it to the successor,
+      // which is sent by progress() as handlers can't send requests
+      lock_link_t grant;
+      grant.key = lock_key_t(am->owner, am->lock);
+      grant.pred = srcnode;
+      lock_grants->push_back(grant);
+      lock_num_pending++;
+      qnode.handoff = false;
+    } else {
+      qnode.next = srcnode;
+    }
+    upcxx_mutex_unlock(&lock_qnodes_lock);
+  }
+
+  void shared_lock::lock_grant_am_handler(gasnet_token_t token,
+                                          void *buf,
+                                          size_t nbytes)
+  {
+    lock_link_am_t *am = (lock_link_am_t *)buf;
+    assert(nbytes == sizeof(lock_link_am_t));
+
+    upcxx_mutex_lock(&lock_qnodes_lock);
+    lock_qnode_t &qnode = get_qnode(lock_key_t(am->owner, am->lock));
+    event *e = qnode.acquire_event;
+    qnode.acquire_event = NULL;
+    upcxx_mutex_unlock(&lock_qnodes_lock);
+
+    assert(e != NULL);
+    e->decref();
+  }
+
   void shared_lock::unlock_am_handler(gasnet_token_t token,
                                       void *buf,
                                       size_t nbytes)
   {
     unlock_am_t *am = (unlock_am_t *)buf;
     assert(nbytes == sizeof(unlock_am_t));
-    assert(am->lock->_locked);
+    assert(am->lock->_tail != UPCXX_LOCK_NONE);
 
     gasnet_node_t srcnode;
     GASNET_CHECK_RV(gasnet_AMGetMsgSource(token, &srcnode));
 
-    upcxx_mutex_lock(&am->lock->_mutex);
-    if (am->lock->_holder != srcnode) {
-      fprintf(stderr, "unlock_am_handler error: srcnode %u attempts to unlock a lock held by %u!\n",
-              srcnode, am->lock->_holder);
-      upcxx_mutex_unlock(&am->lock->_mutex);
-      gasnet_exit(1);
+    unlock_reply_t reply;
+    // If the caller is still the tail, there are no waiters and the
+    // lock becomes free.  Otherwise a waiter is linking itself to the
+    // caller, which hands off the lock.
+    reply.released = __sync_bool_compare_and_swap(&am->lock->_tail, srcnode,
+                                                  UPCXX_LOCK_NONE);
+
+    reply.released_addr = am->released_addr;
+    reply.cb_event = am->cb_event;
+    GASNET_CHECK_RV(gasnet_AMReplyMedium0(token, UNLOCK_REPLY, &reply, sizeof(reply)));
+  }
+
+  void shared_lock::unlock_reply_handler(gasnet_token_t token,
+                                         void *buf,
+                                         size_t nbytes)
+  {
+    unlock_reply_t *reply = (unlock_reply_t *)buf;
+    assert(nbytes == sizeof(unlock_reply_t));
+
+    *reply->released_addr = reply->released;
+    reply->cb_event->decref();
+  }
+
+  void shared_lock::progress()
+  {
+    if (lock_num_pending == 0) return;
+
+    upcxx_mutex_lock(&lock_qnodes_lock);
+    std::vector<lock_link_t> links, grants;
+    links.swap(*lock_links);
+    grants.swap(*lock_grants);
+    lock_num_pending = 0;
+    upcxx_mutex_unlock(&lock_qnodes_lock);
+
+    for (size_t i = 0; i < links.size(); i++) {
+      lock_link_am_t am;
+      am.owner = links[i].key.first;
+      am.lock = links[i].key.second;
+      UPCXX_CALL_GASNET(
+          GASNET_CHECK_RV(gasnet_AMRequestMedium0(links[i].pred, LOCK_LINK_AM,
+                                                  &am, sizeof(am))));
+    }
+    for (size_t i = 0; i < grants.size(); i++) {
+      lock_link_am_t am;
+      am.owner = grants[i].key.first;
+      am.lock = grants[i].key.second;
+      UPCXX_CALL_GASNET(
+          GASNET_CHECK_RV(gasnet_AMRequestMedium0(grants[i].pred, LOCK_GRANT_AM,
+                                                  &am, sizeof(am))));
     }
-    am->lock->_holder = global_myrank();
-    am->lock->_locked = 0;
-    upcxx_mutex_unlock(&am->lock->_mutex);
   }
 
-  int shared_lock::trylock()
+  void shared_lock::request(event *e, int tryonly, lock_rv_t *rv)
   {
-    event e;
-    lock_rv_t rv;
+    rank_t me = global_myrank();
+    lock_key_t key(get_owner(), myself);
+
+    upcxx_mutex_lock(&lock_qnodes_lock);
+    // make sure the queue node exists before any handler needs it
+    lock_qnode_t *qnode = &get_qnode(key);
+    if (!tryonly) {
+      // finish handing off our previous hold before queueing again
+      while (qnode->handoff) {
+        upcxx_mutex_unlock(&lock_qnodes_lock);
+        advance();
+        upcxx_mutex_lock(&lock_qnodes_lock);
+        qnode = &get_qnode(key);
+      }
+      if (qnode->acquire_event != NULL) {
+        fprintf(stderr, "Rank %u is requesting a lock %p that it has already requested!\n",
+                me, myself);
+        gasnet_exit(1);
+      }
+      qnode->acquire_event = e;
+    }
+    upcxx_mutex_unlock(&lock_qnodes_lock);
+
+    shared_lock *local = (shared_lock *)lock_local_addr(get_owner(), myself);
+    if (local != NULL) {
+      // The lock object is directly accessible: update the tail with
+      // atomics instead of sending LOCK_AM to the owner
+      if (tryonly) {
+        if (__sync_bool_compare_and_swap(&local->_tail, UPCXX_LOCK_NONE, me))
+          local->_holder = me;
+        rv->holder = local->_tail;
+        rv->islocked = (rv->holder != UPCXX_LOCK_NONE);
+        return;
+      }
+
+      e->incref();
+      rank_t pred = __atomic_exchange_n(&local->_tail, me, __ATOMIC_SEQ_CST);
+      if (pred == me) {
+        fprintf(stderr, "node %d is trying to lock a lock that it is holding!\n", me);
+        gasnet_exit(1);
+      }
+      if (pred == UPCXX_LOCK_NONE) {
+        local->_holder = me;
+        upcxx_mutex_lock(&lock_qnodes_lock);
+        get_qnode(key).acquire_event = NULL;
+        upcxx_mutex_unlock(&lock_qnodes_lock);
+        e->decref();
+        return;
+      }
+
+      // Link ourself to the predecessor, which hands off the lock
+      lock_link_am_t am;
+      am.lock = myself;
+      am.owner = get_owner();
+      UPCXX_CALL_GASNET(
+          GASNET_CHECK_RV(gasnet_AMRequestMedium0(pred, LOCK_LINK_AM, &am, sizeof(am))));
+      return;
+    }
+
     lock_am_t am;
     am.lock = myself;
     am.queryonly = 0;
-    am.rv_addr = &rv;
-    e.incref();
-    am.cb_event = &e;
+    am.tryonly = tryonly;
+    am.rv_addr = rv;
+    e->incref();
+    am.cb_event = e;
 
 #ifdef UPCXX_DEBUG
-    printf("trylock() rank %u, lock %p, _locked %d, _holder %u, _owner %u\n",
-            global_myrank(), this, _locked, _holder, _owner);
+    printf("request() rank %u, lock %p, tryonly %d, _owner %u\n",
+            me, this, tryonly, _owner);
 #endif
 
-    GASNET_CHECK_RV(gasnet_AMRequestMedium0(get_owner(), LOCK_AM, &am, sizeof(am)));
+    UPCXX_CALL_GASNET(
+        GASNET_CHECK_RV(gasnet_AMRequestMedium0(get_owner(), LOCK_AM, &am, sizeof(am))));
+  }
+
+  int shared_lock::trylock()
+  {
+    event e;
+    lock_rv_t rv;
+    request(&e, 1, &rv);
     e.wait();
 
     if (rv.holder == global_myrank() && rv.islocked) {
@@ -112,31 +366,84 @@ namespace upcxx
 
   void shared_lock::lock()
   {
-    GASNET_BLOCKUNTIL(trylock() == 1);
+    event e;
+    request(&e, 0, NULL);
+    e.wait();
+  }
+
+  void shared_lock::async_lock(event *e)
+  {
+    request(e, 0, NULL);
   }
 
   void shared_lock::unlock()
   {
-    unlock_am_t am;
-    am.lock = myself;
-    GASNET_CHECK_RV(gasnet_AMRequestMedium0(get_owner(), UNLOCK_AM, &am, sizeof(am)));
+    lock_key_t key(get_owner(), myself);
+    rank_t next;
+
+    upcxx_mutex_lock(&lock_qnodes_lock);
+    next = get_qnode(key).next;
+    upcxx_mutex_unlock(&lock_qnodes_lock);
+
+    if (next == UPCXX_LOCK_NONE) {
+      // No known successor: try to free the lock at the owner
+      int released;
+      shared_lock *local = (shared_lock *)lock_local_addr(get_owner(), myself);
+      if (local != NULL) {
+        released = __sync_bool_compare_and_swap(&local->_tail, global_myrank(),
+                                                UPCXX_LOCK_NONE);
+      } else {
+        event e;
+        unlock_am_t am;
+        am.lock = myself;
+        am.released_addr = &released;
+        e.incref();
+        am.cb_event = &e;
+        UPCXX_CALL_GASNET(
+            GASNET_CHECK_RV(gasnet_AMRequestMedium0(get_owner(), UNLOCK_AM, &am, sizeof(am))));
+        e.wait();
+      }
+      if (released) return;
 
-    // If Active Messages may be delivered out-of-order, we need
-    // to wait for a reply from the lock master node (0) before
-    // proceeding.  Otherwise, a later lock AM may fail if it is
-    // delivered to the master node ahead of a preceding unlock AM
-    // from the same source node.  We would need to add a reply
-    // event in the unlock AM struct.
+      // A successor has enqueued itself.  Hand off the lock when its
+      // link arrives, unless it has arrived in the meantime.
+      upcxx_mutex_lock(&lock_qnodes_lock);
+      lock_qnode_t &qnode = get_qnode(key);
+      next = qnode.next;
+      if (next == UPCXX_LOCK_NONE) {
+        qnode.handoff = true;
+        upcxx_mutex_unlock(&lock_qnodes_lock);
+        return;
+      }
+      qnode.next = UPCXX_LOCK_NONE;
+      upcxx_mutex_unlock(&lock_qnodes_lock);
+    } else {
+      upcxx_mutex_lock(&lock_qnodes_lock);
+      get_qnode(key).next = UPCXX_LOCK_NONE;
+      upcxx_mutex_unlock(&lock_qnodes_lock);
+    }
 
+    // Hand the lock directly to the successor
+    lock_link_am_t am;
+    am.lock = myself;
+    am.owner = get_owner();
+    UPCXX_CALL_GASNET(
+        GASNET_CHECK_RV(gasnet_AMRequestMedium0(next, LOCK_GRANT_AM, &am, sizeof(am))));
   }
 
   int shared_lock::islocked()
   {
+    shared_lock *local = (shared_lock *)lock_local_addr(get_owner(), myself);
+    if (local != NULL) {
+      return local->_tail != UPCXX_LOCK_NONE;
+    }
+
     event e;
     lock_rv_t rv;
     lock_am_t am;
     am.lock = this;
     am.queryonly = 1;
+    am.tryonly = 0;
     am.rv_addr = &rv;
     e.incref();
     am.cb_event = &e;
@@ -146,4 +453,261 @@ namespace upcxx
 
     return rv.islocked;
   }
+
+  /*
+   * shared_rwlock
+   *
+   * Lock word layout: bit 63 is set while a writer holds the lock, bits
+   * 32-62 count the waiting writers and bits 0-31 count the readers.
+   */
+#define RWLOCK_WRITER      ((uint64_t)1 << 63)
+#define RWLOCK_WAITING_ONE ((uint64_t)1 << 32)
+#define RWLOCK_WAITING     (RWLOCK_WRITER - RWLOCK_WAITING_ONE)
+#define RWLOCK_READERS     (RWLOCK_WAITING_ONE - 1)
+
+  struct rwlock_waiter_t {
+    rank_t rank;
+    int writer;
+    int *granted_addr;
+    event *cb_event;
+  };
+
+  // Queued remote waiters of the rwlocks owned by this rank
+  static std::map<shared_rwlock *, std::list<rwlock_waiter_t> > *rwlock_waiters = NULL;
+  static volatile int rwlock_num_waiters = 0;
+
+#if defined(UPCXX_THREAD_SAFE) || defined(GASNET_PAR)
+  static upcxx_mutex_t rwlock_waiters_lock = UPCXX_MUTEX_INITIALIZER;
+#endif
+
+  static inline bool rwlock_try_read(volatile uint64_t *state)
+  {
+    uint64_t old = *state;
+    while (!(old & (RWLOCK_WRITER | RWLOCK_WAITING))) {
+      if (__sync_bool_compare_and_swap(state, old, old + 1)) return true;
+      old = *state;
+    }
+    return false;
+  }
+
+  // Try to acquire for writing; announced is true if the caller has
+  // already been counted as a waiting writer
+  static inline bool rwlock_try_write(volatile uint64_t *state, bool announced)
+  {
+    uint64_t old = *state;
+    while (!(old & (RWLOCK_WRITER | RWLOCK_READERS))) {
+      uint64_t desired = (announced ? old - RWLOCK_WAITING_ONE : old) | RWLOCK_WRITER;
+      if (__sync_bool_compare_and_swap(state, old, desired)) return true;
+      old = *state;
+    }
+    return false;
+  }
+
+  // Return the local address of the lock word if this rank can access
+  // it directly, or NULL otherwise
+  volatile uint64_t *shared_rwlock::local_state()
+  {
+    if (_owner == global_myrank()) return &myself->_state;
+    void *addr = lock_local_addr(_owner, myself);
+    if (addr == NULL) return NULL;
+    return &((shared_rwlock *)addr)->_state;
+  }
+
+  void shared_rwlock::rwlock_am_handler(gasnet_token_t token,
+                                        void *buf,
+                                        size_t nbytes)
+  {
+    rwlock_am_t *am = (rwlock_am_t *)buf;
+    assert(nbytes == sizeof(rwlock_am_t));
+    volatile uint64_t *state = &am->lock->_state;
+
+    rwlock_reply_t reply;
+    reply.granted = 1;
+    reply.granted_addr = am->granted_addr;
+    reply.cb_event = am->cb_event;
+
+    switch (am->op) {
+    case RWLOCK_READ_UNLOCK:
+      assert((*state & RWLOCK_READERS) > 0);
+      __sync_fetch_and_sub(state, 1);
+      break;
+    case RWLOCK_WRITE_UNLOCK:
+      assert(*state & RWLOCK_WRITER);
+      __sync_fetch_and_and(state, ~RWLOCK_WRITER);
+      break;
+    case RWLOCK_TRY_READ:
+      reply.granted = rwlock_try_read(state);
+      break;
+    case RWLOCK_TRY_WRITE:
+      reply.granted = rwlock_try_write(state, false);
+      break;
+    default:
+      upcxx_mutex_lock(&rwlock_waiters_lock);
+      if (rwlock_waiters == NULL)
+        rwlock_waiters = new std::map<shared_rwlock *, std::list<rwlock_waiter_t> >;
+      std::list<rwlock_waiter_t> &waiters = (*rwlock_waiters)[am->lock];
+      bool writer = (am->op == RWLOCK_WRITE);
+      // Waiters are granted in order, so don't overtake queued ones
+      if (waiters.empty()) {
+        reply.granted = writer ? rwlock_try_write(state, false) : rwlock_try_read(state);
+      } else {
+        reply.granted = 0;
+      }
+      if (!reply.granted) {
+        rwlock_waiter_t w;
+        GASNET_CHECK_RV(gasnet_AMGetMsgSource(token, &w.rank));
+        w.writer = writer;
+        w.granted_addr = am->granted_addr;
+        w.cb_event = am->cb_event;
+        if (writer) __sync_fetch_and_add(state, RWLOCK_WAITING_ONE);
+        waiters.push_back(w);
+        rwlock_num_waiters++;
+      }
+      upcxx_mutex_unlock(&rwlock_waiters_lock);
+      if (!reply.granted) return; // granted later by progress()
+    }
+
+    GASNET_CHECK_RV(gasnet_AMReplyMedium0(token, RWLOCK_REPLY, &reply, sizeof(reply)));
+  }
+
+  void shared_rwlock::rwlock_reply_handler(gasnet_token_t token,
+                                           void *buf,
+                                           size_t nbytes)
+  {
+    rwlock_reply_t *reply = (rwlock_reply_t *)buf;
+    assert(nbytes == sizeof(rwlock_reply_t));
+
+    *reply->granted_addr = reply->granted;
+    reply->cb_event->decref();
+  }
+
+  void shared_rwlock::rwlock_grant_am_handler(gasnet_token_t token,
+                                              void *buf,
+                                              size_t nbytes)
+  {
+    rwlock_reply_handler(token, buf, nbytes);
+  }
+
+  void shared_rwlock::progress()
+  {
+    if (rwlock_num_waiters == 0) return;
+
+    std::vector<rwlock_waiter_t> granted;
+    upcxx_mutex_lock(&rwlock_waiters_lock);
+    for (std::map<shared_rwlock *, std::list<rwlock_waiter_t> >::iterator it =
+           rwlock_waiters->begin(); it != rwlock_waiters->end(); ++it) {
+      volatile uint64_t *state = &it->first->_state;
+      std::list<rwlock_waiter_t> &waiters = it->second;
+      while (!waiters.empty()) {
+        rwlock_waiter_t &w = waiters.front();
+        bool ok;
+        if (w.writer) {
+          ok = rwlock_try_write(state, true);
+        } else {
+          // queued readers only wait for the writers ahead of them
+          uint64_t old = *state;
+          ok = false;
+          while (!(old & RWLOCK_WRITER)) {
+            if (__sync_bool_compare_and_swap(state, old, old + 1)) { ok = true; break; }
+            old = *state;
+          }
+        }
+        if (!ok) break;
+        granted.push_back(w);
+        waiters.pop_front();
+        rwlock_num_waiters--;
+      }
+    }
+    upcxx_mutex_unlock(&rwlock_waiters_lock);
+
+    for (size_t i = 0; i < granted.size(); i++) {
+      rwlock_reply_t am;
+      am.granted = 1;
+      am.granted_addr = granted[i].granted_addr;
+      am.cb_event = granted[i].cb_event;
+      UPCXX_CALL_GASNET(
+          GASNET_CHECK_RV(gasnet_AMRequestMedium0(granted[i].rank, RWLOCK_GRANT_AM,
+                                                  &am, sizeof(am))));
+    }
+  }
+
+  int shared_rwlock::remote_op(int op)
+  {
+    event e;
+    int granted;
+    rwlock_am_t am;
+    am.lock = myself;
+    am.op = op;
+    am.granted_addr = &granted;
+    e.incref();
+    am.cb_event = &e;
+
+    UPCXX_CALL_GASNET(
+        GASNET_CHECK_RV(gasnet_AMRequestMedium0(get_owner(), RWLOCK_AM, &am, sizeof(am))));
+    e.wait();
+    return granted;
+  }
+
+  void shared_rwlock::read_lock()
+  {
+    volatile uint64_t *state = local_state();
+    if (state == NULL) {
+      remote_op(RWLOCK_READ);
+      return;
+    }
+    while (!rwlock_try_read(state)) {
+      advance();
+    }
+  }
+
+  void shared_rwlock::write_lock()
+  {
+    volatile uint64_t *state = local_state();
+    if (state == NULL) {
+      remote_op(RWLOCK_WRITE);
+      return;
+    }
+    if (rwlock_try_write(state, false)) return;
+    // announce the waiting writer to hold off new readers
+    __sync_fetch_and_add(state, RWLOCK_WAITING_ONE);
+    while (!rwlock_try_write(state, true)) {
+      advance();
+    }
+  }
+
+  int shared_rwlock::try_read_lock()
+  {
+    volatile uint64_t *state = local_state();
+    if (state == NULL) return remote_op(RWLOCK_TRY_READ);
+    return rwlock_try_read(state);
+  }
+
+  int shared_rwlock::try_write_lock()
+  {
+    volatile uint64_t *state = local_state();
+    if (state == NULL) return remote_op(RWLOCK_TRY_WRITE);
+    return rwlock_try_write(state, false);
+  }
+
+  void shared_rwlock::read_unlock()
+  {
+    volatile uint64_t *state = local_state();
+    if (state == NULL) {
+      remote_op(RWLOCK_READ_UNLOCK);
+      return;
+    }
+    assert((*state & RWLOCK_READERS) > 0);
+    __sync_fetch_and_sub(state, 1);
+  }
+
+  void shared_rwlock::write_unlock()
+  {
+    volatile uint64_t *state = local_state();
+    if (state == NULL) {
+      remote_op(RWLOCK_WRITE_UNLOCK);
+      return;
+    }
+    assert(*state & RWLOCK_WRITER);
+    __sync_fetch_and_and(state, ~RWLOCK_WRITER);
+  }
 } // namespace upcxx
@@ -0,0 +1,224 @@
+/**
+ * prefetch.cpp - implement non-blocking prefetch of remote data
+ */
+
+#include <map>
+#include <vector>
+
+#include "upcxx.h"
+#include "upcxx/upcxx_internal.h"
+
+// #define UPCXX_DEBUG
+
+namespace upcxx
+{
+  bool _prefetch_active = false;
+
+  struct prefetch_entry_t {
+    size_t nbytes;
+    char *buf;
+    event done;
+    int refs;          // lookups in progress, which keep the entry alive
+    bool released;     // removed from the map by prefetch_release_all()
+    bool stale;        // skipped by lookups after prefetch_discard()
+  };
+
+  // prefetched ranges sorted by (rank, remote start address); they may
+  // overlap
+  typedef std::map<std::pair<rank_t, uintptr_t>, prefetch_entry_t *> prefetch_map_t;
+  static prefetch_map_t *prefetches = NULL;
+  // the largest range in the map, which bounds the search for the
+  // ranges overlapping an address
+  static size_t prefetch_max_nbytes = 0;
+  // entries replaced by a larger prefetch of the same start address,
+  // kept until prefetch_release_all() for prefetch_view() pointers
+  static std::vector<prefetch_entry_t *> *prefetch_replaced = NULL;
+
+#if defined(UPCXX_THREAD_SAFE) || defined(GASNET_PAR)
+  static upcxx_mutex_t prefetch_lock = UPCXX_MUTEX_INITIALIZER;
+#endif
+
+  static void free_entry(prefetch_entry_t *entry)
+  {
+    entry->done.wait();
+    free(entry->buf);
+    delete entry;
+  }
+
+  static void prefetch_unpin(prefetch_entry_t *entry)
+  {
+    upcxx_mutex_lock(&prefetch_lock);
+    bool last = (--entry->refs == 0 && entry->released);
+    upcxx_mutex_unlock(&prefetch_lock);
+    if (last) free_entry(entry);
+  }
+
+  void prefetch(global_ptr<void> ptr, size_t nbytes)
+  {
+    if (ptr.where() == global_myrank() || nbytes == 0) return;
+
+    prefetch_entry_t *entry = new prefetch_entry_t;
+    entry->nbytes = nbytes;
+    entry->buf = (char *)malloc(nbytes);
+    assert(entry->buf != NULL);
+    entry->refs = 0;
+    entry->released = false;
+    entry->stale = false;
+
+    std::pair<rank_t, uintptr_t> key(ptr.where(), (uintptr_t)ptr.raw_ptr());
+    upcxx_mutex_lock(&prefetch_lock);
+    if (prefetches == NULL) prefetches = new prefetch_map_t;
+    prefetch_map_t::iterator it = prefetches->find(key);
+    if (it != prefetches->end()) {
+      if (it->second->nbytes >= nbytes) {
+        // already prefetched
+        upcxx_mutex_unlock(&prefetch_lock);
+        free(entry->buf);
+        delete entry;
+        return;
+      }
+      // replace the shorter range with this one
+      if (prefetch_replaced == NULL)
+        prefetch_replaced = new std::vector<prefetch_entry_t *>;
+      it->second->stale = true;
+      prefetch_replaced->push_back(it->second);
+    }
+    (*prefetches)[key] = entry;
+    if (nbytes > prefetch_max_nbytes) prefetch_max_nbytes = nbytes;
+    _prefetch_active = true;
+    // keep the entry alive until the get is issued
+    entry->refs++;
+    upcxx_mutex_unlock(&prefetch_lock);
+
+    async_copy(ptr, global_ptr<void>(entry->buf), nbytes, &entry->done);
+    prefetch_unpin(entry);
+
+#ifdef UPCXX_DEBUG
+    fprintf(stderr, "Rank %u prefetches %lu bytes at %p from rank %u\n",
+            global_myrank(), nbytes, ptr.raw_ptr(), ptr.where());
+#endif
+  }
+
+  // Pin and return the entries on rank r overlapping [addr, addr+nbytes),
+  // or only one entry covering the whole range if covering is true.
+  // The caller must unpin them with prefetch_unpin().
+  static void prefetch_find(rank_t r, uintptr_t addr, size_t nbytes,
+                            bool covering,
+                            std::vector<prefetch_entry_t *> *found,
+                            std::vector<uintptr_t> *starts)
+  {
+    upcxx_mutex_lock(&prefetch_lock);
+    if (prefetches == NULL || prefetches->empty()) {
+      upcxx_mutex_unlock(&prefetch_lock);
+      return;
+    }
+    // walk back from the last entry starting before addr+nbytes over
+    // all the entries that may reach addr
+    prefetch_map_t::iterator it =
+      prefetches->lower_bound(std::pair<rank_t, uintptr_t>(r, addr + nbytes));
+    while (it != prefetches->begin()) {
+      --it;
+      uintptr_t start = it->first.second;
+      if (it->first.first != r || start + prefetch_max_nbytes <= addr) break;
+      uintptr_t end = start + it->second->nbytes;
+      bool match = !it->second->stale &&
+        (covering ? (start <= addr && addr + nbytes <= end) : (end > addr));
+      if (match) {
+        it->second->refs++;
+        found->push_back(it->second);
+        starts->push_back(start);
+        if (covering) break;
+      }
+    }
+    upcxx_mutex_unlock(&prefetch_lock);
+  }
+
+  bool prefetch_get(void *dst, rank_t r, const void *addr, size_t nbytes)
+  {
+    std::vector<prefetch_entry_t *> found;
+    std::vector<uintptr_t> starts;
+    prefetch_find(r, (uintptr_t)addr, nbytes, true, &found, &starts);
+    if (found.empty()) return false;
+    found[0]->done.wait();
+    memcpy(dst, found[0]->buf + ((uintptr_t)addr - starts[0]), nbytes);
+    prefetch_unpin(found[0]);
+    return true;
+  }
+
+  void prefetch_update(rank_t r, void *addr, const void *src, size_t nbytes)
+  {
+    std::vector<prefetch_entry_t *> found;
+    std::vector<uintptr_t> starts;
+    uintptr_t begin = (uintptr_t)addr;
+    uintptr_t end = begin + nbytes;
+    prefetch_find(r, begin, nbytes, false, &found, &starts);
+    // patch the overlapping part of every prefetched range
+    for (size_t i = 0; i < found.size(); i++) {
+      uintptr_t lo = starts[i] > begin ? starts[i] : begin;
+      uintptr_t hi = starts[i] + found[i]->nbytes < end ?
+        starts[i] + found[i]->nbytes : end;
+      found[i]->done.wait(); // don't let the in-flight get overwrite the update
+      memcpy(found[i]->buf + (lo - starts[i]), (const char *)src + (lo - begin),
+             hi - lo);
+      prefetch_unpin(found[i]);
+    }
+  }
+
+  void prefetch_discard(rank_t r, void *addr, size_t nbytes)
+  {
+    std::vector<prefetch_entry_t *> found;
+    std::vector<uintptr_t> starts;
+    prefetch_find(r, (uintptr_t)addr, nbytes, false, &found, &starts);
+    // keep the buffers until they are released, as prefetch_view()
+    // pointers to them may still be in use
+    upcxx_mutex_lock(&prefetch_lock);
+    for (size_t i = 0; i < found.size(); i++) found[i]->stale = true;
+    upcxx_mutex_unlock(&prefetch_lock);
+    for (size_t i = 0; i < found.size(); i++) prefetch_unpin(found[i]);
+  }
+
+  void *prefetch_view(global_ptr<void> ptr, size_t nbytes)
+  {
+    if (ptr.where() == global_myrank()) return ptr.raw_ptr();
+
+    std::vector<prefetch_entry_t *> found;
+    std::vector<uintptr_t> starts;
+    prefetch_find(ptr.where(), (uintptr_t)ptr.raw_ptr(), nbytes, true,
+                  &found, &starts);
+    if (found.empty()) return NULL;
+    found[0]->done.wait();
+    char *rv = found[0]->buf + ((uintptr_t)ptr.raw_ptr() - starts[0]);
+    prefetch_unpin(found[0]);
+    return rv;
+  }
+
+  void prefetch_release_all()
+  {
+    std::vector<prefetch_entry_t *> unused;
+    upcxx_mutex_lock(&prefetch_lock);
+    prefetch_map_t *old = prefetches;
+    prefetches = NULL;
+    std::vector<prefetch_entry_t *> *replaced = prefetch_replaced;
+    prefetch_replaced = NULL;
+    prefetch_max_nbytes = 0;
+    _prefetch_active = false;
+    if (old != NULL) {
+      // entries still pinned by a lookup are freed by its prefetch_unpin()
+      for (prefetch_map_t::iterator it = old->begin(); it != old->end(); ++it) {
+        it->second->released = true;
+        if (it->second->refs == 0) unused.push_back(it->second);
+      }
+    }
+    if (replaced != NULL) {
+      for (size_t i = 0; i < replaced->size(); i++) {
+        (*replaced)[i]->released = true;
+        if ((*replaced)[i]->refs == 0) unused.push_back((*replaced)[i]);
+      }
+    }
+    upcxx_mutex_unlock(&prefetch_lock);
+
+    for (size_t i = 0; i < unused.size(); i++) free_entry(unused[i]);
+    delete old;
+    delete replaced;
+  }
+} // namespace upcxx
@@ -0,0 +1,287 @@
+/**
+ * read_cache.cpp - implement the software cache for remote reads
+ */
+
+#include "upcxx.h"
+#include "upcxx/upcxx_internal.h"
+
+// #define UPCXX_DEBUG
+
+#define UPCXX_READ_CACHE_DEFAULT_SIZE (1024*1024)
+#define UPCXX_READ_CACHE_DEFAULT_LINE_SIZE 256
+
+namespace upcxx
+{
+  event **allocate_events(uint32_t num_events);
+  void deallocate_events(uint32_t num_events, event **events);
+
+  bool _cache_enabled = false;
+
+  struct cache_line_t {
+    uint64_t epoch;   // the line is valid only if epoch == cache_epoch
+    rank_t rank;
+    uintptr_t base;   // remote address of the first valid byte
+    size_t nbytes;    // number of valid bytes (less than a line at segment ends)
+  };
+
+  static cache_line_t *cache_lines = NULL;
+  static char *cache_data = NULL;
+  static size_t cache_num_lines = 0;
+  static size_t cache_line_size = 0;
+  static uint64_t cache_epoch = 1;
+  static uint64_t num_cache_hits = 0;
+  static uint64_t num_cache_misses = 0;
+  static uint64_t cache_writes = 0; // the number of cache_update() calls
+
+#if defined(UPCXX_THREAD_SAFE) || defined(GASNET_PAR)
+  static upcxx_mutex_t cache_lock = UPCXX_MUTEX_INITIALIZER;
+#endif
+
+  void cache_enable(size_t capacity, size_t line_size)
+  {
+    if (capacity == 0)
+      capacity = gasnett_getenv_int_withdefault("UPCXX_READ_CACHE_SIZE",
+                                                UPCXX_READ_CACHE_DEFAULT_SIZE, 1);
+    if (line_size == 0)
+      line_size = gasnett_getenv_int_withdefault("UPCXX_READ_CACHE_LINE_SIZE",
+                                                 UPCXX_READ_CACHE_DEFAULT_LINE_SIZE, 1);
+    if ((line_size & (line_size - 1)) != 0 || line_size > capacity) {
+      fprintf(stderr, "cache_enable error: invalid line size %lu for a cache of %lu bytes\n",
+              line_size, capacity);
+      gasnet_exit(1);
+    }
+
+    cache_disable();
+
+    upcxx_mutex_lock(&cache_lock);
+    cache_line_size = line_size;
+    cache_num_lines = capacity / line_size;
+    cache_lines = (cache_line_t *)calloc(cache_num_lines, sizeof(cache_line_t));
+    cache_data = (char *)malloc(cache_num_lines * cache_line_size);
+    assert(cache_lines != NULL);
+    assert(cache_data != NULL);
+    cache_epoch++;
+    _cache_enabled = true;
+    upcxx_mutex_unlock(&cache_lock);
+  }
+
+  void cache_disable()
+  {
+    upcxx_mutex_lock(&cache_lock);
+    _cache_enabled = false;
+    if (cache_lines != NULL) free(cache_lines);
+    if (cache_data != NULL) free(cache_data);
+    cache_lines = NULL;
+    cache_data = NULL;
+    cache_num_lines = 0;
+    upcxx_mutex_unlock(&cache_lock);
+  }
+
+  void cache_invalidate()
+  {
+    prefetch_release_all();
+
+    // bumping the epoch invalidates all lines at once
+    upcxx_mutex_lock(&cache_lock);
+    cache_epoch++;
+    upcxx_mutex_unlock(&cache_lock);
+  }
+
+  uint64_t cache_hits() { return num_cache_hits; }
+
+  uint64_t cache_misses() { return num_cache_misses; }
+
+  static inline size_t cache_index(rank_t r, uintptr_t line_addr)
+  {
+    return ((line_addr / cache_line_size) ^ ((uintptr_t)r * 0x9E3779B1u))
+      % cache_num_lines;
+  }
+
+  // Return the valid cache line holding [addr, addr+nbytes) on rank r,
+  // or NULL.  Called with cache_lock held.
+  static cache_line_t *cache_hit(rank_t r, uintptr_t addr, size_t nbytes)
+  {
+    uintptr_t line_addr = addr & ~((uintptr_t)cache_line_size - 1);
+    cache_line_t *line = &cache_lines[cache_index(r, line_addr)];
+    if (line->epoch == cache_epoch && line->rank == r &&
+        line->base <= addr && addr + nbytes <= line->base + line->nbytes) {
+      return line;
+    }
+    return NULL;
+  }
+
+  // Compute the range [*start, *end) of the line of addr clipped to the
+  // remote segment, so that we never read outside of it.  Return false
+  // if [addr, addr+nbytes) can't be cached.
+  static bool cache_line_range(rank_t r, uintptr_t addr, size_t nbytes,
+                               uintptr_t *start, uintptr_t *end)
+  {
+    if (all_gasnet_seginfo == NULL) return false;
+    uintptr_t line_addr = addr & ~((uintptr_t)cache_line_size - 1);
+    uintptr_t seg_start = (uintptr_t)all_gasnet_seginfo[r].addr;
+    uintptr_t seg_end = seg_start + all_gasnet_seginfo[r].size;
+    *start = line_addr < seg_start ? seg_start : line_addr;
+    *end = line_addr + cache_line_size > seg_end ?
+      seg_end : line_addr + cache_line_size;
+    return (addr >= *start && addr + nbytes <= *end);
+  }
+
+  // Read [addr, addr+nbytes), which is within one line, through the
+  // cache.  A miss fetches the whole line without holding cache_lock and
+  // installs it afterwards, unless the cache was invalidated or written
+  // in the meantime.
+  static void cache_get_line(char *out, rank_t r, uintptr_t addr, size_t nbytes)
+  {
+    uintptr_t line_addr = addr & ~((uintptr_t)cache_line_size - 1);
+    uintptr_t start, end;
+
+    upcxx_mutex_lock(&cache_lock);
+    if (!_cache_enabled) {
+      upcxx_mutex_unlock(&cache_lock);
+      UPCXX_CALL_GASNET(gasnet_get_bulk(out, r, (void *)addr, nbytes));
+      return;
+    }
+    cache_line_t *line = cache_hit(r, addr, nbytes);
+    if (line != NULL) {
+      num_cache_hits++;
+      memcpy(out, cache_data + (line - cache_lines) * cache_line_size +
+             (addr - line_addr), nbytes);
+      upcxx_mutex_unlock(&cache_lock);
+      return;
+    }
+    num_cache_misses++;
+    uint64_t epoch = cache_epoch;
+    uint64_t writes = cache_writes;
+    size_t line_size = cache_line_size;
+    bool cacheable = cache_line_range(r, addr, nbytes, &start, &end);
+    upcxx_mutex_unlock(&cache_lock);
+
+    if (!cacheable) {
+      UPCXX_CALL_GASNET(gasnet_get_bulk(out, r, (void *)addr, nbytes));
+      return;
+    }
+
+    char *buf = (char *)malloc(line_size);
+    assert(buf != NULL);
+    UPCXX_CALL_GASNET(gasnet_get_bulk(buf, r, (void *)start, end - start));
+    memcpy(out, buf + (addr - start), nbytes);
+
+    upcxx_mutex_lock(&cache_lock);
+    if (_cache_enabled && cache_epoch == epoch && cache_writes == writes) {
+      size_t idx = cache_index(r, line_addr);
+      line = &cache_lines[idx];
+      memcpy(cache_data + idx * cache_line_size + (start - line_addr), buf,
+             end - start);
+      line->epoch = cache_epoch;
+      line->rank = r;
+      line->base = start;
+      line->nbytes = end - start;
+#ifdef UPCXX_DEBUG
+      fprintf(stderr, "Rank %u caches line %p (%lu bytes) of rank %u in slot %lu\n",
+              global_myrank(), (void *)start, end - start, r, idx);
+#endif
+    }
+    upcxx_mutex_unlock(&cache_lock);
+    free(buf);
+  }
+
+  void cache_get(void *dst, rank_t r, const void *addr, size_t nbytes)
+  {
+    uintptr_t cur = (uintptr_t)addr;
+    uintptr_t end = cur + nbytes;
+    char *out = (char *)dst;
+
+    if (_prefetch_active && prefetch_get(dst, r, addr, nbytes)) return;
+
+    if (!_cache_enabled || nbytes > cache_line_size) {
+      // reads larger than a line bypass the cache to avoid thrashing it
+      UPCXX_CALL_GASNET(gasnet_get_bulk(dst, r, (void *)addr, nbytes));
+      return;
+    }
+
+    while (cur < end) {
+      uintptr_t line_end = (cur & ~((uintptr_t)cache_line_size - 1)) + cache_line_size;
+      size_t n = (end < line_end ? end : line_end) - cur;
+      cache_get_line(out, r, cur, n);
+      out += n;
+      cur += n;
+    }
+  }
+
+  void cache_update(rank_t r, void *addr, const void *src, size_t nbytes)
+  {
+    uintptr_t cur = (uintptr_t)addr;
+    uintptr_t end = cur + nbytes;
+    const char *in = (const char *)src;
+
+    if (_prefetch_active) prefetch_update(r, addr, src, nbytes);
+
+    upcxx_mutex_lock(&cache_lock);
+    if (!_cache_enabled) {
+      upcxx_mutex_unlock(&cache_lock);
+      return;
+    }
+
+    cache_writes++; // don't install lines fetched before this write
+    while (cur < end) {
+      uintptr_t line_addr = cur & ~((uintptr_t)cache_line_size - 1);
+      uintptr_t line_end = line_addr + cache_line_size;
+      size_t n = (end < line_end ? end : line_end) - cur;
+      size_t idx = cache_index(r, line_addr);
+      cache_line_t *line = &cache_lines[idx];
+      if (line->epoch == cache_epoch && line->rank == r &&
+          line->base <= cur && cur + n <= line->base + line->nbytes) {
+        memcpy(cache_data + idx * cache_line_size + (cur - line_addr), in, n);
+      }
+      in += n;
+      cur += n;
+    }
+    upcxx_mutex_unlock(&cache_lock);
+  }
+
+  void cache_invalidate_range(rank_t r, void *addr, size_t nbytes)
+  {
+    uintptr_t cur = (uintptr_t)addr;
+    uintptr_t end = cur + nbytes;
+
+    if (_prefetch_active) prefetch_discard(r, addr, nbytes);
+
+    upcxx_mutex_lock(&cache_lock);
+    if (!_cache_enabled) {
+      upcxx_mutex_unlock(&cache_lock);
+      return;
+    }
+
+    cache_writes++; // don't install lines fetched before now
+    while (cur < end) {
+      uintptr_t line_addr = cur & ~((uintptr_t)cache_line_size - 1);
+      cache_line_t *line = &cache_lines[cache_index(r, line_addr)];
+      if (line->rank == r && line->base < line_addr + cache_line_size &&
+          line->base + line->nbytes > line_addr) {
+        line->epoch = 0;
+      }
+      cur = line_addr + cache_line_size;
+    }
+    upcxx_mutex_unlock(&cache_lock);
+  }
+
+  event **cache_invalidate_begin(rank_t r, void *addr, size_t nbytes)
+  {
+    cache_invalidate_range(r, addr, nbytes);
+    return allocate_events(1);
+  }
+
+  static void finish_invalidate(rank_t r, void *addr, size_t nbytes, event *e)
+  {
+    cache_invalidate_range(r, addr, nbytes);
+    if (e != NULL) e->decref();
+  }
+
+  void cache_invalidate_end(event **done, rank_t r, void *addr, size_t nbytes,
+                            event *e)
+  {
+    if (e != NULL) e->incref();
+    async_after(global_myrank(), done[0], NULL)(finish_invalidate, r, addr, nbytes, e);
+    async_after(global_myrank(), done[0], NULL)(deallocate_events, 1, done);
+  }
+} // namespace upcxx
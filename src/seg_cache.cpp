@@ -0,0 +1,262 @@
+/**
+ * seg_cache.cpp - per-thread caches of small GASNet segment blocks
+ *
+ * Small blocks are carved from fixed-size chunks of the segment mspace
+ * and kept in per-thread free lists by size class, so most segment
+ * allocations and frees don't take the global memory lock.  A thread
+ * free list that grows too long returns a batch of blocks to a global
+ * pool, from which other threads refill.  A thread's free lists are
+ * returned to the pool when it exits, and a chunk whose blocks are all
+ * back in the pool is returned to the mspace.
+ */
+
+#include <pthread.h>
+
+#include "upcxx.h"
+#include "upcxx/upcxx_internal.h"
+
+#define SEG_CACHE_CHUNK_SIZE  (64 * 1024)
+#define SEG_CACHE_MIN_SHIFT   6 // the smallest size class is 64 bytes
+#define SEG_CACHE_NUM_CLASSES 7 // 64 bytes to 4KB
+#define SEG_CACHE_BATCH       32
+
+namespace upcxx
+{
+  struct seg_block_t {
+    seg_block_t *next;
+  };
+
+  struct seg_thread_cache_t {
+    seg_block_t *head[SEG_CACHE_NUM_CLASSES];
+    size_t count[SEG_CACHE_NUM_CLASSES];
+    bool registered; // has the thread exit destructor
+  };
+
+  static __thread seg_thread_cache_t my_seg_cache;
+
+  static pthread_key_t seg_cache_key;
+  static pthread_once_t seg_cache_key_once = PTHREAD_ONCE_INIT;
+
+  // global pool, protected by upcxxi_mutex_for_memory
+  static seg_block_t *seg_pool_head[SEG_CACHE_NUM_CLASSES];
+  static size_t seg_pool_count[SEG_CACHE_NUM_CLASSES];
+
+  // the size class + 1 of each chunk of the segment, or 0 if the chunk
+  // is not used by the cache
+  static volatile unsigned char *seg_chunk_class = NULL;
+  // the number of blocks of each chunk in the global pool
+  static unsigned short *seg_chunk_pooled = NULL;
+  static uintptr_t seg_chunk_base = 0;
+  static size_t seg_num_chunks = 0;
+
+  static int seg_cache_enabled = -1;
+  static size_t seg_num_cache_chunks = 0;
+
+  static inline int seg_size_class(size_t nbytes)
+  {
+    int c = 0;
+    size_t sz = (size_t)1 << SEG_CACHE_MIN_SHIFT;
+    while (sz < nbytes) {
+      sz <<= 1;
+      c++;
+    }
+    return c;
+  }
+
+  // Called with upcxxi_mutex_for_memory held
+  static void init_seg_cache()
+  {
+    if (_gasnet_mspace == 0) {
+      init_gasnet_seg_mspace();
+    }
+    uintptr_t seg_start = (uintptr_t)my_gasnet_seginfo->addr;
+    uintptr_t seg_end = seg_start + my_gasnet_seginfo->size;
+    seg_chunk_base = seg_start & ~((uintptr_t)SEG_CACHE_CHUNK_SIZE - 1);
+    seg_num_chunks = (seg_end - seg_chunk_base + SEG_CACHE_CHUNK_SIZE - 1) / SEG_CACHE_CHUNK_SIZE;
+    seg_chunk_pooled = (unsigned short *)calloc(seg_num_chunks, sizeof(unsigned short));
+    assert(seg_chunk_pooled != NULL);
+    seg_chunk_class = (unsigned char *)calloc(seg_num_chunks, 1);
+    assert(seg_chunk_class != NULL);
+  }
+
+  static inline size_t seg_chunk_index(void *p)
+  {
+    return ((uintptr_t)p - seg_chunk_base) / SEG_CACHE_CHUNK_SIZE;
+  }
+
+  // Return chunk idx of size class c to the mspace once all its blocks
+  // are in the global pool.  Called with upcxxi_mutex_for_memory held.
+  static void seg_release_chunk(size_t idx, int c)
+  {
+    uintptr_t chunk = seg_chunk_base + idx * SEG_CACHE_CHUNK_SIZE;
+    seg_block_t **pp = &seg_pool_head[c];
+    while (*pp != NULL) {
+      if ((uintptr_t)*pp - chunk < SEG_CACHE_CHUNK_SIZE) {
+        *pp = (*pp)->next;
+        seg_pool_count[c]--;
+      } else {
+        pp = &(*pp)->next;
+      }
+    }
+    seg_chunk_pooled[idx] = 0;
+    seg_chunk_class[idx] = 0;
+    seg_num_cache_chunks--;
+    mspace_free(_gasnet_mspace, (void *)chunk);
+  }
+
+  // Called with upcxxi_mutex_for_memory held
+  static void seg_pool_push(seg_block_t *b, int c)
+  {
+    b->next = seg_pool_head[c];
+    seg_pool_head[c] = b;
+    seg_pool_count[c]++;
+    size_t idx = seg_chunk_index(b);
+    if (++seg_chunk_pooled[idx] == SEG_CACHE_CHUNK_SIZE >> (c + SEG_CACHE_MIN_SHIFT)) {
+      seg_release_chunk(idx, c);
+    }
+  }
+
+  // Called with upcxxi_mutex_for_memory held
+  static seg_block_t *seg_pool_pop(int c)
+  {
+    seg_block_t *b = seg_pool_head[c];
+    seg_pool_head[c] = b->next;
+    seg_pool_count[c]--;
+    seg_chunk_pooled[seg_chunk_index(b)]--;
+    return b;
+  }
+
+  // Return the free lists of an exiting thread to the global pool
+  static void seg_cache_thread_exit(void *arg)
+  {
+    seg_thread_cache_t *tc = (seg_thread_cache_t *)arg;
+    upcxx_mutex_lock(&upcxxi_mutex_for_memory);
+    for (int c = 0; c < SEG_CACHE_NUM_CLASSES; c++) {
+      while (tc->head[c] != NULL) {
+        seg_block_t *b = tc->head[c];
+        tc->head[c] = b->next;
+        seg_pool_push(b, c);
+      }
+      tc->count[c] = 0;
+    }
+    upcxx_mutex_unlock(&upcxxi_mutex_for_memory);
+  }
+
+  static void seg_cache_key_init()
+  {
+    pthread_key_create(&seg_cache_key, seg_cache_thread_exit);
+  }
+
+  static inline seg_thread_cache_t *seg_thread_cache()
+  {
+    seg_thread_cache_t *tc = &my_seg_cache;
+    if (!tc->registered) {
+      pthread_once(&seg_cache_key_once, seg_cache_key_init);
+      pthread_setspecific(seg_cache_key, tc);
+      tc->registered = true;
+    }
+    return tc;
+  }
+
+  // Refill the thread cache for size class c
+  static void seg_cache_refill(seg_thread_cache_t *tc, int c)
+  {
+    upcxx_mutex_lock(&upcxxi_mutex_for_memory);
+    if (seg_chunk_class == NULL) init_seg_cache();
+
+    if (seg_pool_head[c] != NULL) {
+      // take a batch from the global pool
+      for (int i = 0; i < SEG_CACHE_BATCH && seg_pool_head[c] != NULL; i++) {
+        seg_block_t *b = seg_pool_pop(c);
+        b->next = tc->head[c];
+        tc->head[c] = b;
+        tc->count[c]++;
+      }
+    } else {
+      // carve a new chunk into blocks
+      char *chunk = (char *)mspace_memalign(_gasnet_mspace, SEG_CACHE_CHUNK_SIZE,
+                                            SEG_CACHE_CHUNK_SIZE);
+      if (chunk != NULL) {
+        seg_num_cache_chunks++;
+        seg_chunk_class[seg_chunk_index(chunk)] = c + 1;
+        size_t sz = (size_t)1 << (c + SEG_CACHE_MIN_SHIFT);
+        for (size_t off = 0; off < SEG_CACHE_CHUNK_SIZE; off += sz) {
+          seg_block_t *b = (seg_block_t *)(chunk + off);
+          b->next = tc->head[c];
+          tc->head[c] = b;
+          tc->count[c]++;
+        }
+      }
+    }
+    upcxx_mutex_unlock(&upcxxi_mutex_for_memory);
+  }
+
+  void *seg_cache_alloc(size_t nbytes)
+  {
+    if (seg_cache_enabled < 0) {
+      seg_cache_enabled = gasnett_getenv_yesno_withdefault("UPCXX_SEG_CACHE", 1);
+    }
+    if (!seg_cache_enabled) return NULL;
+
+    int c = seg_size_class(nbytes);
+    if (c >= SEG_CACHE_NUM_CLASSES) return NULL;
+
+    seg_thread_cache_t *tc = seg_thread_cache();
+    if (tc->head[c] == NULL) {
+      seg_cache_refill(tc, c);
+      if (tc->head[c] == NULL) return NULL; // out of segment memory
+    }
+    seg_block_t *b = tc->head[c];
+    tc->head[c] = b->next;
+    tc->count[c]--;
+    return b;
+  }
+
+  // Return the size class of p if it is a cached block, or -1 otherwise
+  static inline int seg_cache_class_of(void *p)
+  {
+    if (seg_chunk_class == NULL) return -1;
+
+    uintptr_t addr = (uintptr_t)p;
+    if (addr < seg_chunk_base) return -1;
+    size_t idx = (addr - seg_chunk_base) / SEG_CACHE_CHUNK_SIZE;
+    if (idx >= seg_num_chunks) return -1;
+    return (int)seg_chunk_class[idx] - 1;
+  }
+
+  size_t seg_cache_usable_size(void *p)
+  {
+    int c = seg_cache_class_of(p);
+    return (c < 0) ? 0 : (size_t)1 << (c + SEG_CACHE_MIN_SHIFT);
+  }
+
+  size_t seg_cache_bytes()
+  {
+    return seg_num_cache_chunks * SEG_CACHE_CHUNK_SIZE;
+  }
+
+  bool seg_cache_free(void *p)
+  {
+    int c = seg_cache_class_of(p);
+    if (c < 0) return false;
+
+    seg_thread_cache_t *tc = seg_thread_cache();
+    seg_block_t *b = (seg_block_t *)p;
+    b->next = tc->head[c];
+    tc->head[c] = b;
+    tc->count[c]++;
+
+    if (tc->count[c] > 2 * SEG_CACHE_BATCH) {
+      // return a batch to the global pool
+      upcxx_mutex_lock(&upcxxi_mutex_for_memory);
+      for (int i = 0; i < SEG_CACHE_BATCH; i++) {
+        b = tc->head[c];
+        tc->head[c] = b->next;
+        tc->count[c]--;
+        seg_pool_push(b, c);
+      }
+      upcxx_mutex_unlock(&upcxxi_mutex_for_memory);
+    }
+    return true;
+  }
+} // namespace upcxx
@@ -0,0 +1,132 @@
+/**
+ * segment_stats.cpp - memory usage statistics of the GASNet segment
+ */
+
+#include "upcxx.h"
+#include "upcxx/upcxx_internal.h"
+
+namespace upcxx
+{
+  static volatile uint64_t seg_bytes_in_use = 0;
+  static volatile uint64_t seg_high_water = 0;
+  static volatile uint64_t seg_alloc_count[SEG_ALLOC_NUM_CLASSES];
+  static volatile uint64_t seg_alloc_bytes[SEG_ALLOC_NUM_CLASSES];
+
+  static const char *seg_alloc_class_names[SEG_ALLOC_NUM_CLASSES] = {
+    "user", "md array", "team", "shared_array", "dist_hash_map",
+    "runtime"
+  };
+
+  void seg_stats_alloc(size_t nbytes, seg_alloc_class_t c)
+  {
+    __sync_fetch_and_add(&seg_alloc_count[c], 1);
+    __sync_fetch_and_add(&seg_alloc_bytes[c], nbytes);
+    uint64_t in_use = __sync_add_and_fetch(&seg_bytes_in_use, nbytes);
+    uint64_t hw = seg_high_water;
+    while (in_use > hw) {
+      if (__sync_bool_compare_and_swap(&seg_high_water, hw, in_use)) break;
+      hw = seg_high_water;
+    }
+  }
+
+  void seg_stats_free(size_t nbytes)
+  {
+    __sync_fetch_and_sub(&seg_bytes_in_use, nbytes);
+  }
+
+  static void count_free_block(void *start, void *end, size_t used_bytes, void *arg)
+  {
+    if (used_bytes != 0) return;
+    segment_stats_t *stats = (segment_stats_t *)arg;
+    uint64_t sz = (char *)end - (char *)start;
+    stats->num_free_blocks++;
+    if (sz > stats->largest_free_block) stats->largest_free_block = sz;
+    int b = 0;
+    while (b < UPCXX_SEG_HIST_BUCKETS - 1 && sz >= ((uint64_t)128 << b)) b++;
+    stats->free_hist[b]++;
+  }
+
+  void segment_stats(segment_stats_t *stats)
+  {
+    memset(stats, 0, sizeof(segment_stats_t));
+
+    upcxx_mutex_lock(&upcxxi_mutex_for_memory);
+    if (_gasnet_mspace != 0) {
+      stats->segment_size = my_gasnet_seginfo->size;
+      struct mallinfo mi = mspace_mallinfo(_gasnet_mspace);
+      stats->free_bytes = mi.fordblks;
+      mspace_inspect_all(_gasnet_mspace, count_free_block, stats);
+      stats->symmetric_size = symmetric_heap_size;
+      stats->symmetric_free = symmetric_heap_free_bytes();
+    }
+    upcxx_mutex_unlock(&upcxxi_mutex_for_memory);
+
+    stats->bytes_in_use = seg_bytes_in_use;
+    stats->high_water = seg_high_water;
+    stats->cached_bytes = seg_cache_bytes();
+    for (int c = 0; c < SEG_ALLOC_NUM_CLASSES; c++) {
+      stats->alloc_count[c] = seg_alloc_count[c];
+      stats->alloc_bytes[c] = seg_alloc_bytes[c];
+    }
+  }
+
+  static void print_stats(FILE *fp, const char *who, const segment_stats_t *s)
+  {
+    fprintf(fp, "%s: segment %llu bytes, in use %llu bytes, high water %llu bytes, "
+            "free %llu bytes in %llu blocks (largest %llu bytes), cached %llu bytes\n",
+            who, (unsigned long long)s->segment_size,
+            (unsigned long long)s->bytes_in_use, (unsigned long long)s->high_water,
+            (unsigned long long)s->free_bytes, (unsigned long long)s->num_free_blocks,
+            (unsigned long long)s->largest_free_block,
+            (unsigned long long)s->cached_bytes);
+    if (s->symmetric_size != 0) {
+      fprintf(fp, "%s: symmetric heap %llu bytes, free %llu bytes\n", who,
+              (unsigned long long)s->symmetric_size,
+              (unsigned long long)s->symmetric_free);
+    }
+    fprintf(fp, "%s: allocations:", who);
+    for (int c = 0; c < SEG_ALLOC_NUM_CLASSES; c++) {
+      fprintf(fp, " %s %llu (%llu bytes)%s", seg_alloc_class_names[c],
+              (unsigned long long)s->alloc_count[c],
+              (unsigned long long)s->alloc_bytes[c],
+              c < SEG_ALLOC_NUM_CLASSES - 1 ? "," : "\n");
+    }
+    fprintf(fp, "%s: free blocks by size:", who);
+    for (int b = 0; b < UPCXX_SEG_HIST_BUCKETS; b++) {
+      if (s->free_hist[b] == 0) continue;
+      fprintf(fp, " %s%lluB:%llu", b == UPCXX_SEG_HIST_BUCKETS - 1 ? ">=" : "",
+              (unsigned long long)64 << b, (unsigned long long)s->free_hist[b]);
+    }
+    fprintf(fp, "\n");
+  }
+
+  void print_segment_stats(FILE *fp)
+  {
+    segment_stats_t stats;
+    segment_stats(&stats);
+    char who[32];
+    snprintf(who, sizeof(who), "Rank %u", global_myrank());
+    print_stats(fp, who, &stats);
+  }
+
+  void report_segment_stats()
+  {
+    if (!gasnett_getenv_yesno_withdefault("UPCXX_SEGMENT_STATS", 0)) return;
+
+    segment_stats_t stats, sum, max;
+    segment_stats(&stats);
+    char who[32];
+    snprintf(who, sizeof(who), "Rank %u", global_myrank());
+    print_stats(stderr, who, &stats);
+
+    size_t n = sizeof(segment_stats_t) / sizeof(uint64_t);
+    upcxx_reduce((uint64_t *)&stats, (uint64_t *)&sum, n, 0, UPCXX_SUM, UPCXX_ULONG_LONG);
+    upcxx_reduce((uint64_t *)&stats, (uint64_t *)&max, n, 0, UPCXX_MAX, UPCXX_ULONG_LONG);
+    if (global_myrank() == 0) {
+      // the high water mark and the largest free block are per-rank maxima
+      sum.high_water = max.high_water;
+      sum.largest_free_block = max.largest_free_block;
+      print_stats(stderr, "All ranks", &sum);
+    }
+  }
+} // namespace upcxx
@@ -0,0 +1,104 @@
+/**
+ * symmetric.cpp - collective allocation at the same segment offset on
+ * every rank
+ *
+ * The bottom of every GASNet segment is managed by a separate mspace,
+ * the symmetric heap.  dlmalloc is deterministic and the segments are
+ * page aligned, so as long as all ranks perform the same sequence of
+ * (collective) symmetric allocations and frees, each block lands at the
+ * same offset from the segment base on every rank.
+ */
+
+#include "upcxx.h"
+#include "upcxx/upcxx_internal.h"
+
+// Round the symmetric heap size down to a multiple of this
+#define SYMMETRIC_HEAP_ALIGN (64*1024)
+// A symmetric heap smaller than this is not worth reserving
+#define SYMMETRIC_HEAP_MIN (256*1024)
+
+namespace upcxx
+{
+  ptrdiff_t *symmetric_heap_delta = NULL;
+  size_t symmetric_heap_size = 0;
+  static mspace symmetric_mspace = 0;
+
+  // Called by init_gasnet_seg_mspace() with upcxxi_mutex_for_memory held
+  size_t init_symmetric_heap()
+  {
+    gasnet_node_t n = gasnet_nodes();
+    uintptr_t min_seg_size = all_gasnet_seginfo[0].size;
+    for (gasnet_node_t i = 1; i < n; i++) {
+      if (all_gasnet_seginfo[i].size < min_seg_size)
+        min_seg_size = all_gasnet_seginfo[i].size;
+    }
+
+    // All ranks compute the same size from the same inputs.  The heap
+    // is taken from the memory available to allocate(), so it is only
+    // reserved on request.
+    int64_t sz = gasnett_getenv_int_withdefault("UPCXX_SYMMETRIC_HEAP_SIZE",
+                                                0, 1);
+    if (sz < 0) sz = 0;
+    if ((uint64_t)sz > min_seg_size / 2) sz = min_seg_size / 2;
+    sz = sz / SYMMETRIC_HEAP_ALIGN * SYMMETRIC_HEAP_ALIGN;
+    if (sz < SYMMETRIC_HEAP_MIN) return 0;
+
+    symmetric_heap_delta = (ptrdiff_t *)malloc(sizeof(ptrdiff_t) * n);
+    assert(symmetric_heap_delta != NULL);
+    for (gasnet_node_t i = 0; i < n; i++) {
+      symmetric_heap_delta[i] =
+        (char *)all_gasnet_seginfo[i].addr - (char *)my_gasnet_seginfo->addr;
+    }
+
+    symmetric_mspace = create_mspace_with_base(my_gasnet_seginfo->addr, sz, 0);
+    assert(symmetric_mspace != 0);
+    mspace_set_footprint_limit(symmetric_mspace, sz);
+    symmetric_heap_size = sz;
+    return sz;
+  }
+
+  // Called with upcxxi_mutex_for_memory held
+  size_t symmetric_heap_free_bytes()
+  {
+    if (symmetric_mspace == 0) return 0;
+    struct mallinfo mi = mspace_mallinfo(symmetric_mspace);
+    return mi.fordblks;
+  }
+
+  void *symmetric_allocate(size_t nbytes, seg_alloc_class_t c)
+  {
+    upcxx_mutex_lock(&upcxxi_mutex_for_memory);
+    if (_gasnet_mspace == 0) {
+      init_gasnet_seg_mspace();
+    }
+    void *p = NULL;
+    if (symmetric_mspace != 0) {
+      p = mspace_memalign(symmetric_mspace, SEG_CACHE_ALIGN, nbytes);
+    }
+    upcxx_mutex_unlock(&upcxxi_mutex_for_memory);
+
+    if (p != NULL) seg_stats_alloc(mspace_usable_size(p), c);
+
+    // Other ranks may access the block as soon as they return
+    barrier();
+    return p;
+  }
+
+  void symmetric_deallocate(void *ptr)
+  {
+    // Make sure no rank is still accessing the block
+    barrier();
+    if (ptr == NULL) return;
+
+    if (!is_symmetric_addr(ptr)) {
+      fprintf(stderr, "Error: %p passed to symmetric_deallocate() is not from "
+              "symmetric_allocate().\n", ptr);
+      UPCXX_CALL_GASNET(gasnet_exit(1));
+    }
+
+    seg_stats_free(mspace_usable_size(ptr));
+    upcxx_mutex_lock(&upcxxi_mutex_for_memory);
+    mspace_free(symmetric_mspace, ptr);
+    upcxx_mutex_unlock(&upcxxi_mutex_for_memory);
+  }
+} // namespace upcxx
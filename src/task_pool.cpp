@@ -0,0 +1,276 @@
+/**
+ * task_pool.cpp - distributed work-stealing task pool
+ */
+
+#include <stdlib.h>
+
+#include "upcxx.h"
+#include "upcxx/upcxx_internal.h"
+
+// #define UPCXX_DEBUG
+
+namespace upcxx
+{
+  task_pool_base::task_pool_base(size_t task_size)
+    : _task_size(task_size), _pools(NULL), _buf(NULL), _capacity(0),
+      _top(0), _count(0), _running(false), _spawned(0), _executed(0),
+      _stolen(0), _steal_in_flight(false), _seed(0), _token_arrived(false),
+      _token_spawned(0), _token_executed(0), _wave_active(false),
+      _last_spawned((uint64_t)-1), _last_executed((uint64_t)-1),
+      _terminated(false)
+  {
+    upcxx_mutex_init(&_lock);
+  }
+
+  task_pool_base::~task_pool_base()
+  {
+    free(_buf);
+    free(_pools);
+  }
+
+  void task_pool_base::init()
+  {
+    if (!upcxx::is_init()) {
+      fprintf(stderr, "error: attempt to create task_pool before "
+              "initializing UPC++\n");
+      abort();
+    }
+    if (sizeof(steal_reply_t) + _task_size > gasnet_AMMaxMedium()) {
+      fprintf(stderr, "task_pool error: tasks of %lu bytes do not fit in "
+              "an active message of %lu bytes.\n",
+              (unsigned long)_task_size, (unsigned long)gasnet_AMMaxMedium());
+      gasnet_exit(1);
+    }
+
+    if (_pools == NULL) {
+      _pools = (task_pool_base **)malloc(global_ranks() * sizeof(task_pool_base *));
+      assert(_pools != NULL);
+    }
+    _seed = global_myrank() * 7919 + 1;
+
+    task_pool_base *me = this;
+    gasnet_coll_handle_t h;
+    h = gasnet_coll_gather_all_nb(GASNET_TEAM_ALL, _pools, &me,
+                                  sizeof(task_pool_base *),
+                                  UPCXX_GASNET_COLL_FLAG);
+    while(gasnet_coll_try_sync(h) != GASNET_OK) {
+      advance(); // need to keep polling the task queue while waiting
+    }
+  }
+
+  // Double the deque, called with _lock held
+  void task_pool_base::grow()
+  {
+    size_t cap = (_capacity == 0) ? 64 : _capacity * 2;
+    char *buf = (char *)malloc(cap * _task_size);
+    assert(buf != NULL);
+    for (size_t i = 0; i < _count; i++) {
+      memcpy(buf + i * _task_size,
+             _buf + ((_top + i) % _capacity) * _task_size, _task_size);
+    }
+    free(_buf);
+    _buf = buf;
+    _capacity = cap;
+    _top = 0;
+  }
+
+  void task_pool_base::push_tasks(const void *tasks, size_t n)
+  {
+    upcxx_mutex_lock(&_lock);
+    for (size_t i = 0; i < n; i++) {
+      if (_count == _capacity) grow();
+      memcpy(_buf + ((_top + _count) % _capacity) * _task_size,
+             (const char *)tasks + i * _task_size, _task_size);
+      _count++;
+    }
+    upcxx_mutex_unlock(&_lock);
+  }
+
+  void task_pool_base::push(const void *task)
+  {
+    push_tasks(task, 1);
+    _spawned++;
+  }
+
+  bool task_pool_base::pop_bottom(void *task)
+  {
+    bool found = false;
+    upcxx_mutex_lock(&_lock);
+    if (_count > 0) {
+      _count--;
+      memcpy(task, _buf + ((_top + _count) % _capacity) * _task_size,
+             _task_size);
+      found = true;
+    }
+    upcxx_mutex_unlock(&_lock);
+    return found;
+  }
+
+  // Take up to half of the tasks, the oldest first
+  size_t task_pool_base::pop_top(void *tasks, size_t max_tasks)
+  {
+    upcxx_mutex_lock(&_lock);
+    size_t n = (_count + 1) / 2;
+    if (n > max_tasks) n = max_tasks;
+    for (size_t i = 0; i < n; i++) {
+      memcpy((char *)tasks + i * _task_size, _buf + _top * _task_size,
+             _task_size);
+      _top = (_top + 1) % _capacity;
+    }
+    _count -= n;
+    upcxx_mutex_unlock(&_lock);
+    return n;
+  }
+
+  void task_pool_base::send_steal()
+  {
+    rank_t victim = rand_r(&_seed) % (global_ranks() - 1);
+    if (victim >= global_myrank()) victim++;
+
+    steal_am_t am;
+    am.victim = _pools[victim];
+    am.thief = this;
+    _steal_in_flight = true;
+    UPCXX_CALL_GASNET(
+        GASNET_CHECK_RV(gasnet_AMRequestMedium0(victim, TASK_STEAL_AM,
+                                                &am, sizeof(am))));
+  }
+
+  void task_pool_base::send_token(rank_t r, uint64_t spawned,
+                                  uint64_t executed)
+  {
+    token_am_t am;
+    am.pool = _pools[r];
+    am.spawned = spawned;
+    am.executed = executed;
+    UPCXX_CALL_GASNET(
+        GASNET_CHECK_RV(gasnet_AMRequestMedium0(r, TASK_TOKEN_AM,
+                                                &am, sizeof(am))));
+  }
+
+  // Pass the termination token on, called only when the rank is idle
+  void task_pool_base::progress_termination()
+  {
+    rank_t me = global_myrank();
+    rank_t n = global_ranks();
+
+    if (n == 1) {
+      _terminated = true;
+      return;
+    }
+
+    if (me != 0) {
+      if (_token_arrived) {
+        _token_arrived = false;
+        send_token((me + 1) % n, _token_spawned + _spawned,
+                   _token_executed + _executed);
+      }
+      return;
+    }
+
+    if (!_wave_active) {
+      _wave_active = true;
+      send_token(1, _spawned, _executed);
+    } else if (_token_arrived) {
+      _token_arrived = false;
+      _wave_active = false;
+      uint64_t s = _token_spawned;
+      uint64_t e = _token_executed;
+#ifdef UPCXX_DEBUG
+      fprintf(stderr, "task_pool wave: spawned %llu executed %llu\n",
+              (unsigned long long)s, (unsigned long long)e);
+#endif
+      if (s == e && s == _last_spawned && e == _last_executed) {
+        for (rank_t r = 1; r < n; r++) {
+          token_am_t am;
+          am.pool = _pools[r];
+          am.spawned = s;
+          am.executed = e;
+          UPCXX_CALL_GASNET(
+              GASNET_CHECK_RV(gasnet_AMRequestMedium0(r, TASK_TERMINATE_AM,
+                                                      &am, sizeof(am))));
+        }
+        _terminated = true;
+      } else {
+        _last_spawned = s;
+        _last_executed = e;
+      }
+    }
+  }
+
+  bool task_pool_base::next_task(void *task)
+  {
+    if (_running) {
+      _executed++;
+      _running = false;
+    }
+    // serve the steal requests of other ranks
+    UPCXX_CALL_GASNET(gasnet_AMPoll());
+
+    while (!pop_bottom(task)) {
+      if (_terminated) {
+        while (_steal_in_flight) advance();
+        barrier();
+        // get ready for the next run
+        _terminated = false;
+        _wave_active = false;
+        _last_spawned = _last_executed = (uint64_t)-1;
+        return false;
+      }
+      if (!_steal_in_flight && global_ranks() > 1) send_steal();
+      progress_termination();
+      advance();
+    }
+    _running = true;
+    return true;
+  }
+
+  void task_pool_base::steal_am_handler(gasnet_token_t token, void *buf,
+                                        size_t nbytes)
+  {
+    steal_am_t *am = (steal_am_t *)buf;
+    assert(nbytes == sizeof(steal_am_t));
+    task_pool_base *victim = am->victim;
+
+    size_t max_tasks = (gasnet_AMMaxMedium() - sizeof(steal_reply_t)) / victim->_task_size;
+    char *reply = (char *)malloc(sizeof(steal_reply_t) + max_tasks * victim->_task_size);
+    assert(reply != NULL);
+    steal_reply_t *header = (steal_reply_t *)reply;
+    header->thief = am->thief;
+    header->ntasks = victim->pop_top(header + 1, max_tasks);
+    GASNET_CHECK_RV(gasnet_AMReplyMedium0(token, TASK_STEAL_REPLY, reply,
+                                          sizeof(steal_reply_t) +
+                                          header->ntasks * victim->_task_size));
+    free(reply);
+  }
+
+  void task_pool_base::steal_reply_handler(gasnet_token_t token, void *buf,
+                                           size_t nbytes)
+  {
+    steal_reply_t *header = (steal_reply_t *)buf;
+    task_pool_base *thief = header->thief;
+    assert(nbytes == sizeof(steal_reply_t) + header->ntasks * thief->_task_size);
+    thief->push_tasks(header + 1, header->ntasks);
+    thief->_stolen += header->ntasks;
+    thief->_steal_in_flight = false;
+  }
+
+  void task_pool_base::token_am_handler(gasnet_token_t token, void *buf,
+                                        size_t nbytes)
+  {
+    token_am_t *am = (token_am_t *)buf;
+    assert(nbytes == sizeof(token_am_t));
+    am->pool->_token_spawned = am->spawned;
+    am->pool->_token_executed = am->executed;
+    gasnett_local_wmb();
+    am->pool->_token_arrived = true;
+  }
+
+  void task_pool_base::terminate_am_handler(gasnet_token_t token, void *buf,
+                                            size_t nbytes)
+  {
+    token_am_t *am = (token_am_t *)buf;
+    assert(nbytes == sizeof(token_am_t));
+    am->pool->_terminated = true;
+  }
+} // namespace upcxx
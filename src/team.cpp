@@ -37,7 +37,7 @@ namespace upcxx
     gasnet_seginfo_t scratch_seg;
     scratch_seg.size = GASNET_COLL_SCRATCH_SEG_SIZE;
 #ifdef USE_GASNET_FAST_SEGMENT
-    scratch_seg.addr = gasnet_seg_alloc(scratch_seg.size);
+    scratch_seg.addr = gasnet_seg_alloc(scratch_seg.size, SEG_ALLOC_TEAM);
 #else
     scratch_seg.addr = malloc(scratch_seg.size);
 #endif
@@ -47,6 +47,7 @@ namespace upcxx
     gasnet_team_handle_t new_gasnet_team
       = gasnete_coll_team_split(_gasnet_team, color, key, &scratch_seg GASNETE_THREAD_GET);
     assert(new_gasnet_team != NULL);
+    coll_team_split(_gasnet_team, new_gasnet_team, color);
 
     uint32_t team_sz = gasnet_coll_team_size(new_gasnet_team);
     // range r_tmp = range(0,0,0);
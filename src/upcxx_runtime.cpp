@@ -52,9 +52,26 @@ namespace upcxx
     {LOCK_AM,                 (void (*)())shared_lock::lock_am_handler},
     {LOCK_REPLY,              (void (*)())shared_lock::lock_reply_handler},
     {UNLOCK_AM,               (void (*)())shared_lock::unlock_am_handler},
+    {UNLOCK_REPLY,            (void (*)())shared_lock::unlock_reply_handler},
+    {LOCK_LINK_AM,            (void (*)())shared_lock::lock_link_am_handler},
+    {LOCK_GRANT_AM,           (void (*)())shared_lock::lock_grant_am_handler},
+    {RWLOCK_AM,               (void (*)())shared_rwlock::rwlock_am_handler},
+    {RWLOCK_REPLY,            (void (*)())shared_rwlock::rwlock_reply_handler},
+    {RWLOCK_GRANT_AM,         (void (*)())shared_rwlock::rwlock_grant_am_handler},
     {INC_AM,                  (void (*)())inc_am_handler},
-    {FETCH_ADD_U64_AM,        (void (*)())fetch_add_am_handler<uint64_t>},
-    {FETCH_ADD_U64_REPLY,     (void (*)())fetch_add_reply_handler<uint64_t>},
+    {ATOMIC_AM,               (void (*)())atomic_am_handler},
+    {ATOMIC_REPLY,            (void (*)())atomic_reply_handler},
+    {UPDATE_AM,               (void (*)())update_am_handler},
+    {UPDATE_REPLY,            (void (*)())update_reply_handler},
+    {DHM_AM,                  (void (*)())dhm_am_handler},
+    {DHM_REPLY,               (void (*)())dhm_reply_handler},
+    {TASK_STEAL_AM,           (void (*)())task_pool_base::steal_am_handler},
+    {TASK_STEAL_REPLY,        (void (*)())task_pool_base::steal_reply_handler},
+    {TASK_TOKEN_AM,           (void (*)())task_pool_base::token_am_handler},
+    {TASK_TERMINATE_AM,       (void (*)())task_pool_base::terminate_am_handler},
+    {COLL_MSG_AM,             (void (*)())coll_msg_am_handler},
+    {WRITE_COMBINE_AM,        (void (*)())write_combine_am_handler},
+    {WRITE_COMBINE_REPLY,     (void (*)())write_combine_reply_handler},
 
     gasneti_handler_tableentry_with_bits(copy_and_signal_request),
     gasneti_handler_tableentry_with_bits(copy_and_signal_reply),
@@ -238,6 +255,7 @@ namespace upcxx
     async_wait();
     while (advance() > 0);
     barrier();
+    report_segment_stats();
     // gasnet_exit(0);
     extern bool _threads_deprecated_warned;
     if (global_myrank() == 0 && _threads_deprecated_warned) {
@@ -430,6 +448,14 @@ namespace upcxx
       num_in = advance_in_task_queue(in_task_queue, max_in);
       assert(num_in >= 0);
     }
+    // send the batches of queued non-blocking remote atomics, updates,
+    // hash map operations, frees and combined writes, and the lock
+    // queue links, and progress the non-blocking collectives
+    am_batcher_progress();
+    shared_lock::progress();
+    shared_rwlock::progress();
+    async_coll_progress();
+
     if (max_out > 0) {
       num_out = advance_out_task_queue(out_task_queue, max_out);
       assert(num_out >= 0);
@@ -514,13 +540,35 @@ namespace upcxx
     }
     assert(p != 0);
 
+    if (is_symmetric_addr(p)) {
+      fprintf(stderr, "Error: %p is from symmetric_allocate() and must be freed "
+              "by symmetric_deallocate().\n", p);
+      UPCXX_CALL_GASNET(gasnet_exit(1));
+    }
+
+    size_t sz = seg_cache_usable_size(p);
+    if (sz != 0) {
+      seg_stats_free(sz);
+      seg_cache_free(p);
+      return;
+    }
+    seg_stats_free(mspace_usable_size(p));
+
     upcxx_mutex_lock(&upcxxi_mutex_for_memory);
     mspace_free(_gasnet_mspace, p);
     upcxx_mutex_unlock(&upcxxi_mutex_for_memory);
   }
 
-  void *gasnet_seg_memalign(size_t nbytes, size_t alignment)
+  void *gasnet_seg_memalign(size_t nbytes, size_t alignment, seg_alloc_class_t c)
   {
+    if (alignment <= SEG_CACHE_ALIGN) {
+      void *m = seg_cache_alloc(nbytes);
+      if (m != NULL) {
+        seg_stats_alloc(seg_cache_usable_size(m), c);
+        return m;
+      }
+    }
+
     upcxx_mutex_lock(&upcxxi_mutex_for_memory);
 
     if (_gasnet_mspace== 0) {
@@ -530,12 +578,13 @@ namespace upcxx
 
     upcxx_mutex_unlock(&upcxxi_mutex_for_memory);
 
+    if (m != NULL) seg_stats_alloc(mspace_usable_size(m), c);
     return m;
   }
 
-  void *gasnet_seg_alloc(size_t nbytes)
+  void *gasnet_seg_alloc(size_t nbytes, seg_alloc_class_t c)
   {
-    return gasnet_seg_memalign(nbytes, 64);
+    return gasnet_seg_memalign(nbytes, 64, c);
   }
 
   // Return true if they physical memory of rank r can be shared and
@@ -0,0 +1,144 @@
+/**
+ * write_combine.cpp - implement write-combining buffers for put_nb
+ */
+
+#include <vector>
+
+#include "upcxx.h"
+#include "upcxx/upcxx_internal.h"
+
+// #define UPCXX_DEBUG
+
+#define WRITE_COMBINE_ALIGN 8
+#define WRITE_COMBINE_PADDED(n) \
+  (((n) + WRITE_COMBINE_ALIGN - 1) & ~((size_t)WRITE_COMBINE_ALIGN - 1))
+
+namespace upcxx
+{
+  // Buffered writes per target rank, a write_combine_am_t followed by
+  // write_combine_entry_t's and their data
+  static am_batcher_t wc_batcher;
+  // The number of unacknowledged batches per rank.  At most one batch
+  // is in flight to each rank so that AMs that overtake each other in
+  // the network can't reorder the writes.
+  static std::vector<int> *wc_in_flight = NULL;
+  static volatile bool wc_puts_pending = false; // fallback puts not synced
+  static event *wc_event = NULL;
+
+  // Called before sending the buffer for rank r with am_batcher_lock()
+  // held; keep it until the previous batch is acknowledged
+  static bool prepare_write_combine_buffer(rank_t r, char *buf, size_t nbytes)
+  {
+    if ((*wc_in_flight)[r] != 0) return false;
+
+    if (wc_puts_pending) {
+      // a fallback put to the same location must land first
+      UPCXX_CALL_GASNET(gasnet_wait_syncnbi_puts());
+      wc_puts_pending = false;
+    }
+
+    write_combine_am_t *am = (write_combine_am_t *)buf;
+    am->ack_event = wc_event;
+    am->nbytes = nbytes - sizeof(write_combine_am_t);
+    wc_event->incref();
+    (*wc_in_flight)[r] = 1;
+
+#ifdef UPCXX_DEBUG
+    fprintf(stderr, "Rank %u sends %lu bytes of combined writes to rank %u\n",
+            global_myrank(), am->nbytes, r);
+#endif
+    return true;
+  }
+
+  // Called with am_batcher_lock() held
+  static void init_write_combine()
+  {
+    wc_in_flight = new std::vector<int>(global_ranks(), 0);
+    wc_event = new event;
+    size_t max_bytes = gasnett_getenv_int_withdefault("UPCXX_WRITE_COMBINE_BUF_SIZE",
+                                                      gasnet_AMMaxMedium(), 1);
+    if (max_bytes > gasnet_AMMaxMedium())
+      max_bytes = gasnet_AMMaxMedium();
+    am_batcher_init(&wc_batcher, WRITE_COMBINE_AM, sizeof(write_combine_am_t),
+                    max_bytes, (size_t)-1, prepare_write_combine_buffer);
+  }
+
+  void put_nb(global_ptr<void> dst, const void *src, size_t nbytes)
+  {
+    if (dst.where() == global_myrank()) {
+      memcpy(dst.raw_ptr(), src, nbytes);
+      return;
+    }
+
+    size_t entry_sz = sizeof(write_combine_entry_t) + WRITE_COMBINE_PADDED(nbytes);
+
+    am_batcher_lock();
+    if (wc_batcher.batches == NULL) init_write_combine();
+
+    rank_t r = dst.where();
+    if (sizeof(write_combine_am_t) + entry_sz > wc_batcher.max_nbytes) {
+      // Too large to be combined, fall back to a regular put after
+      // the writes buffered before it are applied
+      am_batch_send_wait(&wc_batcher, r);
+      while ((*wc_in_flight)[r] != 0) {
+        am_batcher_unlock();
+        advance();
+        am_batcher_lock();
+      }
+      UPCXX_CALL_GASNET(gasnet_put_nbi(r, dst.raw_ptr(), (void *)src, nbytes));
+      wc_puts_pending = true;
+      am_batcher_unlock();
+      return;
+    }
+
+    write_combine_entry_t *entry =
+      (write_combine_entry_t *)am_batch_append(&wc_batcher, r, entry_sz);
+    entry->addr = dst.raw_ptr();
+    entry->nbytes = nbytes;
+    memcpy(entry + 1, src, nbytes);
+    am_batch_commit(&wc_batcher, r);
+    am_batcher_unlock();
+  }
+
+  void flush()
+  {
+    if (wc_event == NULL) return;
+    am_batcher_flush(&wc_batcher);
+
+    wc_event->wait();
+    // writes that were too large to be combined
+    UPCXX_CALL_GASNET(gasnet_wait_syncnbi_puts());
+    wc_puts_pending = false;
+  }
+
+  void write_combine_am_handler(gasnet_token_t token, void *buf, size_t nbytes)
+  {
+    write_combine_am_t *am = (write_combine_am_t *)buf;
+    assert(nbytes == sizeof(write_combine_am_t) + am->nbytes);
+
+    char *p = (char *)(am + 1);
+    char *end = p + am->nbytes;
+    while (p < end) {
+      write_combine_entry_t *entry = (write_combine_entry_t *)p;
+      memcpy(entry->addr, entry + 1, entry->nbytes);
+      p += sizeof(write_combine_entry_t) + WRITE_COMBINE_PADDED(entry->nbytes);
+    }
+    gasnett_local_wmb();
+
+    write_combine_reply_t reply;
+    reply.ack_event = am->ack_event;
+    GASNET_CHECK_RV(gasnet_AMReplyMedium0(token, WRITE_COMBINE_REPLY,
+                                          &reply, sizeof(reply)));
+  }
+
+  void write_combine_reply_handler(gasnet_token_t token, void *buf, size_t nbytes)
+  {
+    write_combine_reply_t *reply = (write_combine_reply_t *)buf;
+    assert(nbytes == sizeof(write_combine_reply_t));
+
+    gasnet_node_t srcnode;
+    GASNET_CHECK_RV(gasnet_AMGetMsgSource(token, &srcnode));
+    __sync_fetch_and_sub(&(*wc_in_flight)[srcnode], 1);
+    reply->ack_event->decref();
+  }
+} // namespace upcxx